@@ -0,0 +1,828 @@
+#ifndef FLORA_AST_H
+#define FLORA_AST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+#include "flora.h"
+#include "conversions.h"
+#include "string-span.h"
+#include "symbol-table.h"
+#include "token.h"
+#include "zone.h"
+
+namespace flora {
+
+class Scope;
+
+namespace ast {
+
+#define DECLARATION_NODE_LIST(V)\
+  V(ImportDeclaration)\
+  V(NamespaceDeclaration)\
+  V(ClassDeclaration)\
+  V(FunctionDeclaration)\
+  V(VariableDeclaration)\
+  V(ConstantDeclaration)
+
+#define STATEMENT_NODE_LIST(V)\
+  V(Block)\
+  V(DeclarationStatement)\
+  V(ExpressionStatement)\
+  V(IfStatement)\
+  V(ForStatement)\
+  V(WhileStatement)\
+  V(DoWhileStatement)\
+  V(CaseClause)\
+  V(SwitchStatement)\
+  V(BreakStatement)\
+  V(ContinueStatement)\
+  V(ReturnStatement)
+
+#define EXPRESSION_NODE_LIST(V)\
+  V(Literal)\
+  V(Variable)\
+  V(ArrayLiteral)\
+  V(Tuple)\
+  V(UnaryOperation)\
+  V(ArithmeticOperation)\
+  V(CompareOperation)\
+  V(AssignmentOperation)\
+  V(Conditional)\
+  V(Invoke)\
+  V(Index)\
+  V(MemberAccess)\
+  V(Conversion)\
+  V(Lambda)
+
+#define AST_NODE_LIST(V)\
+  DECLARATION_NODE_LIST(V)\
+  STATEMENT_NODE_LIST(V)\
+  EXPRESSION_NODE_LIST(V)\
+  V(TypeSpecifier)\
+  V(TranslationUnit)
+
+enum class NodeType : std::uint8_t {
+#define V(name) name,
+  AST_NODE_LIST(V)
+#undef V
+};
+
+class Declaration;
+class Statement;
+class Expression;
+#define V(name) class name;
+  AST_NODE_LIST(V)
+#undef V
+
+// All nodes live in the zone of their translation unit. Names and literals
+// are spans of the source buffer, child lists are spans of the zone.
+class Node : public ZoneObject {
+public:
+  NodeType type() const { return type_; }
+  // The offset of the first token of the node
+  std::uint32_t position() const { return position_; }
+  // Moved when the source before the node is edited
+  void set_position(std::uint32_t position) { position_ = position; }
+
+#define V(name) bool Is##name() const { return type_ == NodeType::name; }
+  AST_NODE_LIST(V)
+#undef V
+protected:
+  Node(NodeType type, std::uint32_t position)
+      : type_(type), position_(position) { }
+private:
+  NodeType type_;
+  std::uint32_t position_;
+};
+
+class TypeSpecifier : public Node {
+public:
+  // A primitive type keyword, or Token::Identifier for a named type
+  TypeSpecifier(std::uint32_t position, Token kind, StringSpan name,
+                ZoneSpan<TypeSpecifier*> arguments)
+      : Node(NodeType::TypeSpecifier, position), kind_(kind), name_(name),
+        arguments_(arguments) { }
+  Token kind() const { return kind_; }
+  StringSpan name() const { return name_; }
+  void set_name(StringSpan name) { name_ = name; }
+  ZoneSpan<TypeSpecifier*> arguments() const { return arguments_; }
+private:
+  Token kind_;
+  StringSpan name_;
+  ZoneSpan<TypeSpecifier*> arguments_;
+};
+
+// Declarations
+
+enum class MemberVisibility : std::uint8_t {
+  Default, Public, Private
+};
+
+class Declaration : public Node {
+public:
+  StringSpan name() const { return name_; }
+  void set_name(StringSpan name) { name_ = name; }
+  // The interned name, used for lookups in scopes
+  Symbol symbol() const { return symbol_; }
+  void set_symbol(Symbol symbol) { symbol_ = symbol; }
+  // The offset after the last token. Only set for the declarations of the
+  // translation unit, namespaces and classes, which can be reparsed alone.
+  std::uint32_t end_position() const { return end_position_; }
+  void set_end_position(std::uint32_t position) { end_position_ = position; }
+  MemberVisibility visibility() const { return visibility_; }
+  bool is_static() const { return is_static_; }
+  void set_visibility(MemberVisibility visibility) {
+    visibility_ = visibility;
+  }
+  void set_static(bool is_static) { is_static_ = is_static; }
+protected:
+  Declaration(NodeType type, std::uint32_t position, StringSpan name)
+      : Node(type, position), name_(name), symbol_(kNoSymbol),
+        end_position_(0), visibility_(MemberVisibility::Default),
+        is_static_(false) { }
+private:
+  StringSpan name_;
+  Symbol symbol_;
+  std::uint32_t end_position_;
+  MemberVisibility visibility_;
+  bool is_static_;
+};
+
+// import A.B.C [as D]
+class ImportDeclaration : public Declaration {
+public:
+  ImportDeclaration(std::uint32_t position, StringSpan alias,
+                    ZoneSpan<StringSpan> path)
+      : Declaration(NodeType::ImportDeclaration, position, alias),
+        path_(path) { }
+  ZoneSpan<StringSpan> path() const { return path_; }
+private:
+  ZoneSpan<StringSpan> path_;
+};
+
+class NamespaceDeclaration : public Declaration {
+public:
+  NamespaceDeclaration(std::uint32_t position, StringSpan name, Scope *scope,
+                       ZoneSpan<Declaration*> declarations)
+      : Declaration(NodeType::NamespaceDeclaration, position, name),
+        scope_(scope), declarations_(declarations) { }
+  Scope* scope() const { return scope_; }
+  ZoneSpan<Declaration*> declarations() const { return declarations_; }
+private:
+  Scope *scope_;
+  ZoneSpan<Declaration*> declarations_;
+};
+
+class ClassDeclaration : public Declaration {
+public:
+  ClassDeclaration(std::uint32_t position, StringSpan name, Scope *scope,
+                   ZoneSpan<TypeSpecifier*> bases,
+                   ZoneSpan<Declaration*> members)
+      : Declaration(NodeType::ClassDeclaration, position, name),
+        scope_(scope), bases_(bases), members_(members) { }
+  Scope* scope() const { return scope_; }
+  ZoneSpan<TypeSpecifier*> bases() const { return bases_; }
+  ZoneSpan<Declaration*> members() const { return members_; }
+private:
+  Scope *scope_;
+  ZoneSpan<TypeSpecifier*> bases_;
+  ZoneSpan<Declaration*> members_;
+};
+
+class FunctionDeclaration : public Declaration {
+public:
+  FunctionDeclaration(std::uint32_t position, StringSpan name, Scope *scope,
+                      ZoneSpan<VariableDeclaration*> parameters,
+                      TypeSpecifier *return_type, Block *body)
+      : Declaration(NodeType::FunctionDeclaration, position, name),
+        scope_(scope), parameters_(parameters), return_type_(return_type),
+        body_(body), body_position_(0) { }
+  Scope* scope() const { return scope_; }
+  ZoneSpan<VariableDeclaration*> parameters() const { return parameters_; }
+  // nullptr if the return type is inferred
+  TypeSpecifier* return_type() const { return return_type_; }
+  // nullptr while a pre-parsed body has not been parsed
+  Block* body() const { return body_; }
+  bool is_lazy() const { return body_ == nullptr; }
+  void set_body(Block *body) { body_ = body; }
+
+  // A pre-parsed body is kept as its source text from { to }
+  StringSpan lazy_body() const { return lazy_body_; }
+  std::uint32_t body_position() const { return body_position_; }
+  // The names the pre-parsed body refers to, other than members and the
+  // parameters, sorted by symbol. Locals declared in the body and the
+  // names captured by its lambdas are included, so this is a superset of
+  // the free variables.
+  ZoneSpan<Symbol> free_variables() const { return free_variables_; }
+  void set_lazy_body(std::uint32_t position, StringSpan source,
+                     ZoneSpan<Symbol> free_variables) {
+    body_position_ = position;
+    lazy_body_ = source;
+    free_variables_ = free_variables;
+  }
+private:
+  Scope *scope_;
+  ZoneSpan<VariableDeclaration*> parameters_;
+  TypeSpecifier *return_type_;
+  Block *body_;
+  std::uint32_t body_position_;
+  StringSpan lazy_body_;
+  ZoneSpan<Symbol> free_variables_;
+};
+
+class VariableDeclaration : public Declaration {
+public:
+  VariableDeclaration(std::uint32_t position, StringSpan name,
+                      TypeSpecifier *type_specifier, Expression *initializer)
+      : Declaration(NodeType::VariableDeclaration, position, name),
+        type_specifier_(type_specifier), initializer_(initializer) { }
+  // Either may be nullptr, but not both
+  TypeSpecifier* type_specifier() const { return type_specifier_; }
+  Expression* initializer() const { return initializer_; }
+private:
+  TypeSpecifier *type_specifier_;
+  Expression *initializer_;
+};
+
+class ConstantDeclaration : public Declaration {
+public:
+  ConstantDeclaration(std::uint32_t position, StringSpan name,
+                      TypeSpecifier *type_specifier, Expression *value)
+      : Declaration(NodeType::ConstantDeclaration, position, name),
+        type_specifier_(type_specifier), value_(value) { }
+  TypeSpecifier* type_specifier() const { return type_specifier_; }
+  Expression* value() const { return value_; }
+private:
+  TypeSpecifier *type_specifier_;
+  Expression *value_;
+};
+
+// Statements
+
+class Statement : public Node {
+protected:
+  Statement(NodeType type, std::uint32_t position) : Node(type, position) { }
+};
+
+class Block : public Statement {
+public:
+  Block(std::uint32_t position, Scope *scope,
+        ZoneSpan<Statement*> statements)
+      : Statement(NodeType::Block, position), scope_(scope),
+        statements_(statements) { }
+  Scope* scope() const { return scope_; }
+  ZoneSpan<Statement*> statements() const { return statements_; }
+private:
+  Scope *scope_;
+  ZoneSpan<Statement*> statements_;
+};
+
+// A local variable or constant
+class DeclarationStatement : public Statement {
+public:
+  DeclarationStatement(std::uint32_t position, Declaration *declaration)
+      : Statement(NodeType::DeclarationStatement, position),
+        declaration_(declaration) { }
+  Declaration* declaration() const { return declaration_; }
+private:
+  Declaration *declaration_;
+};
+
+class ExpressionStatement : public Statement {
+public:
+  ExpressionStatement(std::uint32_t position, Expression *expression)
+      : Statement(NodeType::ExpressionStatement, position),
+        expression_(expression) { }
+  Expression* expression() const { return expression_; }
+private:
+  Expression *expression_;
+};
+
+class IfStatement : public Statement {
+public:
+  IfStatement(std::uint32_t position, Expression *condition,
+              Statement *then_statement, Statement *else_statement)
+      : Statement(NodeType::IfStatement, position), condition_(condition),
+        then_statement_(then_statement), else_statement_(else_statement) { }
+  Expression* condition() const { return condition_; }
+  Statement* then_statement() const { return then_statement_; }
+  // nullptr without else
+  Statement* else_statement() const { return else_statement_; }
+private:
+  Expression *condition_;
+  Statement *then_statement_;
+  Statement *else_statement_;
+};
+
+class ForStatement : public Statement {
+public:
+  // The initializer is a DeclarationStatement, an ExpressionStatement or
+  // nullptr, so are the condition and the step
+  ForStatement(std::uint32_t position, Scope *scope, Statement *initializer,
+               Expression *condition, Expression *step, Statement *body)
+      : Statement(NodeType::ForStatement, position), scope_(scope),
+        initializer_(initializer), condition_(condition), step_(step),
+        body_(body) { }
+  Scope* scope() const { return scope_; }
+  Statement* initializer() const { return initializer_; }
+  Expression* condition() const { return condition_; }
+  Expression* step() const { return step_; }
+  Statement* body() const { return body_; }
+private:
+  Scope *scope_;
+  Statement *initializer_;
+  Expression *condition_;
+  Expression *step_;
+  Statement *body_;
+};
+
+class WhileStatement : public Statement {
+public:
+  WhileStatement(std::uint32_t position, Expression *condition,
+                 Statement *body)
+      : Statement(NodeType::WhileStatement, position), condition_(condition),
+        body_(body) { }
+  Expression* condition() const { return condition_; }
+  Statement* body() const { return body_; }
+private:
+  Expression *condition_;
+  Statement *body_;
+};
+
+class DoWhileStatement : public Statement {
+public:
+  DoWhileStatement(std::uint32_t position, Statement *body,
+                   Expression *condition)
+      : Statement(NodeType::DoWhileStatement, position), body_(body),
+        condition_(condition) { }
+  Statement* body() const { return body_; }
+  Expression* condition() const { return condition_; }
+private:
+  Statement *body_;
+  Expression *condition_;
+};
+
+class CaseClause : public Statement {
+public:
+  // The label is nullptr for default
+  CaseClause(std::uint32_t position, Expression *label,
+             ZoneSpan<Statement*> statements)
+      : Statement(NodeType::CaseClause, position), label_(label),
+        statements_(statements) { }
+  Expression* label() const { return label_; }
+  ZoneSpan<Statement*> statements() const { return statements_; }
+private:
+  Expression *label_;
+  ZoneSpan<Statement*> statements_;
+};
+
+class SwitchStatement : public Statement {
+public:
+  SwitchStatement(std::uint32_t position, Expression *value,
+                  ZoneSpan<CaseClause*> clauses)
+      : Statement(NodeType::SwitchStatement, position), value_(value),
+        clauses_(clauses) { }
+  Expression* value() const { return value_; }
+  ZoneSpan<CaseClause*> clauses() const { return clauses_; }
+private:
+  Expression *value_;
+  ZoneSpan<CaseClause*> clauses_;
+};
+
+class BreakStatement : public Statement {
+public:
+  explicit BreakStatement(std::uint32_t position)
+      : Statement(NodeType::BreakStatement, position) { }
+};
+
+class ContinueStatement : public Statement {
+public:
+  explicit ContinueStatement(std::uint32_t position)
+      : Statement(NodeType::ContinueStatement, position) { }
+};
+
+class ReturnStatement : public Statement {
+public:
+  ReturnStatement(std::uint32_t position, Expression *value)
+      : Statement(NodeType::ReturnStatement, position), value_(value) { }
+  // nullptr for a bare return
+  Expression* value() const { return value_; }
+private:
+  Expression *value_;
+};
+
+// Expressions
+
+class Expression : public Node {
+protected:
+  Expression(NodeType type, std::uint32_t position) : Node(type, position) { }
+};
+
+// Integer, real number, character, string, true, false and null
+class Literal : public Expression {
+public:
+  Literal(std::uint32_t position, Token kind, StringSpan literal,
+          NumberLiteral number)
+      : Expression(NodeType::Literal, position), kind_(kind),
+        literal_(literal), number_(number) { }
+  Token kind() const { return kind_; }
+  StringSpan literal() const { return literal_; }
+  void set_literal(StringSpan literal) { literal_ = literal; }
+  // The value the scanner converted an Integer or RealNumber literal to,
+  // its type is Token::Illegal for the other kinds
+  NumberLiteral number() const { return number_; }
+private:
+  Token kind_;
+  StringSpan literal_;
+  NumberLiteral number_;
+};
+
+class Variable : public Expression {
+public:
+  Variable(std::uint32_t position, StringSpan name, Symbol symbol)
+      : Expression(NodeType::Variable, position), name_(name),
+        symbol_(symbol) { }
+  StringSpan name() const { return name_; }
+  void set_name(StringSpan name) { name_ = name; }
+  // The interned name, which resolves to a declaration through the scopes
+  Symbol symbol() const { return symbol_; }
+private:
+  StringSpan name_;
+  Symbol symbol_;
+};
+
+class ArrayLiteral : public Expression {
+public:
+  ArrayLiteral(std::uint32_t position, ZoneSpan<Expression*> elements)
+      : Expression(NodeType::ArrayLiteral, position), elements_(elements) { }
+  ZoneSpan<Expression*> elements() const { return elements_; }
+private:
+  ZoneSpan<Expression*> elements_;
+};
+
+class Tuple : public Expression {
+public:
+  Tuple(std::uint32_t position, ZoneSpan<Expression*> elements)
+      : Expression(NodeType::Tuple, position), elements_(elements) { }
+  ZoneSpan<Expression*> elements() const { return elements_; }
+private:
+  ZoneSpan<Expression*> elements_;
+};
+
+// Prefix +, -, !, ~, ++, -- and postfix ++, --
+class UnaryOperation : public Expression {
+public:
+  UnaryOperation(std::uint32_t position, Token op, Expression *operand,
+                 bool is_postfix)
+      : Expression(NodeType::UnaryOperation, position), op_(op),
+        operand_(operand), is_postfix_(is_postfix) { }
+  Token op() const { return op_; }
+  Expression* operand() const { return operand_; }
+  bool is_postfix() const { return is_postfix_; }
+private:
+  Token op_;
+  Expression *operand_;
+  bool is_postfix_;
+};
+
+// Arithmetic, bitwise and logical binary operators
+class ArithmeticOperation : public Expression {
+public:
+  ArithmeticOperation(std::uint32_t position, Token op, Expression *left,
+                      Expression *right)
+      : Expression(NodeType::ArithmeticOperation, position), op_(op),
+        left_(left), right_(right) { }
+  Token op() const { return op_; }
+  Expression* left() const { return left_; }
+  Expression* right() const { return right_; }
+private:
+  Token op_;
+  Expression *left_;
+  Expression *right_;
+};
+
+class CompareOperation : public Expression {
+public:
+  CompareOperation(std::uint32_t position, Token op, Expression *left,
+                   Expression *right)
+      : Expression(NodeType::CompareOperation, position), op_(op),
+        left_(left), right_(right) { }
+  Token op() const { return op_; }
+  Expression* left() const { return left_; }
+  Expression* right() const { return right_; }
+private:
+  Token op_;
+  Expression *left_;
+  Expression *right_;
+};
+
+class AssignmentOperation : public Expression {
+public:
+  AssignmentOperation(std::uint32_t position, Token op, Expression *target,
+                      Expression *value)
+      : Expression(NodeType::AssignmentOperation, position), op_(op),
+        target_(target), value_(value) { }
+  Token op() const { return op_; }
+  Expression* target() const { return target_; }
+  Expression* value() const { return value_; }
+private:
+  Token op_;
+  Expression *target_;
+  Expression *value_;
+};
+
+class Conditional : public Expression {
+public:
+  Conditional(std::uint32_t position, Expression *condition,
+              Expression *then_expression, Expression *else_expression)
+      : Expression(NodeType::Conditional, position), condition_(condition),
+        then_expression_(then_expression),
+        else_expression_(else_expression) { }
+  Expression* condition() const { return condition_; }
+  Expression* then_expression() const { return then_expression_; }
+  Expression* else_expression() const { return else_expression_; }
+private:
+  Expression *condition_;
+  Expression *then_expression_;
+  Expression *else_expression_;
+};
+
+class Invoke : public Expression {
+public:
+  Invoke(std::uint32_t position, Expression *callee,
+         ZoneSpan<Expression*> arguments)
+      : Expression(NodeType::Invoke, position), callee_(callee),
+        arguments_(arguments) { }
+  Expression* callee() const { return callee_; }
+  ZoneSpan<Expression*> arguments() const { return arguments_; }
+private:
+  Expression *callee_;
+  ZoneSpan<Expression*> arguments_;
+};
+
+class Index : public Expression {
+public:
+  Index(std::uint32_t position, Expression *object, Expression *index)
+      : Expression(NodeType::Index, position), object_(object),
+        index_(index) { }
+  Expression* object() const { return object_; }
+  Expression* index() const { return index_; }
+private:
+  Expression *object_;
+  Expression *index_;
+};
+
+class MemberAccess : public Expression {
+public:
+  MemberAccess(std::uint32_t position, Expression *object, StringSpan name,
+               Symbol symbol)
+      : Expression(NodeType::MemberAccess, position), object_(object),
+        name_(name), symbol_(symbol) { }
+  Expression* object() const { return object_; }
+  StringSpan name() const { return name_; }
+  void set_name(StringSpan name) { name_ = name; }
+  // The interned member name
+  Symbol symbol() const { return symbol_; }
+private:
+  Expression *object_;
+  StringSpan name_;
+  Symbol symbol_;
+};
+
+// (Type) expression
+class Conversion : public Expression {
+public:
+  Conversion(std::uint32_t position, TypeSpecifier *type_specifier,
+             Expression *expression)
+      : Expression(NodeType::Conversion, position),
+        type_specifier_(type_specifier), expression_(expression) { }
+  TypeSpecifier* type_specifier() const { return type_specifier_; }
+  Expression* expression() const { return expression_; }
+private:
+  TypeSpecifier *type_specifier_;
+  Expression *expression_;
+};
+
+// (parameters) => body
+class Lambda : public Expression {
+public:
+  Lambda(std::uint32_t position, Scope *scope,
+         ZoneSpan<VariableDeclaration*> parameters, Statement *body)
+      : Expression(NodeType::Lambda, position), scope_(scope),
+        parameters_(parameters), body_(body) { }
+  Scope* scope() const { return scope_; }
+  ZoneSpan<VariableDeclaration*> parameters() const { return parameters_; }
+  // A Block, or an ExpressionStatement for an expression body
+  Statement* body() const { return body_; }
+private:
+  Scope *scope_;
+  ZoneSpan<VariableDeclaration*> parameters_;
+  Statement *body_;
+};
+
+class TranslationUnit : public Node {
+public:
+  TranslationUnit(Scope *scope, ZoneSpan<Declaration*> declarations)
+      : Node(NodeType::TranslationUnit, 0), scope_(scope),
+        declarations_(declarations) { }
+  Scope* scope() const { return scope_; }
+  ZoneSpan<Declaration*> declarations() const { return declarations_; }
+private:
+  Scope *scope_;
+  ZoneSpan<Declaration*> declarations_;
+};
+
+// Calls f with each node of the list
+template <typename T, typename F>
+void ForEachIn(ZoneSpan<T*> nodes, F &f) {
+  for (T *node : nodes) f(node);
+}
+
+// Calls f with every child of the node in source order, and with nullptr
+// for a missing optional child, such as an else branch
+template <typename F>
+void ForEachChild(const Node *node, F f) {
+  switch (node->type()) {
+  case NodeType::Literal:
+  case NodeType::Variable:
+  case NodeType::BreakStatement:
+  case NodeType::ContinueStatement:
+  case NodeType::ImportDeclaration:
+    break;
+  case NodeType::ArrayLiteral:
+    ForEachIn(static_cast<const ArrayLiteral*>(node)->elements(), f);
+    break;
+  case NodeType::Tuple:
+    ForEachIn(static_cast<const Tuple*>(node)->elements(), f);
+    break;
+  case NodeType::UnaryOperation:
+    f(static_cast<const UnaryOperation*>(node)->operand());
+    break;
+  case NodeType::ArithmeticOperation: {
+    auto binary = static_cast<const ArithmeticOperation*>(node);
+    f(binary->left());
+    f(binary->right());
+    break;
+  }
+  case NodeType::CompareOperation: {
+    auto compare = static_cast<const CompareOperation*>(node);
+    f(compare->left());
+    f(compare->right());
+    break;
+  }
+  case NodeType::AssignmentOperation: {
+    auto assignment = static_cast<const AssignmentOperation*>(node);
+    f(assignment->target());
+    f(assignment->value());
+    break;
+  }
+  case NodeType::Conditional: {
+    auto conditional = static_cast<const Conditional*>(node);
+    f(conditional->condition());
+    f(conditional->then_expression());
+    f(conditional->else_expression());
+    break;
+  }
+  case NodeType::Invoke: {
+    auto invoke = static_cast<const Invoke*>(node);
+    f(invoke->callee());
+    ForEachIn(invoke->arguments(), f);
+    break;
+  }
+  case NodeType::Index: {
+    auto index = static_cast<const Index*>(node);
+    f(index->object());
+    f(index->index());
+    break;
+  }
+  case NodeType::MemberAccess:
+    f(static_cast<const MemberAccess*>(node)->object());
+    break;
+  case NodeType::Conversion: {
+    auto conversion = static_cast<const Conversion*>(node);
+    f(conversion->type_specifier());
+    f(conversion->expression());
+    break;
+  }
+  case NodeType::Lambda: {
+    auto lambda = static_cast<const Lambda*>(node);
+    ForEachIn(lambda->parameters(), f);
+    f(lambda->body());
+    break;
+  }
+  case NodeType::Block:
+    ForEachIn(static_cast<const Block*>(node)->statements(), f);
+    break;
+  case NodeType::DeclarationStatement:
+    f(static_cast<const DeclarationStatement*>(node)->declaration());
+    break;
+  case NodeType::ExpressionStatement:
+    f(static_cast<const ExpressionStatement*>(node)->expression());
+    break;
+  case NodeType::IfStatement: {
+    auto statement = static_cast<const IfStatement*>(node);
+    f(statement->condition());
+    f(statement->then_statement());
+    f(statement->else_statement());
+    break;
+  }
+  case NodeType::ForStatement: {
+    auto statement = static_cast<const ForStatement*>(node);
+    f(statement->initializer());
+    f(statement->condition());
+    f(statement->step());
+    f(statement->body());
+    break;
+  }
+  case NodeType::WhileStatement: {
+    auto statement = static_cast<const WhileStatement*>(node);
+    f(statement->condition());
+    f(statement->body());
+    break;
+  }
+  case NodeType::DoWhileStatement: {
+    auto statement = static_cast<const DoWhileStatement*>(node);
+    f(statement->body());
+    f(statement->condition());
+    break;
+  }
+  case NodeType::CaseClause: {
+    auto clause = static_cast<const CaseClause*>(node);
+    f(clause->label());
+    ForEachIn(clause->statements(), f);
+    break;
+  }
+  case NodeType::SwitchStatement: {
+    auto statement = static_cast<const SwitchStatement*>(node);
+    f(statement->value());
+    ForEachIn(statement->clauses(), f);
+    break;
+  }
+  case NodeType::ReturnStatement:
+    f(static_cast<const ReturnStatement*>(node)->value());
+    break;
+  case NodeType::TypeSpecifier:
+    ForEachIn(static_cast<const TypeSpecifier*>(node)->arguments(), f);
+    break;
+  case NodeType::TranslationUnit:
+    ForEachIn(static_cast<const TranslationUnit*>(node)->declarations(), f);
+    break;
+  case NodeType::NamespaceDeclaration:
+    ForEachIn(
+        static_cast<const NamespaceDeclaration*>(node)->declarations(), f);
+    break;
+  case NodeType::ClassDeclaration: {
+    auto declaration = static_cast<const ClassDeclaration*>(node);
+    ForEachIn(declaration->bases(), f);
+    ForEachIn(declaration->members(), f);
+    break;
+  }
+  case NodeType::FunctionDeclaration: {
+    auto declaration = static_cast<const FunctionDeclaration*>(node);
+    ForEachIn(declaration->parameters(), f);
+    f(declaration->return_type());
+    f(declaration->body());
+    break;
+  }
+  case NodeType::VariableDeclaration: {
+    auto declaration = static_cast<const VariableDeclaration*>(node);
+    f(declaration->type_specifier());
+    f(declaration->initializer());
+    break;
+  }
+  case NodeType::ConstantDeclaration: {
+    auto declaration = static_cast<const ConstantDeclaration*>(node);
+    f(declaration->type_specifier());
+    f(declaration->value());
+    break;
+  }
+  }
+}
+
+// Creates nodes in a zone and counts them, so that the zone can be sized
+// from the statistics of earlier parses
+class AstNodeFactory {
+public:
+  NOCOPY_CLASS(AstNodeFactory)
+
+  explicit AstNodeFactory(Zone *zone) : zone_(zone), node_count_(0) { }
+
+  template <typename T, typename... Args>
+  T* New(Args&&... args) {
+    node_count_++;
+    return new (zone_) T(std::forward<Args>(args)...);
+  }
+
+  Zone* zone() const { return zone_; }
+  std::size_t node_count() const { return node_count_; }
+private:
+  Zone *zone_;
+  std::size_t node_count_;
+};
+
+}
+}
+
+#endif
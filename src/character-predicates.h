@@ -1,13 +1,41 @@
 #ifndef FLORA_CHAR_PREDICATES_H
 #define FLORA_CHAR_PREDICATES_H
 
+#include <cstdint>
+
 namespace flora {
 namespace character {
 
 // End of source
 const char32_t EOS = -1;
+// Malformed UTF-8 in source
+const char32_t MALFORMED = -2;
+
+// Unicode-ready character predicates. ASCII characters are classified by
+// kAsciiClassTable, other characters by the XID_Start and XID_Continue
+// bitmaps. The tables live in character-tables.cc, which is generated by
+// tools/character-tables.py.
+
+enum AsciiClass : unsigned char {
+  kIdentifierStart = 1 << 0,
+  kIdentifierBody = 1 << 1,
+  kDecimalDigit = 1 << 2,
+  kHexDigit = 1 << 3,
+  kOctalDigit = 1 << 4,
+  kBinaryDigit = 1 << 5,
+  kWhitespace = 1 << 6
+};
 
-// Unicode-ready character predicates
+// Indexed by byte, bytes above 0x7F have no class
+extern const unsigned char kAsciiClassTable[256];
+
+// Two-level bitmaps: the block index maps the upper bits of a codepoint to
+// a 256-bit block, shared by all blocks with the same content.
+const int kXIDBlockShift = 8;
+const char32_t kXIDLimit = 0xE0200;
+extern const unsigned char kXIDBlockIndex[kXIDLimit >> kXIDBlockShift];
+extern const std::uint32_t kXIDStartBits[];
+extern const std::uint32_t kXIDContinueBits[];
 
 inline char32_t AsciiToLowerCase(char32_t ch) {
   return ch | 0x20;
@@ -19,39 +47,68 @@ inline bool IsInRange(char32_t ch, char32_t lower, char32_t upper) {
       static_cast<unsigned int>(upper - lower);
 }
 
+inline bool IsAscii(char32_t ch) {
+  return ch < 0x80;
+}
+
+inline bool HasAsciiClass(char32_t ch, unsigned char mask) {
+  return IsAscii(ch) && (kAsciiClassTable[ch] & mask) != 0;
+}
+
+inline bool LookupXIDBit(const std::uint32_t *bits, char32_t ch) {
+  if (ch >= kXIDLimit) return false;
+  unsigned block = kXIDBlockIndex[ch >> kXIDBlockShift];
+  unsigned low = ch & ((1 << kXIDBlockShift) - 1);
+  return (bits[block * 8 + (low >> 5)] >> (low & 31)) & 1;
+}
+
+inline bool IsXIDStart(char32_t ch) {
+  return LookupXIDBit(kXIDStartBits, ch);
+}
+
+inline bool IsXIDContinue(char32_t ch) {
+  return LookupXIDBit(kXIDContinueBits, ch);
+}
+
 inline bool IsLineFeed(char32_t ch) {
   return ch == 0xA;
-} 
+}
+
+inline bool IsWhitespace(char32_t ch) {
+  return HasAsciiClass(ch, kWhitespace);
+}
 
 inline bool IsDecimalDigit(char32_t ch) {
-  return IsInRange(ch, '0', '9');
+  return HasAsciiClass(ch, kDecimalDigit);
 }
 
 inline bool IsHexDigit(char32_t ch) {
-  return IsDecimalDigit(ch) || IsInRange(AsciiToLowerCase(ch), 'a', 'f');
+  return HasAsciiClass(ch, kHexDigit);
 }
 
 inline bool IsOctalDigit(char32_t ch) {
-  return IsInRange(ch, '0', '7');
+  return HasAsciiClass(ch, kOctalDigit);
 }
 
 inline bool IsBinaryDigit(char32_t ch) {
-  return ch == '0' || ch == '1';
+  return HasAsciiClass(ch, kBinaryDigit);
 }
 
-inline bool IsAlphaNumeric(uc32 c) {
-  return IsInRange(AsciiToLowerCase(c), 'a', 'z') || IsDecimalDigit(c);
+inline bool IsAlphaNumeric(char32_t ch) {
+  return IsInRange(AsciiToLowerCase(ch), 'a', 'z') || IsDecimalDigit(ch);
 }
 
 inline bool IsIdentifierStart(char32_t ch) {
-  return IsInRange(AsciiToLowerCase(ch), 'a', 'z') || ch == '_';
+  return IsAscii(ch) ? (kAsciiClassTable[ch] & kIdentifierStart) != 0
+                     : IsXIDStart(ch);
 }
 
 inline bool IsIdentifierBody(char32_t ch) {
-  return IsAlphaNumeric(ch) || ch == '_';
+  return IsAscii(ch) ? (kAsciiClassTable[ch] & kIdentifierBody) != 0
+                     : IsXIDContinue(ch);
 }
 
 }
 }
 
-#endif
\ No newline at end of file
+#endif
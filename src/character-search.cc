@@ -0,0 +1,407 @@
+#include "character-search.h"
+#include "character-predicates.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define FLORA_SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+namespace flora {
+namespace character {
+
+namespace {
+
+typedef const char* (*SearchFunction)(const char *begin, const char *end);
+typedef void (*CollectFunction)(const char *begin, const char *end,
+                                std::vector<std::size_t> *starts);
+
+struct SearchKernels {
+  const char *name;
+  SearchFunction skip_whitespace;
+  SearchFunction find_line_feed;
+  SearchFunction find_comment_delimiter;
+  SearchFunction skip_identifier_body;
+  SearchFunction find_string_delimiter;
+  SearchFunction find_non_ascii;
+  CollectFunction collect_line_starts;
+};
+
+// Scalar kernels, also used for the tails of the vector kernels
+
+const char* SkipWhitespaceScalar(const char *p, const char *end) {
+  while (p != end &&
+         (kAsciiClassTable[static_cast<unsigned char>(*p)] & kWhitespace))
+    p++;
+  return p;
+}
+
+const char* FindLineFeedScalar(const char *p, const char *end) {
+  const void *found = std::memchr(p, '\n', end - p);
+  return found ? static_cast<const char*>(found) : end;
+}
+
+const char* FindCommentDelimiterScalar(const char *p, const char *end) {
+  while (p != end && *p != '*' && *p != '/') p++;
+  return p;
+}
+
+const char* SkipIdentifierBodyScalar(const char *p, const char *end) {
+  while (p != end &&
+         (kAsciiClassTable[static_cast<unsigned char>(*p)] & kIdentifierBody))
+    p++;
+  return p;
+}
+
+inline bool IsStringDelimiter(char ch) {
+  return ch == '"' || ch == '\\' || ch == '\n' ||
+      static_cast<unsigned char>(ch) >= 0x80;
+}
+
+const char* FindStringDelimiterScalar(const char *p, const char *end) {
+  while (p != end && !IsStringDelimiter(*p)) p++;
+  return p;
+}
+
+const char* FindNonAsciiScalar(const char *p, const char *end) {
+  while (p != end && static_cast<unsigned char>(*p) < 0x80) p++;
+  return p;
+}
+
+// Makes room for the line starts of [p, end) at the density of the lines
+// before p, so that short lines cost a reallocation or two instead of a
+// pass counting them first. Too few lines to tell just double the room.
+void ReserveLineStarts(const char *origin, const char *p, const char *end,
+                       std::vector<std::size_t> *starts) {
+  const std::ptrdiff_t kSample = 4096;
+  std::size_t room = 2 * starts->capacity() + 64;
+  if (p - origin >= kSample) {
+    double density = static_cast<double>(starts->size()) / (p - origin);
+    room = starts->size() +
+        static_cast<std::size_t>(density * (end - p) * 1.125) + 64;
+  }
+  starts->reserve(room);
+}
+
+void CollectLineStartsFrom(const char *origin, const char *p,
+                           const char *end,
+                           std::vector<std::size_t> *starts) {
+  while ((p = FindLineFeedScalar(p, end)) != end) {
+    p++;
+    if (starts->size() == starts->capacity())
+      ReserveLineStarts(origin, p, end, starts);
+    starts->push_back(p - origin);
+  }
+}
+
+void CollectLineStartsScalar(const char *begin, const char *end,
+                             std::vector<std::size_t> *starts) {
+  CollectLineStartsFrom(begin, begin, end, starts);
+}
+
+const SearchKernels kScalarKernels = {
+  "scalar",
+  SkipWhitespaceScalar,
+  FindLineFeedScalar,
+  FindCommentDelimiterScalar,
+  SkipIdentifierBodyScalar,
+  FindStringDelimiterScalar,
+  FindNonAsciiScalar,
+  CollectLineStartsScalar
+};
+
+#ifdef FLORA_SEARCH_X86
+
+// SSE2 kernels, 16 bytes per step
+
+inline __m128i Splat16(char ch) { return _mm_set1_epi8(ch); }
+
+const char* SkipWhitespaceSSE2(const char *p, const char *end) {
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i blank = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(block, Splat16(' ')),
+                     _mm_cmpeq_epi8(block, Splat16('\t'))),
+        _mm_cmpeq_epi8(block, Splat16('\n')));
+    unsigned mask = ~_mm_movemask_epi8(blank) & 0xFFFFu;
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return SkipWhitespaceScalar(p, end);
+}
+
+const char* FindLineFeedSSE2(const char *p, const char *end) {
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, Splat16('\n')));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return FindLineFeedScalar(p, end);
+}
+
+const char* FindCommentDelimiterSSE2(const char *p, const char *end) {
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned mask = _mm_movemask_epi8(
+        _mm_or_si128(_mm_cmpeq_epi8(block, Splat16('*')),
+                     _mm_cmpeq_epi8(block, Splat16('/'))));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return FindCommentDelimiterScalar(p, end);
+}
+
+// Byte-wise unsigned x <= limit
+inline __m128i LessOrEqual16(__m128i x, char limit) {
+  return _mm_cmpeq_epi8(_mm_min_epu8(x, Splat16(limit)), x);
+}
+
+const char* SkipIdentifierBodySSE2(const char *p, const char *end) {
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i lower = _mm_or_si128(block, Splat16(0x20));
+    __m128i letter = LessOrEqual16(_mm_sub_epi8(lower, Splat16('a')), 25);
+    __m128i digit = LessOrEqual16(_mm_sub_epi8(block, Splat16('0')), 9);
+    __m128i underscore = _mm_cmpeq_epi8(block, Splat16('_'));
+    __m128i body = _mm_or_si128(_mm_or_si128(letter, digit), underscore);
+    unsigned mask = ~_mm_movemask_epi8(body) & 0xFFFFu;
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return SkipIdentifierBodyScalar(p, end);
+}
+
+const char* FindStringDelimiterSSE2(const char *p, const char *end) {
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i delimiter = _mm_or_si128(
+        _mm_or_si128(_mm_cmpeq_epi8(block, Splat16('"')),
+                     _mm_cmpeq_epi8(block, Splat16('\\'))),
+        _mm_cmpeq_epi8(block, Splat16('\n')));
+    // The sign bit of the block marks bytes above 0x7F
+    unsigned mask = _mm_movemask_epi8(_mm_or_si128(delimiter, block));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return FindStringDelimiterScalar(p, end);
+}
+
+const char* FindNonAsciiSSE2(const char *p, const char *end) {
+  for (; end - p >= 16; p += 16) {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned mask = _mm_movemask_epi8(block);
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return FindNonAsciiScalar(p, end);
+}
+
+// Every set bit of the mask is a line feed
+void CollectLineStartsSSE2(const char *begin, const char *end,
+                           std::vector<std::size_t> *starts) {
+  const char *p = begin;
+  for (; end - p >= 16; p += 16) {
+    if (starts->capacity() - starts->size() < 16)
+      ReserveLineStarts(begin, p, end, starts);
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(block, Splat16('\n')));
+    for (; mask; mask &= mask - 1)
+      starts->push_back(p - begin + __builtin_ctz(mask) + 1);
+  }
+  CollectLineStartsFrom(begin, p, end, starts);
+}
+
+const SearchKernels kSSE2Kernels = {
+  "sse2",
+  SkipWhitespaceSSE2,
+  FindLineFeedSSE2,
+  FindCommentDelimiterSSE2,
+  SkipIdentifierBodySSE2,
+  FindStringDelimiterSSE2,
+  FindNonAsciiSSE2,
+  CollectLineStartsSSE2
+};
+
+// AVX2 kernels, 32 bytes per step
+
+#define AVX2 __attribute__((target("avx2")))
+
+AVX2 inline __m256i Splat32(char ch) { return _mm256_set1_epi8(ch); }
+
+AVX2 const char* SkipWhitespaceAVX2(const char *p, const char *end) {
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i blank = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, Splat32(' ')),
+                        _mm256_cmpeq_epi8(block, Splat32('\t'))),
+        _mm256_cmpeq_epi8(block, Splat32('\n')));
+    unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(blank));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return SkipWhitespaceSSE2(p, end);
+}
+
+AVX2 const char* FindLineFeedAVX2(const char *p, const char *end) {
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, Splat32('\n'))));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return FindLineFeedSSE2(p, end);
+}
+
+AVX2 const char* FindCommentDelimiterAVX2(const char *p, const char *end) {
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, Splat32('*')),
+                        _mm256_cmpeq_epi8(block, Splat32('/')))));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return FindCommentDelimiterSSE2(p, end);
+}
+
+AVX2 inline __m256i LessOrEqual32(__m256i x, char limit) {
+  return _mm256_cmpeq_epi8(_mm256_min_epu8(x, Splat32(limit)), x);
+}
+
+AVX2 const char* SkipIdentifierBodyAVX2(const char *p, const char *end) {
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i lower = _mm256_or_si256(block, Splat32(0x20));
+    __m256i letter =
+        LessOrEqual32(_mm256_sub_epi8(lower, Splat32('a')), 25);
+    __m256i digit = LessOrEqual32(_mm256_sub_epi8(block, Splat32('0')), 9);
+    __m256i underscore = _mm256_cmpeq_epi8(block, Splat32('_'));
+    __m256i body =
+        _mm256_or_si256(_mm256_or_si256(letter, digit), underscore);
+    unsigned mask = ~static_cast<unsigned>(_mm256_movemask_epi8(body));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return SkipIdentifierBodySSE2(p, end);
+}
+
+AVX2 const char* FindStringDelimiterAVX2(const char *p, const char *end) {
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i delimiter = _mm256_or_si256(
+        _mm256_or_si256(_mm256_cmpeq_epi8(block, Splat32('"')),
+                        _mm256_cmpeq_epi8(block, Splat32('\\'))),
+        _mm256_cmpeq_epi8(block, Splat32('\n')));
+    unsigned mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_or_si256(delimiter, block)));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return FindStringDelimiterSSE2(p, end);
+}
+
+AVX2 const char* FindNonAsciiAVX2(const char *p, const char *end) {
+  for (; end - p >= 32; p += 32) {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(block));
+    if (mask) return p + __builtin_ctz(mask);
+  }
+  return FindNonAsciiSSE2(p, end);
+}
+
+AVX2 void CollectLineStartsAVX2(const char *begin, const char *end,
+                                std::vector<std::size_t> *starts) {
+  const char *p = begin;
+  for (; end - p >= 32; p += 32) {
+    if (starts->capacity() - starts->size() < 32)
+      ReserveLineStarts(begin, p, end, starts);
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    unsigned mask = static_cast<unsigned>(
+        _mm256_movemask_epi8(_mm256_cmpeq_epi8(block, Splat32('\n'))));
+    for (; mask; mask &= mask - 1)
+      starts->push_back(p - begin + __builtin_ctz(mask) + 1);
+  }
+  CollectLineStartsFrom(begin, p, end, starts);
+}
+
+#undef AVX2
+
+const SearchKernels kAVX2Kernels = {
+  "avx2",
+  SkipWhitespaceAVX2,
+  FindLineFeedAVX2,
+  FindCommentDelimiterAVX2,
+  SkipIdentifierBodyAVX2,
+  FindStringDelimiterAVX2,
+  FindNonAsciiAVX2,
+  CollectLineStartsAVX2
+};
+
+#endif // FLORA_SEARCH_X86
+
+const SearchKernels* DetectKernels() {
+#ifdef FLORA_SEARCH_X86
+  if (__builtin_cpu_supports("avx2")) return &kAVX2Kernels;
+  if (__builtin_cpu_supports("sse2")) return &kSSE2Kernels;
+#endif
+  return &kScalarKernels;
+}
+
+// Resolved on first use
+std::atomic<const SearchKernels*> kernels(nullptr);
+
+inline const SearchKernels* Kernels() {
+  const SearchKernels *selected = kernels.load(std::memory_order_relaxed);
+  if (!selected) {
+    selected = DetectKernels();
+    kernels.store(selected, std::memory_order_relaxed);
+  }
+  return selected;
+}
+
+}
+
+const char* SkipWhitespace(const char *begin, const char *end) {
+  return Kernels()->skip_whitespace(begin, end);
+}
+
+const char* FindLineFeed(const char *begin, const char *end) {
+  return Kernels()->find_line_feed(begin, end);
+}
+
+const char* FindCommentDelimiter(const char *begin, const char *end) {
+  return Kernels()->find_comment_delimiter(begin, end);
+}
+
+const char* SkipIdentifierBody(const char *begin, const char *end) {
+  return Kernels()->skip_identifier_body(begin, end);
+}
+
+const char* FindStringDelimiter(const char *begin, const char *end) {
+  return Kernels()->find_string_delimiter(begin, end);
+}
+
+const char* FindNonAscii(const char *begin, const char *end) {
+  return Kernels()->find_non_ascii(begin, end);
+}
+
+void CollectLineStarts(const char *begin, const char *end,
+                       std::vector<std::size_t> *starts) {
+  Kernels()->collect_line_starts(begin, end, starts);
+}
+
+const char* SearchKernelName() {
+  return Kernels()->name;
+}
+
+bool SelectSearchKernels(const char *name) {
+  const SearchKernels *selected = nullptr;
+  if (std::strcmp(name, "scalar") == 0) {
+    selected = &kScalarKernels;
+#ifdef FLORA_SEARCH_X86
+  } else if (std::strcmp(name, "sse2") == 0) {
+    if (__builtin_cpu_supports("sse2")) selected = &kSSE2Kernels;
+  } else if (std::strcmp(name, "avx2") == 0) {
+    if (__builtin_cpu_supports("avx2")) selected = &kAVX2Kernels;
+#endif
+  }
+  if (!selected) return false;
+  kernels.store(selected, std::memory_order_relaxed);
+  return true;
+}
+
+}
+}
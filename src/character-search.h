@@ -0,0 +1,54 @@
+#ifndef FLORA_CHARACTER_SEARCH_H
+#define FLORA_CHARACTER_SEARCH_H
+
+#include <cstddef>
+#include <vector>
+
+#include "flora.h"
+
+namespace flora {
+namespace character {
+
+// Block search over the source buffer. Each function returns the first
+// position in [begin, end) holding a wanted character, or end if there is
+// none. SSE2 and AVX2 kernels are picked at runtime when the CPU has them.
+
+// Finds the first character which is not a space, tab or line feed
+const char* SkipWhitespace(const char *begin, const char *end);
+
+// Finds the next line feed
+const char* FindLineFeed(const char *begin, const char *end);
+
+// Finds the next '*' or '/', the only characters that matter inside a
+// multiple line comment
+const char* FindCommentDelimiter(const char *begin, const char *end);
+
+// Finds the first byte which is not an ASCII identifier character
+// [A-Za-z0-9_]. Non-ASCII bytes end the run so that the caller can decode
+// them.
+const char* SkipIdentifierBody(const char *begin, const char *end);
+
+// Finds the next '"', '\\' or line feed, or the first byte above 0x7F. The
+// run before it can be taken as it is inside a string literal.
+const char* FindStringDelimiter(const char *begin, const char *end);
+
+// Finds the first byte above 0x7F
+const char* FindNonAscii(const char *begin, const char *end);
+
+// Appends the offset from begin of the character following each line feed
+// in [begin, end), i.e. the start of every line but the first. The vector
+// grows by the density of the lines found so far.
+void CollectLineStarts(const char *begin, const char *end,
+                       std::vector<std::size_t> *starts);
+
+// The name of the kernels in use, e.g. "avx2"
+const char* SearchKernelName();
+
+// Forces the kernels by name ("scalar", "sse2" or "avx2"), returns false if
+// the CPU does not support them. Meant for benchmarks and tests.
+bool SelectSearchKernels(const char *name);
+
+}
+}
+
+#endif
@@ -0,0 +1,98 @@
+#include "character-stream.h"
+
+#include <cerrno>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utf8.h"
+
+namespace flora {
+
+namespace {
+
+const char32_t kReplacementCharacter = 0xFFFD;
+
+}
+
+char32_t FileCharacterStream::DecodeMultibyte(int lead) {
+  char sequence[4] = { static_cast<char>(lead) };
+  int expected = lead >= 0xF0 ? 4 : lead >= 0xE0 ? 3 : lead >= 0xC0 ? 2 : 1;
+  int length = 1;
+  // Take the continuation bytes, but leave any other byte in the stream
+  while (length < expected && (stream_.peek() & 0xC0) == 0x80) {
+    sequence[length++] = static_cast<char>(stream_.get());
+  }
+  char32_t codepoint;
+  if (utf8::Decode(sequence, sequence + length, &codepoint) != length)
+    return kReplacementCharacter;
+  return codepoint;
+}
+
+char32_t MappedFileCharacterStream::DecodeMultibyte() {
+  char32_t codepoint;
+  int length = utf8::Decode(cursor_, end_, &codepoint);
+  if (length == 0) {
+    cursor_++;
+    return kReplacementCharacter;
+  }
+  cursor_ += length;
+  return codepoint;
+}
+
+MappedFileCharacterStream::MappedFileCharacterStream(const char *filename)
+    : open_(false), begin_(nullptr), end_(nullptr), cursor_(nullptr),
+      mapping_(nullptr), mapping_size_(0) {
+  int fd = open(filename, O_RDONLY);
+  if (fd < 0) return;
+  struct stat info;
+  if (fstat(fd, &info) == 0 && S_ISREG(info.st_mode) && info.st_size > 0) {
+    open_ = MapFile(fd, static_cast<std::size_t>(info.st_size));
+  }
+  // Pipes, character devices and empty files go through read()
+  if (!open_) {
+    open_ = ReadFile(fd);
+  }
+  close(fd);
+  cursor_ = begin_;
+}
+
+MappedFileCharacterStream::~MappedFileCharacterStream() {
+  if (mapping_) munmap(mapping_, mapping_size_);
+}
+
+bool MappedFileCharacterStream::MapFile(int fd, std::size_t size) {
+  void *address = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  if (address == MAP_FAILED) return false;
+  // The scanner walks the buffer front to back exactly once
+  madvise(address, size, MADV_SEQUENTIAL);
+  mapping_ = address;
+  mapping_size_ = size;
+  begin_ = static_cast<const char*>(address);
+  end_ = begin_ + size;
+  return true;
+}
+
+bool MappedFileCharacterStream::ReadFile(int fd) {
+  const std::size_t kChunkSize = 64 * 1024;
+  std::size_t length = 0;
+  while (true) {
+    buffer_.resize(length + kChunkSize);
+    ssize_t count = read(fd, &buffer_[length], kChunkSize);
+    if (count < 0) {
+      if (errno == EINTR) continue;
+      buffer_.clear();
+      return false;
+    }
+    if (count == 0) break;
+    length += static_cast<std::size_t>(count);
+  }
+  buffer_.resize(length);
+  begin_ = buffer_.data();
+  end_ = begin_ + length;
+  return true;
+}
+
+}
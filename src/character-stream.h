@@ -1,13 +1,17 @@
 #ifndef FLORA_CHARACTER_STREAM
 #define FLORA_CHARACTER_STREAM
 
+#include <cstddef>
 #include <fstream>
+#include <string>
 
 #include "flora.h"
 #include "character-predicates.h"
 
 namespace flora {
 
+// A stream of Unicode codepoints. File streams decode UTF-8, malformed
+// sequences are replaced with U+FFFD.
 class CharacterStream {
 public:
   NOCOPY_CLASS(CharacterStream)
@@ -24,13 +28,56 @@ public:
   FileCharacterStream(const char *filename) : stream_(filename) { }
 
   virtual char32_t Advance() {
-    if (!stream_) return character::EOS;
-    return stream_.get();
+    int byte = stream_.get();
+    if (byte == std::ifstream::traits_type::eof()) return character::EOS;
+    if (byte < 0x80) return byte;
+    return DecodeMultibyte(byte);
   }
 private:
   std::ifstream stream_;
+  char32_t DecodeMultibyte(int lead);
+};
+
+// Maps the whole file into memory and exposes it as one contiguous buffer.
+// Pipes and other files that cannot be mapped are read into an owned buffer.
+class MappedFileCharacterStream : public CharacterStream {
+public:
+  NOCOPY_CLASS(MappedFileCharacterStream)
+
+  MappedFileCharacterStream(const char *filename);
+  virtual ~MappedFileCharacterStream();
+
+  virtual char32_t Advance() {
+    if (cursor_ == end_) return character::EOS;
+    unsigned char byte = *cursor_;
+    if (byte < 0x80) {
+      cursor_++;
+      return byte;
+    }
+    return DecodeMultibyte();
+  }
+
+  // Returns false if the file could not be opened or read
+  bool IsOpen() const { return open_; }
+  // The source buffer
+  const char* begin() const { return begin_; }
+  const char* end() const { return end_; }
+  std::size_t size() const { return end_ - begin_; }
+private:
+  bool open_;
+  const char *begin_;
+  const char *end_;
+  const char *cursor_;
+  // The mapped region, nullptr if the file was read into buffer_
+  void *mapping_;
+  std::size_t mapping_size_;
+  // Fallback buffer for files that cannot be mapped
+  std::string buffer_;
+  char32_t DecodeMultibyte();
+  bool MapFile(int fd, std::size_t size);
+  bool ReadFile(int fd);
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -13,5 +13,10 @@ NORETURN static void flora_fatal(const char *file, int line, const char *message
 
 #define UNREACHABLE() flora_fatal(__FILE__, __LINE__, "unreachable code")
 #define UNIMPLEMENTED() flora_fatal(__FILE__, __LINE__, "unimplemented code")
+#define CHECK(condition) \
+  do { \
+    if (!(condition)) \
+      flora_fatal(__FILE__, __LINE__, "check failed: " #condition); \
+  } while (false)
 
 #endif
\ No newline at end of file
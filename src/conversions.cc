@@ -0,0 +1,154 @@
+#include "conversions.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+namespace flora {
+
+namespace {
+
+// Converts 8 decimal digits at once, by combining the digit pairs, then
+// the pairs of pairs, then the halves in the high word of a product
+inline std::uint64_t ParseEightDigits(const char *digits) {
+  std::uint64_t chunk;
+  std::memcpy(&chunk, digits, sizeof(chunk));
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  chunk = __builtin_bswap64(chunk);
+#endif
+  chunk -= 0x3030303030303030ull;
+  chunk = chunk * 10 + (chunk >> 8);
+  chunk = ((chunk & 0x000000FF000000FFull) * (100 + (1000000ull << 32)) +
+           ((chunk >> 16) & 0x000000FF000000FFull) * (1 + (10000ull << 32)))
+          >> 32;
+  return chunk;
+}
+
+inline int DigitValue(char ch) {
+  return ch <= '9' ? ch - '0' : (ch | 0x20) - 'a' + 10;
+}
+
+bool DecimalToUint64(const char *p, const char *end, std::uint64_t *value) {
+  // 19 digits always fit, the 20th may not
+  const char *safe_end = end - p > 19 ? p + 19 : end;
+  std::uint64_t result = 0;
+  for (; safe_end - p >= 8; p += 8)
+    result = result * 100000000 + ParseEightDigits(p);
+  for (; p != safe_end; p++)
+    result = result * 10 + (*p - '0');
+  if (p != end) {
+    std::uint64_t digit = *p - '0';
+    if (result > (UINT64_MAX - digit) / 10) return false;
+    result = result * 10 + digit;
+  }
+  *value = result;
+  return true;
+}
+
+// Powers of ten which are exact in a double
+const double kExactPowersOfTen[] = {
+  1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+  1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22
+};
+const int kMaxExactPowerOfTen = 22;
+const std::uint64_t kMaxExactInteger = 1ull << 53;
+
+// The correctly rounded conversion of the C library, which needs a
+// terminated copy of the literal
+double StringToDoubleSlow(const char *begin, const char *end) {
+  char buffer[64];
+  std::size_t length = end - begin;
+  if (length < sizeof(buffer)) {
+    std::memcpy(buffer, begin, length);
+    buffer[length] = '\0';
+    return std::strtod(buffer, nullptr);
+  }
+  std::string copy(begin, end);
+  return std::strtod(copy.c_str(), nullptr);
+}
+
+}
+
+bool StringToUint64(const char *begin, const char *end, int base,
+                    std::uint64_t *value) {
+  while (begin != end && *begin == '0') begin++;
+  if (base == 10) {
+    if (end - begin > 20) return false;
+    return DecimalToUint64(begin, end, value);
+  }
+  int bits = base == 16 ? 4 : base == 8 ? 3 : 1;
+  std::uint64_t result = 0;
+  for (const char *p = begin; p != end; p++) {
+    if (result >> (64 - bits)) return false;
+    result = result << bits | DigitValue(*p);
+  }
+  *value = result;
+  return true;
+}
+
+double StringToDouble(const char *begin, const char *end) {
+  // The significand keeps the first 19 significant digits, the value is
+  // significand * 10^exponent if no nonzero digit was dropped
+  std::uint64_t significand = 0;
+  int digits = 0;
+  int exponent = 0;
+  bool truncated = false;
+  const char *p = begin;
+  for (; p != end && *p >= '0' && *p <= '9'; p++) {
+    if (digits < 19) {
+      significand = significand * 10 + (*p - '0');
+      if (significand) digits++;
+    } else {
+      exponent++;
+      truncated |= *p != '0';
+    }
+  }
+  if (p != end && *p == '.') {
+    for (p++; p != end && *p >= '0' && *p <= '9'; p++) {
+      if (digits < 19) {
+        significand = significand * 10 + (*p - '0');
+        if (significand) digits++;
+        exponent--;
+      } else {
+        truncated |= *p != '0';
+      }
+    }
+  }
+  if (p != end && (*p == 'e' || *p == 'E')) {
+    p++;
+    bool negative = p != end && *p == '-';
+    if (p != end && (*p == '+' || *p == '-')) p++;
+    int value = 0;
+    // Anything beyond the clamp is infinity or zero anyway
+    for (; p != end; p++) {
+      if (value < 100000) value = value * 10 + (*p - '0');
+    }
+    exponent += negative ? -value : value;
+  }
+  if (significand == 0 && !truncated) return 0.0;
+  // Clinger's fast path: both factors are exact, so one rounding gives the
+  // correctly rounded result
+  if (!truncated && significand <= kMaxExactInteger) {
+    double value = static_cast<double>(significand);
+    if (exponent >= 0 && exponent <= kMaxExactPowerOfTen)
+      return value * kExactPowersOfTen[exponent];
+    if (exponent < 0 && exponent >= -kMaxExactPowerOfTen)
+      return value / kExactPowersOfTen[-exponent];
+    // Move some of the power into the significand while it stays exact
+    if (exponent > kMaxExactPowerOfTen &&
+        exponent <= kMaxExactPowerOfTen + 15) {
+      std::uint64_t shifted = significand;
+      for (int i = kMaxExactPowerOfTen; i < exponent; i++) {
+        shifted *= 10;
+        if (shifted > kMaxExactInteger) break;
+      }
+      if (shifted <= kMaxExactInteger) {
+        return static_cast<double>(shifted) *
+            kExactPowersOfTen[kMaxExactPowerOfTen];
+      }
+    }
+  }
+  return StringToDoubleSlow(begin, end);
+}
+
+}
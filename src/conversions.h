@@ -0,0 +1,34 @@
+#ifndef FLORA_CONVERSIONS_H
+#define FLORA_CONVERSIONS_H
+
+#include <cstdint>
+
+#include "flora.h"
+#include "token.h"
+
+namespace flora {
+
+// The value of an integer or real number literal. The type is the
+// narrowest of Token::Int, Token::Unsigned and Token::Long holding an
+// integer, or Token::Double for a real number.
+struct NumberLiteral {
+  Token type;
+  union {
+    std::uint64_t integer;
+    double real;
+  };
+};
+
+// Converts the digits in [begin, end) in the base, which is 2, 8, 10 or
+// 16. The digits must be valid in the base. Returns false if the value
+// does not fit in 64 bits.
+bool StringToUint64(const char *begin, const char *end, int base,
+                    std::uint64_t *value);
+
+// Converts a real number with the syntax of a real number literal to the
+// nearest double. Returns infinity if it is too large.
+double StringToDouble(const char *begin, const char *end);
+
+}
+
+#endif
@@ -0,0 +1,70 @@
+#include "driver.h"
+
+#include <atomic>
+
+namespace flora {
+
+Driver::Driver(unsigned threads) : pool_(threads) {
+  for (unsigned i = 0; i < pool_.threads(); i++)
+    workers_.emplace_back(new Worker());
+}
+
+Driver::~Driver() { }
+
+void Driver::set_lazy(bool lazy) {
+  for (auto &worker : workers_) worker->parser.set_lazy(lazy);
+}
+
+std::size_t Driver::Parse(const std::vector<std::string> &paths) {
+  std::atomic<std::size_t> failed(0);
+  for (const std::string &path : paths) {
+    SourceFile *file = AddFile(path);
+    pool_.Submit([this, file, &failed](unsigned worker) {
+      if (!ParseFile(file, worker)) failed++;
+    });
+  }
+  pool_.Wait();
+  MergeSymbols();
+  return failed;
+}
+
+SourceFile* Driver::AddFile(const std::string &path) {
+  SourceFile *file = new SourceFile();
+  file->path = path;
+  file->unit = nullptr;
+  file->error_position = 0;
+  file->worker = 0;
+  std::lock_guard<std::mutex> lock(files_mutex_);
+  files_.emplace_back(file);
+  return file;
+}
+
+bool Driver::ParseFile(SourceFile *file, unsigned worker) {
+  file->worker = worker;
+  if (!file->stream)
+    file->stream.reset(new MappedFileCharacterStream(file->path.c_str()));
+  if (!file->stream->IsOpen()) {
+    file->error_message = "cannot open " + file->path;
+    return false;
+  }
+  Parser &parser = workers_[worker]->parser;
+  file->unit = parser.Parse(file->stream->begin(), file->stream->size());
+  if (!file->unit) {
+    file->error_message = parser.error_message();
+    file->error_position = parser.error_position();
+    return false;
+  }
+  return true;
+}
+
+void Driver::MergeSymbols() {
+  for (auto &worker : workers_) {
+    for (Symbol symbol = static_cast<Symbol>(worker->global.size());
+         symbol < worker->symbols.size(); symbol++) {
+      worker->global.push_back(
+          symbols_.Intern(worker->symbols.Name(symbol)));
+    }
+  }
+}
+
+}
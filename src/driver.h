@@ -0,0 +1,102 @@
+#ifndef FLORA_DRIVER_H
+#define FLORA_DRIVER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "flora.h"
+#include "ast.h"
+#include "character-stream.h"
+#include "parser.h"
+#include "string-span.h"
+#include "symbol-table.h"
+#include "work-stealing-pool.h"
+#include "zone.h"
+
+namespace flora {
+
+// A file given to the driver, and what parsing it gave
+struct SourceFile {
+  std::string path;
+  // The mapped text, which the tree points into
+  std::unique_ptr<MappedFileCharacterStream> stream;
+  // nullptr if the file could not be read or has a syntax error
+  ast::TranslationUnit *unit;
+  std::string error_message;
+  std::uint32_t error_position;
+  // The worker which parsed the file, the symbols of the tree are those of
+  // its table
+  unsigned worker;
+
+  StringSpan source() const {
+    return stream ? StringSpan(stream->begin(), stream->size()) :
+        StringSpan();
+  }
+};
+
+// Parses many files at once. Each file is a task of a work-stealing pool,
+// and each worker has its own parser, zone and symbol table, so workers
+// share nothing while they parse. The trees of a worker live in its zone
+// until the driver is destroyed. Once the files are parsed, the names of
+// every worker are merged into one table.
+class Driver {
+public:
+  NOCOPY_CLASS(Driver)
+
+  // Zero threads means one per hardware thread
+  explicit Driver(unsigned threads = 0);
+  ~Driver();
+
+  unsigned threads() const { return pool_.threads(); }
+  // Pre-parse function bodies, see Parser::set_lazy()
+  void set_lazy(bool lazy);
+
+  // Parse the files, adding them to files(). Returns how many of them
+  // could not be read or have a syntax error.
+  std::size_t Parse(const std::vector<std::string> &paths);
+
+  // The steps of Parse(), for scheduling files some other way
+  WorkStealingPool* pool() { return &pool_; }
+  // Add a file to files(), safe to call from tasks
+  SourceFile* AddFile(const std::string &path);
+  // Map the file unless it is mapped, then parse it with the parser of the
+  // worker. Returns false if it could not be read or has a syntax error.
+  bool ParseFile(SourceFile *file, unsigned worker);
+  // Intern the names workers added since the last merge, once the tasks
+  // are done
+  void MergeSymbols();
+
+  const std::vector<std::unique_ptr<SourceFile>>& files() const {
+    return files_;
+  }
+  // The names of every file parsed
+  const SymbolTable& symbols() const { return symbols_; }
+  // The symbol in symbols() of a symbol in the tree of the file
+  Symbol GlobalSymbol(const SourceFile &file, Symbol symbol) const {
+    return workers_[file.worker]->global[symbol];
+  }
+private:
+  struct Worker {
+    NOCOPY_CLASS(Worker)
+    Worker() : parser(&zone, &symbols) { }
+    Zone zone;
+    SymbolTable symbols;
+    Parser parser;
+    // The global symbol of each local one
+    std::vector<Symbol> global;
+  };
+  std::vector<std::unique_ptr<Worker>> workers_;
+  std::vector<std::unique_ptr<SourceFile>> files_;
+  std::mutex files_mutex_;
+  SymbolTable symbols_;
+  // Last, so that its threads stop before the workers are destroyed
+  WorkStealingPool pool_;
+};
+
+}
+
+#endif
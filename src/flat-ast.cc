@@ -0,0 +1,309 @@
+#include "flat-ast.h"
+
+namespace flora {
+namespace flat {
+
+void FlatAst::Clear() {
+  types_.clear();
+  ops_.clear();
+  positions_.clear();
+  operands_.clear();
+  extra_.clear();
+  pool_.clear();
+}
+
+StringSpan FlatAst::Text(std::uint32_t offset, std::uint32_t length) const {
+  if (offset & kPoolFlag)
+    return StringSpan(pool_.data() + (offset & ~kPoolFlag), length);
+  return StringSpan(source_.data() + offset, length);
+}
+
+std::size_t FlatAst::ByteSize() const {
+  return types_.size() * (sizeof(ast::NodeType) + sizeof(std::uint8_t) +
+                          sizeof(std::uint32_t) + sizeof(Operands)) +
+      extra_.size() * sizeof(std::uint32_t) + pool_.size();
+}
+
+bool FlatAst::operator== (const FlatAst &other) const {
+  if (source_ != other.source_ || types_ != other.types_ ||
+      ops_ != other.ops_ || positions_ != other.positions_ ||
+      extra_ != other.extra_ || pool_ != other.pool_)
+    return false;
+  for (std::size_t i = 0; i < operands_.size(); i++) {
+    if (operands_[i].lhs != other.operands_[i].lhs ||
+        operands_[i].rhs != other.operands_[i].rhs)
+      return false;
+  }
+  return true;
+}
+
+NodeIndex FlatAst::AddNode(ast::NodeType type, Token op,
+                           std::uint32_t position, std::uint32_t lhs,
+                           std::uint32_t rhs) {
+  types_.push_back(type);
+  ops_.push_back(static_cast<std::uint8_t>(op));
+  positions_.push_back(position);
+  Operands operands = { lhs, rhs };
+  operands_.push_back(operands);
+  return static_cast<NodeIndex>(types_.size() - 1);
+}
+
+std::uint32_t FlatAst::AddList(const NodeIndex *nodes, std::size_t count) {
+  std::uint32_t list = AddExtra(static_cast<std::uint32_t>(count));
+  extra_.insert(extra_.end(), nodes, nodes + count);
+  return list;
+}
+
+void FlatAst::EncodeText(StringSpan text, std::uint32_t *offset,
+                         std::uint32_t *length) {
+  *length = static_cast<std::uint32_t>(text.size());
+  if (text.data() >= source_.begin() && text.end() <= source_.end()) {
+    *offset = static_cast<std::uint32_t>(text.data() - source_.data());
+  } else {
+    *offset = kPoolFlag | static_cast<std::uint32_t>(pool_.size());
+    pool_.append(text.data(), text.size());
+  }
+}
+
+std::uint32_t FlatAst::AddText(StringSpan text) {
+  std::uint32_t offset, length;
+  EncodeText(text, &offset, &length);
+  std::uint32_t index = AddExtra(offset);
+  AddExtra(length);
+  return index;
+}
+
+namespace {
+
+// Emits the children of each node before the node itself. The walk keeps
+// its own stack instead of recursing, so that trees as deep as the parser
+// accepts, such as long operator chains, do not overflow the call stack.
+// Flattened children wait on a second stack until their parent is added.
+class Flattener {
+public:
+  explicit Flattener(FlatAst *flat) : flat_(flat) { }
+
+  NodeIndex Flatten(const ast::Node *root);
+private:
+  // A node to flatten. Once its children are on the work stack it is
+  // expanded and knows their number.
+  struct Work {
+    const ast::Node *node;
+    std::uint32_t children;
+  };
+  static const std::uint32_t kNotExpanded = 0xFFFFFFFFu;
+
+  FlatAst *flat_;
+  std::vector<Work> work_;
+  std::vector<NodeIndex> stack_;
+  std::vector<const ast::Node*> children_;
+
+  // Adds the node, the indices of its children are at child
+  NodeIndex Emit(const ast::Node *node, const NodeIndex *child);
+
+  NodeIndex Add(const ast::Node *node, Token op, std::uint32_t lhs,
+                std::uint32_t rhs) {
+    return flat_->AddNode(node->type(), op, node->position(), lhs, rhs);
+  }
+  NodeIndex Add(const ast::Node *node, std::uint32_t lhs,
+                std::uint32_t rhs) {
+    return Add(node, Token::Illegal, lhs, rhs);
+  }
+  // Stores the next count children as a list
+  std::uint32_t List(const NodeIndex *&child, std::size_t count) {
+    std::uint32_t list = flat_->AddList(child, count);
+    child += count;
+    return list;
+  }
+  // Stores operands which do not fit in lhs and rhs
+  std::uint32_t Extra(std::uint32_t a, std::uint32_t b) {
+    std::uint32_t index = flat_->AddExtra(a);
+    flat_->AddExtra(b);
+    return index;
+  }
+  std::uint32_t DeclarationHeader(const ast::Declaration *declaration) {
+    std::uint32_t header = flat_->AddText(declaration->name());
+    std::uint32_t flags = static_cast<std::uint32_t>(
+        declaration->visibility());
+    if (declaration->is_static()) flags |= FlatAst::kStaticFlag;
+    flat_->AddExtra(flags);
+    return header;
+  }
+};
+
+NodeIndex Flattener::Flatten(const ast::Node *root) {
+  work_.push_back(Work { root, kNotExpanded });
+  while (!work_.empty()) {
+    Work work = work_.back();
+    work_.pop_back();
+    if (!work.node) {
+      stack_.push_back(kNoNode);
+    } else if (work.children == kNotExpanded) {
+      children_.clear();
+      ast::ForEachChild(work.node, [this](const ast::Node *child) {
+        children_.push_back(child);
+      });
+      work.children = static_cast<std::uint32_t>(children_.size());
+      work_.push_back(work);
+      // Reversed, so that the first child is flattened first
+      for (std::size_t i = children_.size(); i > 0; i--)
+        work_.push_back(Work { children_[i - 1], kNotExpanded });
+    } else {
+      std::size_t start = stack_.size() - work.children;
+      NodeIndex index = Emit(work.node, stack_.data() + start);
+      stack_.resize(start);
+      stack_.push_back(index);
+    }
+  }
+  NodeIndex root_index = stack_.back();
+  stack_.clear();
+  return root_index;
+}
+
+NodeIndex Flattener::Emit(const ast::Node *node, const NodeIndex *child) {
+  std::uint32_t offset, length;
+  switch (node->type()) {
+  case ast::NodeType::Literal: {
+    auto literal = static_cast<const ast::Literal*>(node);
+    flat_->EncodeText(literal->literal(), &offset, &length);
+    return Add(node, literal->kind(), offset, length);
+  }
+  case ast::NodeType::Variable:
+    flat_->EncodeText(static_cast<const ast::Variable*>(node)->name(),
+                      &offset, &length);
+    return Add(node, offset, length);
+  case ast::NodeType::ArrayLiteral:
+    return Add(node, List(child,
+        static_cast<const ast::ArrayLiteral*>(node)->elements().size()), 0);
+  case ast::NodeType::Tuple:
+    return Add(node, List(child,
+        static_cast<const ast::Tuple*>(node)->elements().size()), 0);
+  case ast::NodeType::UnaryOperation: {
+    auto unary = static_cast<const ast::UnaryOperation*>(node);
+    return Add(node, unary->op(), child[0], unary->is_postfix());
+  }
+  case ast::NodeType::ArithmeticOperation:
+    return Add(node,
+        static_cast<const ast::ArithmeticOperation*>(node)->op(),
+        child[0], child[1]);
+  case ast::NodeType::CompareOperation:
+    return Add(node, static_cast<const ast::CompareOperation*>(node)->op(),
+               child[0], child[1]);
+  case ast::NodeType::AssignmentOperation:
+    return Add(node,
+        static_cast<const ast::AssignmentOperation*>(node)->op(),
+        child[0], child[1]);
+  case ast::NodeType::Conditional:
+  case ast::NodeType::IfStatement:
+    return Add(node, child[0], Extra(child[1], child[2]));
+  case ast::NodeType::Invoke: {
+    auto invoke = static_cast<const ast::Invoke*>(node);
+    NodeIndex callee = *child++;
+    return Add(node, callee, List(child, invoke->arguments().size()));
+  }
+  case ast::NodeType::Index:
+  case ast::NodeType::Conversion:
+  case ast::NodeType::WhileStatement:
+  case ast::NodeType::DoWhileStatement:
+    return Add(node, child[0], child[1]);
+  case ast::NodeType::MemberAccess:
+    return Add(node, child[0], flat_->AddText(
+        static_cast<const ast::MemberAccess*>(node)->name()));
+  case ast::NodeType::Lambda: {
+    auto lambda = static_cast<const ast::Lambda*>(node);
+    std::uint32_t parameters = List(child, lambda->parameters().size());
+    return Add(node, parameters, *child);
+  }
+  case ast::NodeType::Block:
+    return Add(node, List(child,
+        static_cast<const ast::Block*>(node)->statements().size()), 0);
+  case ast::NodeType::DeclarationStatement:
+  case ast::NodeType::ExpressionStatement:
+  case ast::NodeType::ReturnStatement:
+    return Add(node, child[0], 0);
+  case ast::NodeType::ForStatement: {
+    std::uint32_t operands = Extra(child[0], child[1]);
+    Extra(child[2], child[3]);
+    return Add(node, operands, 0);
+  }
+  case ast::NodeType::CaseClause: {
+    auto clause = static_cast<const ast::CaseClause*>(node);
+    NodeIndex label = *child++;
+    return Add(node, label, List(child, clause->statements().size()));
+  }
+  case ast::NodeType::SwitchStatement: {
+    auto statement = static_cast<const ast::SwitchStatement*>(node);
+    NodeIndex value = *child++;
+    return Add(node, value, List(child, statement->clauses().size()));
+  }
+  case ast::NodeType::BreakStatement:
+  case ast::NodeType::ContinueStatement:
+    return Add(node, 0, 0);
+  case ast::NodeType::TypeSpecifier: {
+    auto type = static_cast<const ast::TypeSpecifier*>(node);
+    std::uint32_t arguments = List(child, type->arguments().size());
+    return Add(node, type->kind(), flat_->AddText(type->name()), arguments);
+  }
+  case ast::NodeType::TranslationUnit:
+    return Add(node, List(child, static_cast<const ast::TranslationUnit*>(
+        node)->declarations().size()), 0);
+  case ast::NodeType::ImportDeclaration: {
+    auto declaration = static_cast<const ast::ImportDeclaration*>(node);
+    std::uint32_t header = DeclarationHeader(declaration);
+    std::uint32_t path = flat_->AddExtra(
+        static_cast<std::uint32_t>(declaration->path().size()));
+    for (StringSpan name : declaration->path()) flat_->AddText(name);
+    return Add(node, header, path);
+  }
+  case ast::NodeType::NamespaceDeclaration: {
+    auto declaration = static_cast<const ast::NamespaceDeclaration*>(node);
+    std::uint32_t declarations =
+        List(child, declaration->declarations().size());
+    return Add(node, DeclarationHeader(declaration), declarations);
+  }
+  case ast::NodeType::ClassDeclaration: {
+    auto declaration = static_cast<const ast::ClassDeclaration*>(node);
+    std::uint32_t bases = List(child, declaration->bases().size());
+    std::uint32_t members = List(child, declaration->members().size());
+    std::uint32_t header = DeclarationHeader(declaration);
+    return Add(node, header, Extra(bases, members));
+  }
+  case ast::NodeType::FunctionDeclaration: {
+    auto declaration = static_cast<const ast::FunctionDeclaration*>(node);
+    std::uint32_t parameters =
+        List(child, declaration->parameters().size());
+    std::uint32_t header = DeclarationHeader(declaration);
+    std::uint32_t operands = Extra(parameters, child[0]);
+    flat_->AddExtra(child[1]);
+    return Add(node, header, operands);
+  }
+  case ast::NodeType::VariableDeclaration:
+  case ast::NodeType::ConstantDeclaration: {
+    std::uint32_t header =
+        DeclarationHeader(static_cast<const ast::Declaration*>(node));
+    return Add(node, header, Extra(child[0], child[1]));
+  }
+  }
+  UNREACHABLE();
+}
+
+}
+
+void Flatten(const ast::TranslationUnit *unit, StringSpan source,
+             FlatAst *flat) {
+  flat->Clear();
+  flat->set_source(source);
+  Flattener flattener(flat);
+  flattener.Flatten(unit);
+}
+
+bool SameTree(const ast::TranslationUnit *a, const ast::TranslationUnit *b,
+              StringSpan source) {
+  FlatAst flat_a, flat_b;
+  Flatten(a, source, &flat_a);
+  Flatten(b, source, &flat_b);
+  return flat_a == flat_b;
+}
+
+}
+}
@@ -0,0 +1,267 @@
+#ifndef FLORA_FLAT_AST_H
+#define FLORA_FLAT_AST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "flora.h"
+#include "ast.h"
+#include "string-span.h"
+#include "token.h"
+
+namespace flora {
+namespace flat {
+
+typedef std::uint32_t NodeIndex;
+
+// Marks a missing child, such as the else branch of an if statement
+const NodeIndex kNoNode = 0xFFFFFFFFu;
+
+// A syntax tree stored as parallel arrays. Each node has a type, an
+// operator or token kind, a position and two 32-bit operands. Children are
+// referred to by index, lists and nodes with more than two operands keep
+// them in the shared extra array. Nodes are stored in post-order, children
+// before their parent, so a loop over the indices is a bottom-up walk and
+// the last node is the translation unit.
+//
+// Operands by node type, [a, b] is a slice of extra at the operand:
+//   Literal, Variable          text
+//   ArrayLiteral, Tuple        list of elements
+//   UnaryOperation             operand, 1 if postfix
+//   Arithmetic-, Compare-,
+//   AssignmentOperation        left, right
+//   Conditional                condition, [then, else]
+//   Invoke                     callee, list of arguments
+//   Index                      object, index
+//   MemberAccess               object, [text]
+//   Conversion                 type, expression
+//   Lambda                     list of parameters, body
+//   Block                      list of statements
+//   DeclarationStatement,
+//   ExpressionStatement,
+//   ReturnStatement            child
+//   IfStatement                condition, [then, else]
+//   ForStatement               [initializer, condition, step, body]
+//   WhileStatement             condition, body
+//   DoWhileStatement           body, condition
+//   CaseClause                 label, list of statements
+//   SwitchStatement            value, list of clauses
+//   TypeSpecifier              [text], list of arguments
+//   TranslationUnit            list of declarations
+//   Declarations               [name text, flags], then
+//     ImportDeclaration          [count, text...] of the path
+//     NamespaceDeclaration       list of declarations
+//     ClassDeclaration           [list of bases, list of members]
+//     FunctionDeclaration        [list of parameters, return type, body]
+//     Variable-, Constant-       [type, initializer]
+// A list is a count followed by the node indices in extra. A text is an
+// offset and a length in the source, or in the string pool if the offset
+// has kPoolFlag set.
+class FlatAst {
+public:
+  NOCOPY_CLASS(FlatAst)
+
+  FlatAst() = default;
+
+  std::size_t size() const { return types_.size(); }
+  bool empty() const { return types_.empty(); }
+  NodeIndex root() const { return static_cast<NodeIndex>(size() - 1); }
+  void Clear();
+
+  StringSpan source() const { return source_; }
+  void set_source(StringSpan source) { source_ = source; }
+
+  ast::NodeType type(NodeIndex node) const { return types_[node]; }
+  Token op(NodeIndex node) const { return static_cast<Token>(ops_[node]); }
+  std::uint32_t position(NodeIndex node) const { return positions_[node]; }
+  std::uint32_t lhs(NodeIndex node) const { return operands_[node].lhs; }
+  std::uint32_t rhs(NodeIndex node) const { return operands_[node].rhs; }
+  std::uint32_t extra(std::uint32_t index) const { return extra_[index]; }
+
+  // A list in extra: its size and its elements
+  std::uint32_t ListSize(std::uint32_t list) const { return extra_[list]; }
+  NodeIndex ListAt(std::uint32_t list, std::uint32_t index) const {
+    return extra_[list + 1 + index];
+  }
+  // A text stored as two words starting at the index
+  StringSpan Text(std::uint32_t offset, std::uint32_t length) const;
+  StringSpan ExtraText(std::uint32_t index) const {
+    return Text(extra_[index], extra_[index + 1]);
+  }
+
+  // The name of a declaration and its visibility and static flags
+  StringSpan DeclarationName(NodeIndex node) const {
+    return ExtraText(lhs(node));
+  }
+  std::uint32_t DeclarationFlags(NodeIndex node) const {
+    return extra_[lhs(node) + 2];
+  }
+  static const std::uint32_t kStaticFlag = 1u << 8;
+
+  // Calls f with every child of the node, in source order. Missing
+  // children are skipped.
+  template <typename F>
+  void ForEachChild(NodeIndex node, F f) const;
+
+  // Memory held by the arrays, for comparing with the pointer tree
+  std::size_t ByteSize() const;
+
+  // Trees are equal if their sources are and they have the same nodes,
+  // operands and extra words, so also the same names and texts
+  bool operator== (const FlatAst &other) const;
+  bool operator!= (const FlatAst &other) const { return !(*this == other); }
+
+  // Building, used by the flattener and the parser
+  NodeIndex AddNode(ast::NodeType type, Token op, std::uint32_t position,
+                    std::uint32_t lhs, std::uint32_t rhs);
+  std::uint32_t AddExtra(std::uint32_t value) {
+    extra_.push_back(value);
+    return static_cast<std::uint32_t>(extra_.size() - 1);
+  }
+  std::uint32_t AddList(const NodeIndex *nodes, std::size_t count);
+  // Appends a text as two words of extra, returns the index of the first
+  std::uint32_t AddText(StringSpan text);
+  void EncodeText(StringSpan text, std::uint32_t *offset,
+                  std::uint32_t *length);
+
+  static const std::uint32_t kPoolFlag = 0x80000000u;
+private:
+  struct Operands {
+    std::uint32_t lhs;
+    std::uint32_t rhs;
+  };
+  StringSpan source_;
+  std::vector<ast::NodeType> types_;
+  std::vector<std::uint8_t> ops_;
+  std::vector<std::uint32_t> positions_;
+  std::vector<Operands> operands_;
+  std::vector<std::uint32_t> extra_;
+  // Texts which are not in the source, such as decoded string literals
+  std::string pool_;
+  template <typename F>
+  void ForEachInList(std::uint32_t list, F f) const {
+    std::uint32_t count = extra_[list];
+    for (std::uint32_t i = 0; i < count; i++) f(extra_[list + 1 + i]);
+  }
+};
+
+// Converts a pointer tree into a flat tree
+void Flatten(const ast::TranslationUnit *unit, StringSpan source,
+             FlatAst *flat);
+
+// Returns true if two pointer trees of the source flatten to equal trees
+bool SameTree(const ast::TranslationUnit *a, const ast::TranslationUnit *b,
+              StringSpan source);
+
+// Visits the nodes of a flat tree in storage order, which touches the
+// arrays front to back. Subclasses define Visit<Type>(NodeIndex) for the
+// node types they are interested in.
+template <typename Subclass>
+class FlatAstVisitor {
+public:
+  explicit FlatAstVisitor(const FlatAst *ast) : ast_(ast) { }
+
+  void VisitAll() {
+    std::size_t count = ast_->size();
+    for (NodeIndex node = 0; node < count; node++) Visit(node);
+  }
+
+  void Visit(NodeIndex node) {
+    switch (ast_->type(node)) {
+#define V(name)\
+    case ast::NodeType::name:\
+      static_cast<Subclass*>(this)->Visit##name(node);\
+      break;
+    AST_NODE_LIST(V)
+#undef V
+    }
+  }
+
+#define V(name) void Visit##name(NodeIndex) { }
+  AST_NODE_LIST(V)
+#undef V
+protected:
+  const FlatAst *ast_;
+};
+
+template <typename F>
+void FlatAst::ForEachChild(NodeIndex node, F f) const {
+  std::uint32_t a = lhs(node);
+  std::uint32_t b = rhs(node);
+  auto child = [&f](NodeIndex index) { if (index != kNoNode) f(index); };
+  switch (type(node)) {
+  case ast::NodeType::Literal:
+  case ast::NodeType::Variable:
+  case ast::NodeType::BreakStatement:
+  case ast::NodeType::ContinueStatement:
+  case ast::NodeType::ImportDeclaration:
+    break;
+  case ast::NodeType::ArrayLiteral:
+  case ast::NodeType::Tuple:
+  case ast::NodeType::Block:
+  case ast::NodeType::TranslationUnit:
+    ForEachInList(a, child);
+    break;
+  case ast::NodeType::UnaryOperation:
+  case ast::NodeType::MemberAccess:
+  case ast::NodeType::DeclarationStatement:
+  case ast::NodeType::ExpressionStatement:
+  case ast::NodeType::ReturnStatement:
+    child(a);
+    break;
+  case ast::NodeType::ArithmeticOperation:
+  case ast::NodeType::CompareOperation:
+  case ast::NodeType::AssignmentOperation:
+  case ast::NodeType::Index:
+  case ast::NodeType::Conversion:
+  case ast::NodeType::WhileStatement:
+  case ast::NodeType::DoWhileStatement:
+    child(a);
+    child(b);
+    break;
+  case ast::NodeType::Conditional:
+  case ast::NodeType::IfStatement:
+    child(a);
+    child(extra_[b]);
+    child(extra_[b + 1]);
+    break;
+  case ast::NodeType::Invoke:
+  case ast::NodeType::CaseClause:
+  case ast::NodeType::SwitchStatement:
+    child(a);
+    ForEachInList(b, child);
+    break;
+  case ast::NodeType::Lambda:
+    ForEachInList(a, child);
+    child(b);
+    break;
+  case ast::NodeType::ForStatement:
+    for (int i = 0; i < 4; i++) child(extra_[a + i]);
+    break;
+  case ast::NodeType::TypeSpecifier:
+  case ast::NodeType::NamespaceDeclaration:
+    ForEachInList(b, child);
+    break;
+  case ast::NodeType::ClassDeclaration:
+    ForEachInList(extra_[b], child);
+    ForEachInList(extra_[b + 1], child);
+    break;
+  case ast::NodeType::FunctionDeclaration:
+    ForEachInList(extra_[b], child);
+    child(extra_[b + 1]);
+    child(extra_[b + 2]);
+    break;
+  case ast::NodeType::VariableDeclaration:
+  case ast::NodeType::ConstantDeclaration:
+    child(extra_[b]);
+    child(extra_[b + 1]);
+    break;
+  }
+}
+
+}
+}
+
+#endif
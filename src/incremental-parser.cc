@@ -0,0 +1,285 @@
+#include "incremental-parser.h"
+
+#include <algorithm>
+
+namespace flora {
+
+using namespace ast;
+
+namespace {
+
+// Where a position of the source before the edit is after it. Only the
+// positions outside the removed text are moved.
+std::uint32_t MovePosition(std::uint32_t position, const TextEdit &edit) {
+  return position >= edit.offset + edit.removed ?
+      static_cast<std::uint32_t>(position + edit.inserted - edit.removed) :
+      position;
+}
+
+bool IsDeclaration(NodeType type) {
+  switch (type) {
+#define V(name) case NodeType::name:
+  DECLARATION_NODE_LIST(V)
+#undef V
+    return true;
+  default:
+    return false;
+  }
+}
+
+// The edit which moves nodes by the shift. Pending nodes are all after
+// the edits which shifted them.
+TextEdit ShiftEdit(std::ptrdiff_t shift) {
+  std::size_t distance = static_cast<std::size_t>(shift < 0 ? -shift : shift);
+  return shift < 0 ? TextEdit { 0, distance, 0 } : TextEdit { 0, 0, distance };
+}
+
+// The members of a namespace or a class
+ZoneSpan<Declaration*> Members(Declaration *declaration) {
+  if (declaration->IsNamespaceDeclaration())
+    return static_cast<NamespaceDeclaration*>(declaration)->declarations();
+  if (declaration->IsClassDeclaration())
+    return static_cast<ClassDeclaration*>(declaration)->members();
+  return ZoneSpan<Declaration*>();
+}
+
+}
+
+IncrementalParser::IncrementalParser(SymbolTable *symbols)
+    : parser_(&zone_, symbols), unit_(nullptr), reparsed_(nullptr),
+      source_limit_(nullptr), parsed_bytes_(0) { }
+
+TranslationUnit* IncrementalParser::unit() {
+  SettleAll();
+  return unit_;
+}
+
+TranslationUnit* IncrementalParser::Parse(const char *source,
+                                          std::size_t length) {
+  reparsed_ = nullptr;
+  pending_.clear();
+  zone_.Reset();
+  unit_ = parser_.Parse(source, length);
+  source_ = StringSpan(source, length);
+  source_limit_ = source + length;
+  parsed_bytes_ = zone_.allocation_size();
+  return unit_;
+}
+
+bool IncrementalParser::Reparse(const char *source, std::size_t length,
+                                const TextEdit &edit) {
+  if (!unit_ || zone_.allocation_size() > 2 * parsed_bytes_)
+    return Parse(source, length) != nullptr;
+  FindEnclosing(edit);
+  std::ptrdiff_t shift = static_cast<std::ptrdiff_t>(edit.inserted) -
+      static_cast<std::ptrdiff_t>(edit.removed);
+  // From the innermost declaration outwards
+  for (std::size_t level = enclosing_.size(); level > 0; level--) {
+    Enclosing &enclosing = enclosing_[level - 1];
+    Declaration *old = enclosing.list[enclosing.index];
+    std::ptrdiff_t pending = Pending(old);
+    enclosing.scope->Remove(old);
+    Declaration *fresh = parser_.ParseDeclarationAt(
+        source, length, static_cast<std::size_t>(old->position() + pending),
+        enclosing.scope);
+    // An edit of the first token can make it a modifier, which only the
+    // parent parses. Any other error is found again by the parent.
+    if (!fresh) {
+      enclosing.scope->Declare(old);
+      continue;
+    }
+    if (fresh->end_position() == old->end_position() + pending + shift) {
+      // The modifiers before the declaration were not edited
+      fresh->set_visibility(old->visibility());
+      fresh->set_static(old->is_static());
+      enclosing.list[enclosing.index] = fresh;
+      pending_.erase(old);
+      reparsed_ = fresh;
+      Rebase(StringSpan(source, length), edit, level - 1);
+      source_ = StringSpan(source, length);
+      return true;
+    }
+    // The edit changed where the declaration ends, try its parent
+    enclosing.scope->Remove(fresh);
+    enclosing.scope->Declare(old);
+  }
+  return Parse(source, length) != nullptr;
+}
+
+void IncrementalParser::FindEnclosing(const TextEdit &edit) {
+  enclosing_.clear();
+  ZoneSpan<Declaration*> list = unit_->declarations();
+  Scope *scope = unit_->scope();
+  std::size_t edit_end = edit.offset + edit.removed;
+  while (true) {
+    // The last declaration starting before the edit, declarations are in
+    // source order. The edit must be inside it, an edit touching its first
+    // or last character may join tokens with its neighbours.
+    auto after = std::upper_bound(list.begin(), list.end(), edit.offset,
+        [this](std::size_t offset, Declaration *declaration) {
+          return static_cast<std::ptrdiff_t>(offset) <=
+              declaration->position() + Pending(declaration);
+        });
+    if (after == list.begin()) return;
+    std::size_t index = after - list.begin() - 1;
+    Declaration *declaration = list[index];
+    if (static_cast<std::ptrdiff_t>(edit_end) >=
+        declaration->end_position() + Pending(declaration))
+      return;
+    Enclosing enclosing = { list, scope, index };
+    enclosing_.push_back(enclosing);
+    if (declaration->IsNamespaceDeclaration()) {
+      auto *space = static_cast<NamespaceDeclaration*>(declaration);
+      Settle(space);
+      list = space->declarations();
+      scope = space->scope();
+    } else if (declaration->IsClassDeclaration()) {
+      auto *klass = static_cast<ClassDeclaration*>(declaration);
+      Settle(klass);
+      list = klass->members();
+      scope = klass->scope();
+    } else {
+      return;
+    }
+  }
+}
+
+std::ptrdiff_t IncrementalParser::Pending(Declaration *declaration) const {
+  auto found = pending_.find(declaration);
+  return found == pending_.end() ? 0 : found->second;
+}
+
+void IncrementalParser::Defer(std::size_t level, std::ptrdiff_t shift) {
+  for (std::size_t i = 0; i <= level; i++) {
+    const Enclosing &enclosing = enclosing_[i];
+    for (std::size_t j = enclosing.index + 1; j < enclosing.list.size(); j++)
+      pending_[enclosing.list[j]] += shift;
+    if (i < level) {
+      // Settled when it was found
+      Declaration *outer = enclosing.list[enclosing.index];
+      outer->set_end_position(
+          static_cast<std::uint32_t>(outer->end_position() + shift));
+    }
+  }
+}
+
+void IncrementalParser::Settle(Declaration *declaration) {
+  auto found = pending_.find(declaration);
+  if (found == pending_.end()) return;
+  std::ptrdiff_t shift = found->second;
+  pending_.erase(found);
+  if (shift == 0) return;
+  TextEdit edit = ShiftEdit(shift);
+  ZoneSpan<Declaration*> members = Members(declaration);
+  RebaseNode(declaration, source_, edit);
+  // The members were pushed last, they keep the shift for later
+  stack_.resize(stack_.size() - members.size());
+  for (Declaration *member : members) pending_[member] += shift;
+  RebaseStack(source_, edit);
+}
+
+void IncrementalParser::SettleAll() {
+  if (pending_.empty()) return;
+  // Outer declarations first, they pass their shift on to their members
+  declarations_.assign(unit_->declarations().begin(),
+                       unit_->declarations().end());
+  while (!declarations_.empty()) {
+    Declaration *declaration = declarations_.back();
+    declarations_.pop_back();
+    Settle(declaration);
+    ZoneSpan<Declaration*> members = Members(declaration);
+    declarations_.insert(declarations_.end(), members.begin(), members.end());
+  }
+  // Whatever is left belongs to replaced declarations
+  pending_.clear();
+}
+
+void IncrementalParser::Rebase(StringSpan source, const TextEdit &edit,
+                               std::size_t level) {
+  if (source.data() == source_.data()) {
+    std::ptrdiff_t shift = static_cast<std::ptrdiff_t>(edit.inserted) -
+        static_cast<std::ptrdiff_t>(edit.removed);
+    // Nothing moves when a character was replaced
+    if (shift != 0) Defer(level, shift);
+    source_limit_ = std::max(source_limit_, source.end());
+    return;
+  }
+  // Every name points into the old source
+  SettleAll();
+  stack_.push_back(unit_);
+  RebaseStack(source, edit);
+  source_limit_ = source.end();
+}
+
+void IncrementalParser::RebaseStack(StringSpan source, const TextEdit &edit) {
+  while (!stack_.empty()) {
+    Node *node = stack_.back();
+    stack_.pop_back();
+    if (node != reparsed_) RebaseNode(node, source, edit);
+  }
+}
+
+void IncrementalParser::RebaseNode(Node *node, StringSpan source,
+                                   const TextEdit &edit) {
+  // Names and literals decoded into the zone stay
+  auto move = [&](StringSpan span) {
+    if (span.data() < source_.begin() || span.data() > source_limit_)
+      return span;
+    std::uint32_t offset = MovePosition(
+        static_cast<std::uint32_t>(span.data() - source_.data()), edit);
+    return StringSpan(source.data() + offset, span.size());
+  };
+  node->set_position(MovePosition(node->position(), edit));
+  if (IsDeclaration(node->type())) {
+    auto *declaration = static_cast<Declaration*>(node);
+    declaration->set_name(move(declaration->name()));
+    if (declaration->end_position() != 0) {
+      declaration->set_end_position(
+          MovePosition(declaration->end_position(), edit));
+    }
+  }
+  // The fields which point into the source, the children follow
+  switch (node->type()) {
+  case NodeType::ImportDeclaration:
+    for (StringSpan &name : static_cast<ImportDeclaration*>(node)->path())
+      name = move(name);
+    break;
+  case NodeType::FunctionDeclaration: {
+    auto *function = static_cast<FunctionDeclaration*>(node);
+    if (function->is_lazy()) {
+      function->set_lazy_body(
+          MovePosition(function->body_position(), edit),
+          move(function->lazy_body()), function->free_variables());
+    }
+    break;
+  }
+  case NodeType::Literal: {
+    auto *literal = static_cast<Literal*>(node);
+    literal->set_literal(move(literal->literal()));
+    break;
+  }
+  case NodeType::Variable: {
+    auto *variable = static_cast<Variable*>(node);
+    variable->set_name(move(variable->name()));
+    break;
+  }
+  case NodeType::MemberAccess: {
+    auto *access = static_cast<MemberAccess*>(node);
+    access->set_name(move(access->name()));
+    break;
+  }
+  case NodeType::TypeSpecifier: {
+    auto *type = static_cast<TypeSpecifier*>(node);
+    type->set_name(move(type->name()));
+    break;
+  }
+  default:
+    break;
+  }
+  // Members of classes come last, Settle() relies on it
+  ForEachChild(node, [this](Node *child) {
+    if (child) stack_.push_back(child);
+  });
+}
+
+}
@@ -0,0 +1,103 @@
+#ifndef FLORA_INCREMENTAL_PARSER_H
+#define FLORA_INCREMENTAL_PARSER_H
+
+#include <cstddef>
+#include <cstdint>
+#include <unordered_map>
+#include <vector>
+
+#include "flora.h"
+#include "ast.h"
+#include "incremental-tokenizer.h"
+#include "parser.h"
+#include "scope.h"
+#include "symbol-table.h"
+#include "zone.h"
+
+namespace flora {
+
+// Keeps the tree of a source up to date while it is edited. An edit is
+// reparsed by the innermost declaration of the translation unit, of a
+// namespace or of a class which contains it, such as the function whose
+// body changed. The new declaration replaces the old one in the list and
+// the scope of its parent, if it ends where the old one ended after the
+// edit. Otherwise the parent is reparsed, up to the whole source.
+//
+// Every other node is kept. The nodes after the edit have their positions
+// and the names they point to in the source moved by the edit, those
+// before it only if the source moved. Unless it moved, the declarations
+// after the edit in each list around it only take a pending shift, and
+// their nodes are moved when the tree is read through unit(). An edit thus
+// costs the reparsed declaration and the declarations after it in the
+// lists around it, not the nodes after it. Replaced nodes stay in the zone
+// until it holds twice the bytes of a full parse, then the next edit
+// parses the whole source into a fresh zone.
+class IncrementalParser {
+public:
+  NOCOPY_CLASS(IncrementalParser)
+
+  explicit IncrementalParser(SymbolTable *symbols);
+
+  // For the lazy mode and the errors of the last parse
+  Parser* parser() { return &parser_; }
+  // The tree, with the pending shifts applied to its nodes. nullptr if the
+  // last parse failed.
+  ast::TranslationUnit* unit();
+
+  // Parse the whole source, which must outlive the tree
+  ast::TranslationUnit* Parse(const char *source, std::size_t length);
+
+  // Update the tree after an edit, the source is the text after it. The
+  // text before the edit may already be released. Returns false if there
+  // is a syntax error, the next edit then parses the whole source.
+  bool Reparse(const char *source, std::size_t length, const TextEdit &edit);
+
+  // The declaration the last Reparse replaced, nullptr if it parsed the
+  // whole source. Its nodes are up to date without unit().
+  ast::Declaration* reparsed() const { return reparsed_; }
+private:
+  Zone zone_;
+  Parser parser_;
+  ast::TranslationUnit *unit_;
+  ast::Declaration *reparsed_;
+  // The source of the tree
+  StringSpan source_;
+  // The end of the longest source seen at the address of source_. Names
+  // not yet moved may point up to it.
+  const char *source_limit_;
+  // The zone bytes of the last full parse
+  std::size_t parsed_bytes_;
+
+  // A declaration which contains the edit, in the list of its parent
+  struct Enclosing {
+    ZoneSpan<ast::Declaration*> list;
+    Scope *scope;
+    std::size_t index;
+  };
+  std::vector<Enclosing> enclosing_;
+  std::vector<ast::Node*> stack_;
+  // Declarations of the lists whose nodes have yet to move by the shift
+  std::unordered_map<ast::Declaration*, std::ptrdiff_t> pending_;
+  std::vector<ast::Declaration*> declarations_;
+
+  void FindEnclosing(const TextEdit &edit);
+  std::ptrdiff_t Pending(ast::Declaration *declaration) const;
+  // Shift the declarations after the edit in the lists of the enclosing
+  // declarations up to the level, and the ends of those outside it
+  void Defer(std::size_t level, std::ptrdiff_t shift);
+  // Apply the pending shift of the declaration. Namespaces and classes
+  // move themselves and pass the shift on to their members.
+  void Settle(ast::Declaration *declaration);
+  void SettleAll();
+  // Move the positions and source names of the nodes other than the
+  // reparsed one, at the level of the enclosing declarations, to the new
+  // source
+  void Rebase(StringSpan source, const TextEdit &edit, std::size_t level);
+  // Move the nodes on the stack and everything below them
+  void RebaseStack(StringSpan source, const TextEdit &edit);
+  void RebaseNode(ast::Node *node, StringSpan source, const TextEdit &edit);
+};
+
+}
+
+#endif
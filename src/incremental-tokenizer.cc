@@ -0,0 +1,56 @@
+#include "incremental-tokenizer.h"
+
+#include <algorithm>
+
+namespace flora {
+
+TokenEdit IncrementalTokenizer::Relex(const char *source, std::size_t length,
+                                      const TextEdit &edit,
+                                      TokenBuffer *tokens) {
+  std::size_t count = tokens->size();
+  // The first token whose scan could read the edited text. The tokens end
+  // in increasing order, so it is found by a binary search.
+  std::size_t low = 0, high = count;
+  while (low < high) {
+    std::size_t middle = low + (high - low) / 2;
+    if (tokens->end(middle) + kLookahead > edit.offset) {
+      high = middle;
+    } else {
+      low = middle + 1;
+    }
+  }
+  std::size_t first = low;
+  // An error may have been found anywhere after its token started
+  if (count > 0 && tokens->kind(count - 1) == Token::Illegal)
+    first = std::min(first, count - 1);
+  std::size_t resume = first > 0 ? tokens->end(first - 1) : 0;
+  std::ptrdiff_t shift = static_cast<std::ptrdiff_t>(edit.inserted) -
+      static_cast<std::ptrdiff_t>(edit.removed);
+  std::size_t edit_end = edit.offset + edit.inserted;
+
+  scanner_.Initialize(source, length, resume);
+  relexed_.Clear();
+  relexed_.set_source(StringSpan(source, length));
+  std::size_t old = first;
+  while (true) {
+    Token token = scanner_.Advance();
+    std::size_t offset = scanner_.GetTokenOffset();
+    if (offset >= edit_end) {
+      // Past the edit both sources are the same text, so a token starting
+      // at the same place starts the same tokens
+      std::size_t old_offset = offset - shift;
+      while (old < count && tokens->offset(old) < old_offset) old++;
+      if (old < count && tokens->offset(old) == old_offset) break;
+    }
+    scanner_.AppendToken(&relexed_, token);
+    if (token == Token::EndOfSource || token == Token::Illegal) {
+      old = count;
+      break;
+    }
+  }
+  tokens->Splice(first, old, relexed_, shift);
+  tokens->set_source(StringSpan(source, length));
+  return TokenEdit { first, old - first, relexed_.size() };
+}
+
+}
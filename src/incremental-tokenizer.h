@@ -0,0 +1,56 @@
+#ifndef FLORA_INCREMENTAL_TOKENIZER_H
+#define FLORA_INCREMENTAL_TOKENIZER_H
+
+#include <cstddef>
+
+#include "flora.h"
+#include "scanner.h"
+#include "token-buffer.h"
+
+namespace flora {
+
+// A change of a source: the removed bytes at the offset were replaced by
+// the inserted ones
+struct TextEdit {
+  std::size_t offset;
+  std::size_t removed;
+  std::size_t inserted;
+};
+
+// The tokens a relex replaced: [begin, begin + removed) of the old tokens
+// became [begin, begin + inserted) of the new ones
+struct TokenEdit {
+  std::size_t begin;
+  std::size_t removed;
+  std::size_t inserted;
+};
+
+// Updates the tokens of a source after an edit. Since the scanner carries
+// no state from one token to the next, the tokens which end well before
+// the edit stay, and scanning resumes after the last of them. Once a new
+// token starts past the inserted text where an old token started, the
+// rest of the old tokens is right and only their offsets move. An edit
+// which opens or closes a comment or a string relexes until the next
+// token both versions agree on, and no further. The result is identical
+// to Scanner::TokenizeAll() on the new source.
+class IncrementalTokenizer {
+public:
+  NOCOPY_CLASS(IncrementalTokenizer)
+
+  IncrementalTokenizer() = default;
+
+  // The tokens must be those of the source before the edit, the source is
+  // the text after it and must outlive the tokens
+  TokenEdit Relex(const char *source, std::size_t length,
+                  const TextEdit &edit, TokenBuffer *tokens);
+private:
+  // The scanner decodes up to one character past the end of a token
+  static const std::size_t kLookahead = 4;
+  Scanner scanner_;
+  // The relexed tokens, kept for their capacity
+  TokenBuffer relexed_;
+};
+
+}
+
+#endif
@@ -0,0 +1,66 @@
+#include "line-table.h"
+
+#include <algorithm>
+
+#include "character-search.h"
+
+namespace flora {
+
+void LineTable::Reset(StringSpan source) {
+  source_ = source;
+  built_ = false;
+  line_starts_.clear();
+}
+
+void LineTable::Build() {
+  const char *begin = source_.begin();
+  const char *end = source_.end();
+  // Lines of source tend to be longer than 32 bytes, the kernel grows the
+  // vector for denser ones. Counting them first would read the source
+  // twice.
+  line_starts_.reserve((end - begin) / 32 + 1);
+  line_starts_.push_back(0);
+  character::CollectLineStarts(begin, end, &line_starts_);
+  last_line_ = 1;
+  built_ = true;
+}
+
+SourceLocation LineTable::Locate(std::size_t offset) {
+  if (!built_) Build();
+  offset = std::min(offset, source_.size());
+  // Diagnostics tend to ask for nearby offsets, try the last line first
+  std::size_t line = last_line_;
+  if (offset < line_starts_[line - 1] ||
+      (line < line_starts_.size() && offset >= line_starts_[line])) {
+    // The last line which starts at or before the offset
+    auto next = std::upper_bound(line_starts_.begin(), line_starts_.end(),
+                                 offset);
+    line = next - line_starts_.begin();
+    last_line_ = line;
+  }
+  std::size_t start = line_starts_[line - 1];
+  // Continuation bytes of multibyte characters do not start a column
+  std::size_t column = 1;
+  for (std::size_t i = start; i < offset; i++) {
+    if ((source_[i] & 0xC0) != 0x80) column++;
+  }
+  SourceLocation location = { line, column };
+  return location;
+}
+
+std::size_t LineTable::LineCount() {
+  if (!built_) Build();
+  return line_starts_.size();
+}
+
+StringSpan LineTable::GetLine(std::size_t line) {
+  if (!built_) Build();
+  if (line == 0 || line > line_starts_.size()) return StringSpan();
+  const char *start = source_.begin() + line_starts_[line - 1];
+  const char *end = line < line_starts_.size()
+      ? source_.begin() + line_starts_[line] - 1
+      : source_.end();
+  return StringSpan(start, end);
+}
+
+}
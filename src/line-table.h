@@ -0,0 +1,49 @@
+#ifndef FLORA_LINE_TABLE_H
+#define FLORA_LINE_TABLE_H
+
+#include <cstddef>
+#include <vector>
+
+#include "flora.h"
+#include "string-span.h"
+
+namespace flora {
+
+// A line and column in the source, both counted from 1. Columns count
+// characters, not bytes.
+struct SourceLocation {
+  std::size_t line;
+  std::size_t column;
+};
+
+// Maps byte offsets of tokens to lines and columns. The scanner only keeps
+// offsets, the line starts are collected with the block search the first
+// time a location is asked for, which is usually when reporting an error.
+class LineTable {
+public:
+  NOCOPY_CLASS(LineTable)
+
+  LineTable() : source_(), built_(false), last_line_(1) { }
+  // The buffer must outlive the table
+  explicit LineTable(StringSpan source)
+      : source_(source), built_(false), last_line_(1) { }
+
+  void Reset(StringSpan source);
+
+  SourceLocation Locate(std::size_t offset);
+  std::size_t LineCount();
+  // The text of a line without its line feed
+  StringSpan GetLine(std::size_t line);
+private:
+  StringSpan source_;
+  bool built_;
+  // The offset of the first character of each line
+  std::vector<std::size_t> line_starts_;
+  // The line found by the previous lookup
+  std::size_t last_line_;
+  void Build();
+};
+
+}
+
+#endif
@@ -0,0 +1,100 @@
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "driver.h"
+#include "line-table.h"
+#include "module-loader.h"
+
+using flora::Driver;
+using flora::LineTable;
+using flora::Module;
+using flora::ModuleLoader;
+using flora::SourceLocation;
+
+namespace {
+
+void PrintUsage() {
+  std::cerr << "usage: flora [-j threads] [--lazy] [--stats] "
+               "[-I root]... [-m module]... file..." << std::endl;
+}
+
+// Prints the errors of modules which are not syntax errors of their own
+// file, those are printed with the files
+std::size_t PrintModuleErrors(const std::vector<const Module*> &entries) {
+  std::unordered_set<const Module*> visited;
+  std::vector<const Module*> stack(entries);
+  std::size_t failed = 0;
+  while (!stack.empty()) {
+    const Module *module = stack.back();
+    stack.pop_back();
+    if (!visited.insert(module).second) continue;
+    stack.insert(stack.end(), module->imports.begin(), module->imports.end());
+    if (module->ok()) continue;
+    failed++;
+    if (module->file && !module->file->unit) continue;
+    std::cerr << "flora: module " << module->name << ": "
+              << module->error_message << std::endl;
+  }
+  return failed;
+}
+
+}
+
+// Parses the files and loads the modules, printing each syntax error as
+// path:line:column
+int main(int argc, char const *argv[]) {
+  unsigned threads = 0;
+  bool lazy = false, stats = false;
+  std::vector<std::string> paths, roots, modules;
+  for (int i = 1; i < argc; i++) {
+    if (std::strcmp(argv[i], "-j") == 0 && i + 1 < argc) {
+      threads = static_cast<unsigned>(std::atoi(argv[++i]));
+    } else if (std::strcmp(argv[i], "-I") == 0 && i + 1 < argc) {
+      roots.push_back(argv[++i]);
+    } else if (std::strcmp(argv[i], "-m") == 0 && i + 1 < argc) {
+      modules.push_back(argv[++i]);
+    } else if (std::strcmp(argv[i], "--lazy") == 0) {
+      lazy = true;
+    } else if (std::strcmp(argv[i], "--stats") == 0) {
+      stats = true;
+    } else if (argv[i][0] == '-') {
+      PrintUsage();
+      return 2;
+    } else {
+      paths.push_back(argv[i]);
+    }
+  }
+  if (paths.empty() && modules.empty()) {
+    PrintUsage();
+    return 2;
+  }
+  if (roots.empty()) roots.push_back(".");
+  Driver driver(threads);
+  driver.set_lazy(lazy);
+  std::size_t failed = driver.Parse(paths);
+  ModuleLoader loader(&driver, roots);
+  failed += PrintModuleErrors(loader.Load(modules));
+  std::size_t bytes = 0;
+  for (const auto &file : driver.files()) {
+    bytes += file->source().size();
+    if (file->unit) continue;
+    if (!file->stream || !file->stream->IsOpen()) {
+      std::cerr << "flora: " << file->error_message << std::endl;
+      continue;
+    }
+    LineTable lines(file->source());
+    SourceLocation location = lines.Locate(file->error_position);
+    std::cerr << file->path << ":" << location.line << ":"
+              << location.column << ": " << file->error_message << std::endl;
+  }
+  if (stats) {
+    std::cerr << driver.files().size() << " files, " << bytes << " bytes, "
+              << driver.symbols().size() << " names, " << driver.threads()
+              << " threads" << std::endl;
+  }
+  return failed ? 1 : 0;
+}
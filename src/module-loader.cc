@@ -0,0 +1,208 @@
+#include "module-loader.h"
+
+#include <unordered_set>
+
+#include <unistd.h>
+
+namespace flora {
+
+const char *const ModuleLoader::kExtension = ".flora";
+
+ModuleLoader::ModuleLoader(Driver *driver,
+                           const std::vector<std::string> &roots)
+    : driver_(driver), roots_(roots), analyzed_count_(0) {
+  for (unsigned i = 0; i < driver_->threads(); i++)
+    scanners_.emplace_back(new Scanner());
+}
+
+std::vector<const Module*> ModuleLoader::Load(
+    const std::vector<std::string> &names) {
+  std::vector<const Module*> result;
+  for (const std::string &name : names) result.push_back(Intern(name));
+  driver_->pool()->Wait();
+  ReportCycles();
+  driver_->MergeSymbols();
+  return result;
+}
+
+const Module* ModuleLoader::Find(const std::string &name) {
+  std::lock_guard<std::mutex> lock(modules_mutex_);
+  auto found = modules_.find(name);
+  return found == modules_.end() ? nullptr : found->second.get();
+}
+
+std::size_t ModuleLoader::size() {
+  std::lock_guard<std::mutex> lock(modules_mutex_);
+  return modules_.size();
+}
+
+Module* ModuleLoader::Intern(const std::string &name) {
+  Module *module;
+  {
+    std::lock_guard<std::mutex> lock(modules_mutex_);
+    std::unique_ptr<Module> &slot = modules_[name];
+    if (slot) return slot.get();
+    module = new Module();
+    slot.reset(module);
+  }
+  module->name = name;
+  module->file = nullptr;
+  module->order = Module::kNotAnalyzed;
+  module->analyzed = false;
+  module->blockers = 2;
+  driver_->pool()->Submit([this, module](unsigned worker) {
+    Discover(module, worker);
+  });
+  return module;
+}
+
+void ModuleLoader::Discover(Module *module, unsigned worker) {
+  std::string path = Resolve(module->name);
+  if (path.empty()) {
+    module->error_message = "cannot find module " + module->name;
+    Finish(module);
+    return;
+  }
+  SourceFile *file = driver_->AddFile(path);
+  file->stream.reset(new MappedFileCharacterStream(path.c_str()));
+  module->file = file;
+  if (!file->stream->IsOpen()) {
+    file->error_message = "cannot open " + path;
+    module->error_message = file->error_message;
+    Finish(module);
+    return;
+  }
+  std::vector<std::string> names;
+  ScanHeader(*file, worker, &names);
+  for (const std::string &name : names) {
+    Module *import = Intern(name);
+    module->imports.push_back(import);
+    std::lock_guard<std::mutex> lock(import->mutex);
+    if (!import->analyzed) {
+      import->importers.push_back(module);
+      module->blockers++;
+    }
+  }
+  driver_->pool()->Submit([this, module](unsigned worker) {
+    driver_->ParseFile(module->file, worker);
+    Unblock(module);
+  });
+  // The imports are counted
+  Unblock(module);
+}
+
+std::string ModuleLoader::Resolve(const std::string &name) const {
+  std::string relative = name;
+  for (char &ch : relative)
+    if (ch == '.') ch = '/';
+  relative += kExtension;
+  for (const std::string &root : roots_) {
+    std::string path = root.empty() ? relative : root + "/" + relative;
+    if (access(path.c_str(), R_OK) == 0) return path;
+  }
+  return std::string();
+}
+
+void ModuleLoader::ScanHeader(const SourceFile &file, unsigned worker,
+                              std::vector<std::string> *names) {
+  StringSpan source = file.source();
+  Scanner &scanner = *scanners_[worker];
+  scanner.Initialize(source.data(), source.size());
+  // import A.B.C [as D];
+  while (scanner.Advance() == Token::Import) {
+    std::string name;
+    Token token;
+    do {
+      if (scanner.Advance() != Token::Identifier) return;
+      if (!name.empty()) name += '.';
+      name.append(source.data() + scanner.GetTokenOffset(),
+                  scanner.GetTokenLength());
+    } while ((token = scanner.Advance()) == Token::Period);
+    if (token == Token::As) {
+      if (scanner.Advance() != Token::Identifier) return;
+      token = scanner.Advance();
+    }
+    if (token != Token::Semicolon) return;
+    names->push_back(name);
+  }
+}
+
+void ModuleLoader::Unblock(Module *module) {
+  if (module->blockers.fetch_sub(1) != 1) return;
+  driver_->pool()->Submit([this, module](unsigned) { Analyze(module); });
+}
+
+void ModuleLoader::Analyze(Module *module) {
+  const SourceFile &file = *module->file;
+  if (!file.unit) {
+    module->error_message = file.error_message;
+  } else {
+    // The header scan stopped at the first other declaration
+    ZoneSpan<ast::Declaration*> declarations = file.unit->declarations();
+    for (std::size_t i = module->imports.size(); i < declarations.size();
+         i++) {
+      if (declarations[i]->IsImportDeclaration()) {
+        module->error_message =
+            "imports must come before other declarations";
+        break;
+      }
+    }
+  }
+  for (Module *import : module->imports) {
+    if (!module->ok()) break;
+    if (!import->ok())
+      module->error_message = "imported module " + import->name +
+          " has errors";
+  }
+  module->order = analyzed_count_++;
+  Finish(module);
+}
+
+void ModuleLoader::Finish(Module *module) {
+  std::vector<Module*> importers;
+  {
+    std::lock_guard<std::mutex> lock(module->mutex);
+    module->analyzed = true;
+    importers.swap(module->importers);
+  }
+  for (Module *importer : importers) Unblock(importer);
+}
+
+void ModuleLoader::ReportCycles() {
+  // Every module still blocked waits for a cycle, through its imports
+  std::lock_guard<std::mutex> lock(modules_mutex_);
+  std::vector<Module*> blocked;
+  for (auto &entry : modules_) {
+    if (!entry.second->analyzed) blocked.push_back(entry.second.get());
+  }
+  for (Module *module : blocked) {
+    if (module->file && !module->file->unit) {
+      module->error_message = module->file->error_message;
+    } else if (InCycle(module)) {
+      module->error_message = "import cycle through " + module->name;
+    } else {
+      module->error_message = "imports a module in an import cycle";
+    }
+  }
+  for (Module *module : blocked) {
+    module->analyzed = true;
+    module->importers.clear();
+  }
+}
+
+bool ModuleLoader::InCycle(Module *module) const {
+  std::unordered_set<const Module*> visited;
+  std::vector<const Module*> stack(module->imports.begin(),
+                                   module->imports.end());
+  while (!stack.empty()) {
+    const Module *current = stack.back();
+    stack.pop_back();
+    if (current == module) return true;
+    if (current->analyzed || !visited.insert(current).second) continue;
+    stack.insert(stack.end(), current->imports.begin(),
+                 current->imports.end());
+  }
+  return false;
+}
+
+}
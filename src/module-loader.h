@@ -0,0 +1,103 @@
+#ifndef FLORA_MODULE_LOADER_H
+#define FLORA_MODULE_LOADER_H
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "flora.h"
+#include "driver.h"
+#include "scanner.h"
+
+namespace flora {
+
+// A module of the import graph, found by its dotted name
+struct Module {
+  std::string name;
+  // nullptr if no file has the name
+  SourceFile *file;
+  // The modules of the import declarations, imports[i] is the module of
+  // the i-th declaration of the tree
+  std::vector<Module*> imports;
+  // Empty if the module and everything it imports loaded without errors
+  std::string error_message;
+  // Modules are analyzed after their imports, this counts up from 0 in
+  // the order they were. kNotAnalyzed for modules left out by an error.
+  std::size_t order;
+
+  bool ok() const { return error_message.empty(); }
+
+  static const std::size_t kNotAnalyzed = static_cast<std::size_t>(-1);
+
+  // Scheduling state of the loader
+  std::mutex mutex;
+  bool analyzed;
+  // The importers waiting for this module
+  std::vector<Module*> importers;
+  // The imports not yet analyzed, plus one for the parse of the module
+  // and one while the imports are being counted
+  std::atomic<int> blockers;
+};
+
+// Loads modules with their imports on the pool of a driver. Imports must
+// come before the other declarations of a module, so the graph is found
+// by scanning only the leading import declarations of each file, which
+// happens as soon as an importer names the module. Each module is parsed
+// once the header is scanned and analyzed once its imports are, so with
+// enough workers the time to load depends on the depth of the graph more
+// than on its size. Analysis checks that no import follows the header and
+// passes errors on to the importers.
+//
+// Modules are kept for the life of the loader, so a module imported by
+// many others, or by several loads, is parsed once. Loaded modules are not
+// changed again and may be read by any thread.
+class ModuleLoader {
+public:
+  NOCOPY_CLASS(ModuleLoader)
+
+  // The module a.b is the file a/b.flora of the first root which has it
+  ModuleLoader(Driver *driver, const std::vector<std::string> &roots);
+
+  // Load the modules and what they import. Must not be called by more
+  // than one thread at a time.
+  std::vector<const Module*> Load(const std::vector<std::string> &names);
+
+  // nullptr if the module was never loaded
+  const Module* Find(const std::string &name);
+  std::size_t size();
+
+  static const char *const kExtension;
+private:
+  Driver *driver_;
+  std::vector<std::string> roots_;
+  std::mutex modules_mutex_;
+  std::unordered_map<std::string, std::unique_ptr<Module>> modules_;
+  // A scanner for the headers per worker
+  std::vector<std::unique_ptr<Scanner>> scanners_;
+  std::atomic<std::size_t> analyzed_count_;
+
+  // Returns the module of the name, a new one is discovered on the pool
+  Module* Intern(const std::string &name);
+  void Discover(Module *module, unsigned worker);
+  // The file of a name, empty if there is none
+  std::string Resolve(const std::string &name) const;
+  // The names of the leading import declarations. Stops at a malformed
+  // one, which the parser reports.
+  void ScanHeader(const SourceFile &file, unsigned worker,
+                  std::vector<std::string> *names);
+  void Unblock(Module *module);
+  void Analyze(Module *module);
+  // Mark the module as analyzed and unblock its importers
+  void Finish(Module *module);
+  // Errors for the modules an import cycle kept from being analyzed
+  void ReportCycles();
+  bool InCycle(Module *module) const;
+};
+
+}
+
+#endif
@@ -0,0 +1,265 @@
+#ifndef FLORA_OPERATOR_DFA_H
+#define FLORA_OPERATOR_DFA_H
+
+#include <cstdint>
+
+#include "flora.h"
+#include "token.h"
+
+namespace flora {
+namespace operators {
+
+// The longest-match automaton of the operators and punctuation marks. It
+// is generated at compile time from the literals in TOKEN_LIST, so a new
+// operator only needs its entry there.
+//
+// A state is a prefix of some operator literal. It is named by a key made
+// of the first token in TOKEN_LIST with that prefix and the length of the
+// prefix. The keys which are states are numbered from 1, 0 is the state
+// without a transition.
+
+// Index sequences, generated in logarithmic depth
+template <int... I> struct Indices {};
+
+template <typename Left, typename Right> struct ConcatIndices;
+
+template <int... I, int... J>
+struct ConcatIndices<Indices<I...>, Indices<J...>> {
+  typedef Indices<I..., (sizeof...(I) + J)...> type;
+};
+
+template <int N>
+struct MakeIndices : ConcatIndices<typename MakeIndices<N / 2>::type,
+                                   typename MakeIndices<N - N / 2>::type> {};
+
+template <> struct MakeIndices<0> { typedef Indices<> type; };
+template <> struct MakeIndices<1> { typedef Indices<0> type; };
+
+// The values of a function at 0, 1, ..., N - 1
+template <typename T, T (*Function)(int), typename Sequence> struct Tabulate;
+
+template <typename T, T (*Function)(int), int... I>
+struct Tabulate<T, Function, Indices<I...>> {
+  static constexpr T values[sizeof...(I)] = { Function(I)... };
+};
+
+template <typename T, T (*Function)(int), int... I>
+constexpr T Tabulate<T, Function, Indices<I...>>::values[sizeof...(I)];
+
+template <typename T, T (*Function)(int), int N>
+struct Table : Tabulate<T, Function, typename MakeIndices<N>::type> {};
+
+// Operator literals
+
+const int kTokenCount = static_cast<int>(Token::TOKEN_COUNT);
+// Only ASCII characters take part in operators
+const int kCharacterCount = 0x80;
+const char32_t kCharacterLimit = kCharacterCount;
+
+constexpr const char* LiteralOf(int token) {
+  return Tokens::Literal(static_cast<Token>(token));
+}
+
+constexpr bool IsPunctuation(char ch) {
+  return (ch >= '!' && ch <= '/') || (ch >= ':' && ch <= '@') ||
+      (ch >= '[' && ch <= '`') || (ch >= '{' && ch <= '~');
+}
+
+constexpr bool IsPunctuationOnly(const char *s) {
+  return *s == '\0' || (IsPunctuation(*s) && IsPunctuationOnly(s + 1));
+}
+
+constexpr int LengthOf(const char *s) {
+  return *s == '\0' ? 0 : 1 + LengthOf(s + 1);
+}
+
+// The literals made of punctuation only are operators, which leaves out
+// the keywords and the description of the end of source. Returns 0 for
+// the other tokens.
+constexpr int OperatorLength(int token) {
+  return LiteralOf(token) != nullptr && *LiteralOf(token) != '\0' &&
+      IsPunctuationOnly(LiteralOf(token)) ? LengthOf(LiteralOf(token)) : 0;
+}
+
+constexpr int MaxOperatorLength(int token, int longest) {
+  return token == kTokenCount ? longest :
+      MaxOperatorLength(token + 1, OperatorLength(token) > longest ?
+                                   OperatorLength(token) : longest);
+}
+
+const int kMaxLength = MaxOperatorLength(0, 0);
+
+constexpr bool SamePrefix(const char *a, const char *b, int length) {
+  return length == 0 || (*a == *b && SamePrefix(a + 1, b + 1, length - 1));
+}
+
+// Returns the first operator from the token on, which starts with the
+// prefix and has at least the length, or -1
+constexpr int FirstWithPrefix(const char *prefix, int length, int token) {
+  return token == kTokenCount ? -1 :
+      OperatorLength(token) >= length &&
+      SamePrefix(LiteralOf(token), prefix, length) ?
+      token : FirstWithPrefix(prefix, length, token + 1);
+}
+
+// Returns the operator whose literal is the prefix, or Token::Illegal
+constexpr Token ExactMatch(const char *prefix, int length, int token) {
+  return token == kTokenCount ? Token::Illegal :
+      OperatorLength(token) == length &&
+      SamePrefix(LiteralOf(token), prefix, length) ?
+      static_cast<Token>(token) : ExactMatch(prefix, length, token + 1);
+}
+
+// Returns the first operator from the token on, which extends the prefix
+// by the character, or -1
+constexpr int FirstExtension(const char *prefix, int length, char ch,
+                             int token) {
+  return token == kTokenCount ? -1 :
+      OperatorLength(token) > length &&
+      SamePrefix(LiteralOf(token), prefix, length) &&
+      LiteralOf(token)[length] == ch ?
+      token : FirstExtension(prefix, length, ch, token + 1);
+}
+
+// States
+
+const int kKeyCount = kTokenCount * kMaxLength;
+
+constexpr int KeyToken(int key) { return key / kMaxLength; }
+constexpr int KeyLength(int key) { return key % kMaxLength + 1; }
+constexpr int MakeKey(int token, int length) {
+  return token * kMaxLength + length - 1;
+}
+
+constexpr bool IsState(int key) {
+  return OperatorLength(KeyToken(key)) >= KeyLength(key) &&
+      FirstWithPrefix(LiteralOf(KeyToken(key)), KeyLength(key), 0) ==
+      KeyToken(key);
+}
+
+typedef Table<bool, IsState, kKeyCount> StateKeys;
+
+constexpr int CountStates(int begin, int end) {
+  return end - begin == 0 ? 0 :
+      end - begin == 1 ? StateKeys::values[begin] :
+      CountStates(begin, (begin + end) / 2) +
+      CountStates((begin + end) / 2, end);
+}
+
+constexpr int StatesBefore(int key) { return CountStates(0, key); }
+
+// One more than the keys, so that the state after the last key is known
+typedef Table<int, StatesBefore, kKeyCount + 1> StateNumbers;
+
+const int kStateCount = StateNumbers::values[kKeyCount] + 1;
+static_assert(kStateCount <= 0x100, "the operator states must fit a byte");
+
+constexpr int StateOf(int token, int length) {
+  return token < 0 ? 0 : StateNumbers::values[MakeKey(token, length)] + 1;
+}
+
+// Returns the first key whose number of states before it is at least n
+constexpr int LowerBound(int n, int begin, int end) {
+  return begin == end ? begin :
+      StateNumbers::values[(begin + end) / 2] < n ?
+      LowerBound(n, (begin + end) / 2 + 1, end) :
+      LowerBound(n, begin, (begin + end) / 2);
+}
+
+// The key of a state other than 0
+constexpr int KeyOf(int state) {
+  return LowerBound(state, 0, kKeyCount + 1) - 1;
+}
+
+// Character classes, only the characters after the first one of an
+// operator have a class other than 0
+
+constexpr bool Continues(char ch, int token, int position) {
+  return position < OperatorLength(token) &&
+      (LiteralOf(token)[position] == ch || Continues(ch, token, position + 1));
+}
+
+constexpr bool AnyContinues(char ch, int token) {
+  return token != kTokenCount &&
+      (Continues(ch, token, 1) || AnyContinues(ch, token + 1));
+}
+
+constexpr bool IsContinuation(int ch) {
+  return AnyContinues(static_cast<char>(ch), 0);
+}
+
+typedef Table<bool, IsContinuation, kCharacterCount> Continuations;
+
+constexpr int CountContinuations(int begin, int end) {
+  return end - begin == 0 ? 0 :
+      end - begin == 1 ? Continuations::values[begin] :
+      CountContinuations(begin, (begin + end) / 2) +
+      CountContinuations((begin + end) / 2, end);
+}
+
+constexpr std::uint8_t ClassOf(int ch) {
+  return Continuations::values[ch] ? CountContinuations(0, ch) + 1 : 0;
+}
+
+typedef Table<std::uint8_t, ClassOf, kCharacterCount> Classes;
+
+const int kClassCount = CountContinuations(0, kCharacterCount) + 1;
+
+constexpr char CharacterOf(int klass, int ch) {
+  return Classes::values[ch] == klass ?
+      static_cast<char>(ch) : CharacterOf(klass, ch + 1);
+}
+
+// Transitions
+
+constexpr std::uint8_t StartState(int ch) {
+  return StateOf(FirstExtension("", 0, static_cast<char>(ch), 0), 1);
+}
+
+constexpr std::uint8_t Extend(int key, char ch) {
+  return StateOf(FirstExtension(LiteralOf(KeyToken(key)), KeyLength(key),
+                                ch, 0),
+                 KeyLength(key) + 1);
+}
+
+// Entry state * kClassCount + class of the table
+constexpr std::uint8_t Transition(int entry) {
+  return entry / kClassCount == 0 || entry % kClassCount == 0 ? 0 :
+      Extend(KeyOf(entry / kClassCount),
+             CharacterOf(entry % kClassCount, 0));
+}
+
+constexpr Token AcceptedToken(int state) {
+  return state == 0 ? Token::Illegal :
+      ExactMatch(LiteralOf(KeyToken(KeyOf(state))), KeyLength(KeyOf(state)),
+                 0);
+}
+
+typedef Table<std::uint8_t, StartState, kCharacterCount> StartStates;
+typedef Table<std::uint8_t, Transition, kStateCount * kClassCount>
+    Transitions;
+typedef Table<Token, AcceptedToken, kStateCount> AcceptedTokens;
+
+// Returns the state after the first character of an operator, 0 if no
+// operator starts with the character
+inline int Start(char32_t ch) {
+  return ch < kCharacterLimit ? StartStates::values[ch] : 0;
+}
+
+// Returns the state after the next character, 0 if the operator can not
+// be extended by it
+inline int Next(int state, char32_t ch) {
+  return ch < kCharacterLimit ?
+      Transitions::values[state * kClassCount + Classes::values[ch]] : 0;
+}
+
+// Returns the operator recognized in the state, Token::Illegal if the
+// state is only a prefix of operators
+inline Token Accept(int state) {
+  return AcceptedTokens::values[state];
+}
+
+}
+}
+
+#endif
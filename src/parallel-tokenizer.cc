@@ -0,0 +1,134 @@
+#include "parallel-tokenizer.h"
+
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+#include "character-search.h"
+#include "scanner.h"
+
+namespace flora {
+
+namespace {
+
+// Lex a chunk as if it started between two tokens
+void GuessChunk(const char *source, std::size_t length, std::size_t begin,
+                std::size_t end, TokenBuffer *tokens) {
+  Scanner scanner;
+  scanner.Initialize(source, length, begin);
+  scanner.TokenizeUntil(tokens, end);
+}
+
+bool IsFinished(const TokenBuffer &tokens) {
+  if (tokens.empty()) return false;
+  Token last = tokens.kind(tokens.size() - 1);
+  return last == Token::EndOfSource || last == Token::Illegal;
+}
+
+}
+
+ParallelTokenizer::ParallelTokenizer(unsigned threads)
+    : threads_(threads), chunk_size_(kDefaultChunkSize) {
+  if (threads_ == 0) threads_ = std::thread::hardware_concurrency();
+  if (threads_ == 0) threads_ = 1;
+}
+
+void ParallelTokenizer::Tokenize(const char *source, std::size_t length,
+                                 TokenBuffer *tokens) {
+  tokens->Clear();
+  std::vector<std::size_t> boundaries = Split(source, length);
+  std::size_t count = boundaries.size() - 1;
+  if (count == 1) {
+    Scanner scanner;
+    scanner.Initialize(source, length);
+    scanner.TokenizeAll(tokens);
+    return;
+  }
+  // The first chunk starts at the beginning of the source, so its tokens
+  // are known to be right and go straight into the result
+  std::vector<TokenBuffer> guesses(count);
+  std::atomic<std::size_t> next(1);
+  auto work = [&]() {
+    std::size_t chunk;
+    while ((chunk = next.fetch_add(1)) < count) {
+      GuessChunk(source, length, boundaries[chunk], boundaries[chunk + 1],
+                 &guesses[chunk]);
+    }
+  };
+  std::vector<std::thread> workers;
+  unsigned helpers = std::min<std::size_t>(threads_, count) - 1;
+  for (unsigned i = 0; i < helpers; i++) workers.emplace_back(work);
+  tokens->Reserve(length / 6 + 1);
+  GuessChunk(source, length, 0, boundaries[1], tokens);
+  work();
+  for (std::thread &worker : workers) worker.join();
+  Stitch(source, length, boundaries, &guesses, tokens);
+}
+
+std::vector<std::size_t> ParallelTokenizer::Split(const char *source,
+                                                  std::size_t length) const {
+  std::size_t count = std::min<std::size_t>(length / chunk_size_,
+                                            threads_ * kChunksPerThread);
+  std::vector<std::size_t> boundaries(1, 0);
+  std::size_t step = count > 1 ? length / count : length;
+  for (std::size_t i = 1; i < count; i++) {
+    std::size_t target = i * step;
+    if (target <= boundaries.back()) continue;
+    // Prefer the start of a line nearby. Strings, characters and single
+    // line comments can not span a line feed, so there only a /* */
+    // comment can make the guess wrong.
+    const char *window = source + std::min(length, target + step / 8);
+    const char *found = character::FindLineFeed(source + target, window);
+    std::size_t offset;
+    if (found != window) {
+      offset = found + 1 - source;
+    } else {
+      // Do not split a multibyte character
+      offset = target;
+      while (offset < length && (source[offset] & 0xC0) == 0x80) offset++;
+    }
+    if (offset > boundaries.back() && offset < length)
+      boundaries.push_back(offset);
+  }
+  boundaries.push_back(length);
+  return boundaries;
+}
+
+void ParallelTokenizer::Stitch(const char *source, std::size_t length,
+                               const std::vector<std::size_t> &boundaries,
+                               std::vector<TokenBuffer> *guesses,
+                               TokenBuffer *tokens) const {
+  std::size_t count = boundaries.size() - 1;
+  std::size_t chunk = 1;
+  while (chunk < count && !IsFinished(*tokens)) {
+    // Scanning resumes right after the last true token
+    Scanner scanner;
+    std::size_t resume =
+        tokens->empty() ? 0 : tokens->end(tokens->size() - 1);
+    scanner.Initialize(source, length, resume);
+    std::size_t guess = 0;
+    while (true) {
+      Token token = scanner.Advance();
+      std::size_t offset = scanner.GetTokenOffset();
+      // Long tokens and comments may skip whole chunks
+      while (chunk + 1 < count && offset >= boundaries[chunk + 1]) {
+        chunk++;
+        guess = 0;
+      }
+      const TokenBuffer &guessed = (*guesses)[chunk];
+      while (guess < guessed.size() && guessed.offset(guess) < offset)
+        guess++;
+      if (guess < guessed.size() && guessed.offset(guess) == offset) {
+        // Both scanners start a token here, the rest of the guess is right
+        tokens->Append(guessed, guess, guessed.size());
+        chunk++;
+        break;
+      }
+      scanner.AppendToken(tokens, token);
+      if (token == Token::EndOfSource || token == Token::Illegal)
+        return;
+    }
+  }
+}
+
+}
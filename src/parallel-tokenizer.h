@@ -0,0 +1,52 @@
+#ifndef FLORA_PARALLEL_TOKENIZER_H
+#define FLORA_PARALLEL_TOKENIZER_H
+
+#include <cstddef>
+#include <vector>
+
+#include "flora.h"
+#include "token-buffer.h"
+
+namespace flora {
+
+// Tokenizes one large source on several threads. The source is split into
+// chunks which are lexed speculatively, as if each chunk started between
+// two tokens. A chunk boundary inside a string or a comment makes the
+// guess wrong, so the chunks are stitched together by re-lexing from the
+// end of the previous chunk until a token starts where the guess also
+// starts a token. From there on both agree, because the scanner carries
+// no state from one token to the next. The result is identical to
+// Scanner::TokenizeAll().
+class ParallelTokenizer {
+public:
+  NOCOPY_CLASS(ParallelTokenizer)
+
+  // Zero threads means one per hardware thread
+  explicit ParallelTokenizer(unsigned threads = 0);
+
+  // Sources smaller than two chunks are tokenized on the calling thread
+  std::size_t chunk_size() const { return chunk_size_; }
+  void set_chunk_size(std::size_t size) { chunk_size_ = size ? size : 1; }
+
+  // The buffer must outlive the tokens
+  void Tokenize(const char *source, std::size_t length, TokenBuffer *tokens);
+private:
+  static const std::size_t kDefaultChunkSize = 1 << 20;
+  // Chunks per thread, so that a chunk that needs long scans past its end
+  // does not hold up the others
+  static const unsigned kChunksPerThread = 4;
+  unsigned threads_;
+  std::size_t chunk_size_;
+  // Returns the chunk start offsets followed by the length of the source
+  std::vector<std::size_t> Split(const char *source,
+                                 std::size_t length) const;
+  // Append the true tokens which follow the last token in tokens, taking
+  // over the guesses of later chunks as soon as they agree
+  void Stitch(const char *source, std::size_t length,
+              const std::vector<std::size_t> &boundaries,
+              std::vector<TokenBuffer> *guesses, TokenBuffer *tokens) const;
+};
+
+}
+
+#endif
@@ -1,328 +1,1181 @@
+#include "parser.h"
+
+#include <algorithm>
+#include <cstring>
+
+namespace flora {
+
+using namespace ast;
+
+namespace {
+
+// Binding powers of the Pratt parser. Binary and assignment operators bind
+// as their precedence in TOKEN_LIST, the conditional binds tighter than
+// assignments, prefix operators tighter than any binary operator, and
+// postfix operators, calls, indexing and member access tighter still.
+constexpr int MaxPrecedence(int token, int highest) {
+  return token == static_cast<int>(Token::TOKEN_COUNT) ? highest :
+      MaxPrecedence(token + 1,
+                    Tokens::Precedence(static_cast<Token>(token)) > highest ?
+                    Tokens::Precedence(static_cast<Token>(token)) : highest);
+}
+
+const int kConditionalPower = Tokens::Precedence(Token::Assignment) + 1;
+const int kPrefixPower = MaxPrecedence(0, 0) + 1;
+const int kPostfixPower = kPrefixPower + 1;
+
+constexpr bool IsPostfix(Token token) {
+  return token == Token::LeftParenthesis || token == Token::LeftBracket ||
+      token == Token::Period || token == Token::Increment ||
+      token == Token::Decrement;
+}
+
+// Commas separate the elements of lists, they are not operators
+constexpr int LeftPower(Token token) {
+  return token == Token::Comma ? 0 :
+      Tokens::IsBinaryOperator(token) || Tokens::IsAssignment(token) ?
+      Tokens::Precedence(token) :
+      token == Token::Conditional ? kConditionalPower :
+      IsPostfix(token) ? kPostfixPower : 0;
+}
+
+// The right operand of a right associative operator takes operators of
+// the same power, the others only tighter ones
+constexpr int RightPower(Token token) {
+  return Tokens::IsAssignment(token) ? LeftPower(token) - 1 : LeftPower(token);
+}
+
+#define T(name, literal, precedence, flags) LeftPower(Token::name),
+constexpr std::uint8_t kLeftPowers[] = {
+  TOKEN_LIST(T, T)
+};
+#undef T
+
+#define T(name, literal, precedence, flags) RightPower(Token::name),
+constexpr std::uint8_t kRightPowers[] = {
+  TOKEN_LIST(T, T)
+};
+#undef T
+
+constexpr bool IsLiteral(Token token) {
+  return token == Token::Integer || token == Token::RealNumber ||
+      token == Token::Character || token == Token::String ||
+      token == Token::True || token == Token::False || token == Token::Null;
+}
+
+constexpr bool IsPrefix(Token token) {
+  return token == Token::Addition || token == Token::Subtraction ||
+      token == Token::LogicalNot || token == Token::BitwiseNot ||
+      token == Token::Increment || token == Token::Decrement;
+}
+
+std::string Describe(Token token) {
+  const char *literal = Tokens::Literal(token);
+  return literal ? std::string("'") + literal + "'" : Tokens::Name(token);
+}
+
+}
+
+constexpr Parser::NullDenotation Parser::NullDenotationOf(Token token) {
+  return IsLiteral(token) ? &Parser::ParseLiteral :
+      token == Token::Identifier || token == Token::This ?
+      &Parser::ParseVariable :
+      IsPrefix(token) ? &Parser::ParsePrefixOperation :
+      token == Token::LeftParenthesis ? &Parser::ParseParenthesis :
+      token == Token::LeftBracket ? &Parser::ParseArrayLiteral : nullptr;
+}
+
+constexpr Parser::LeftDenotation Parser::LeftDenotationOf(Token token) {
+  return LeftPower(token) == 0 ? nullptr :
+      token == Token::Conditional ? &Parser::ParseConditional :
+      token == Token::LeftParenthesis ? &Parser::ParseInvoke :
+      token == Token::LeftBracket ? &Parser::ParseIndex :
+      token == Token::Period ? &Parser::ParseMemberAccess :
+      token == Token::Increment || token == Token::Decrement ?
+      &Parser::ParsePostfixOperation : &Parser::ParseBinaryOperation;
+}
+
+#define T(name, literal, precedence, flags) NullDenotationOf(Token::name),
+const Parser::NullDenotation Parser::kNullDenotations[] = {
+  TOKEN_LIST(T, T)
+};
+#undef T
+
+#define T(name, literal, precedence, flags) LeftDenotationOf(Token::name),
+const Parser::LeftDenotation Parser::kLeftDenotations[] = {
+  TOKEN_LIST(T, T)
+};
+#undef T
+
+Parser::Parser(Zone *zone, SymbolTable *symbols)
+    : zone_(zone), symbols_(symbols), factory_(zone), statistics_({ 0, 0 }),
+      statistics_start_({ 0, 0 }),
+      error_position_(0), lazy_(false), peek(Token::Illegal),
+      previous_end_(0), current_(nullptr) { }
+
+Parser::~Parser() { }
+
+void Parser::Initialize(const char *source, std::size_t length,
+                        std::size_t offset) {
+  scanner_.set_symbol_table(symbols_);
+  scanner_.Initialize(source, length, offset);
+  error_message_.clear();
+  error_position_ = 0;
+  pointer_buffer_.clear();
+  frames_.clear();
+  current_ = nullptr;
+  previous_end_ = static_cast<std::uint32_t>(offset);
+  statistics_start_.node_count = factory_.node_count();
+  statistics_start_.zone_bytes = zone_->allocation_size();
+  peek = scanner_.Advance();
+}
+
+void Parser::RecordStatistics() {
+  statistics_.node_count =
+      factory_.node_count() - statistics_start_.node_count;
+  statistics_.zone_bytes =
+      zone_->allocation_size() - statistics_start_.zone_bytes;
+}
+
+TranslationUnit* Parser::Parse(const char *source, std::size_t length) {
+  Initialize(source, length, 0);
+  bool ok = true;
+  TranslationUnit *unit = ParseProgram(ok);
+  RecordStatistics();
+  return ok ? unit : nullptr;
+}
+
+Block* Parser::ParseLazyFunction(FunctionDeclaration *function) {
+  if (!function->is_lazy()) return function->body();
+  // Scan the body alone, at its offset so positions stay those of the
+  // translation unit
+  StringSpan body = function->lazy_body();
+  std::uint32_t offset = function->body_position();
+  Initialize(body.data() - offset, offset + body.size(), offset);
+  current_ = function->scope();
+  bool ok = true;
+  Block *block = ParseBlock(ok);
+  current_ = nullptr;
+  RecordStatistics();
+  if (!ok) return nullptr;
+  function->set_body(block);
+  return block;
+}
 
 Token Parser::Advance() {
-#ifdef FLORA_DEBUG
-  debug_logger_.Log("advance $1", Tokens::Name(peek));
-#endif
+  previous_end_ =
+      Position() + static_cast<std::uint32_t>(scanner_.GetTokenLength());
   peek = scanner_.Advance();
+  return peek;
+}
+
+void Parser::Expect(Token expected, bool &ok) {
+  if (peek == expected) {
+    Advance();
+  } else {
+    ReportUnexpectedToken(expected);
+    ok = false;
+  }
 }
 
 bool Parser::Match(Token expected) {
   if (peek == expected) {
     Advance();
-#ifdef FLORA_DEBUG
-    debug_logger_.Log("match $1: success", Tokens::Name(expected));
-#endif
     return true;
   }
-#ifdef FLORA_DEBUG
-  debug_logger_.Log("match $1: failure, met $2 instead",
-                    Tokens::Name(expected), Tokens::Name(peek));
-#endif
   return false;
 }
 
-TranslationUnit* Parser::ParseProgram(bool &ok) {
-  SetUpParsing();
+std::uint32_t Parser::Position() {
+  return static_cast<std::uint32_t>(scanner_.GetTokenOffset());
+}
 
+StringSpan Parser::TokenLiteral() {
+  StringSpan literal = scanner_.GetTokenLiteral();
+  StringSpan source = scanner_.GetSource();
+  if (literal.empty() ||
+      (literal.begin() >= source.begin() && literal.end() <= source.end()))
+    return literal;
+  char *copy = zone_->NewArray<char>(literal.size());
+  std::memcpy(copy, literal.data(), literal.size());
+  return StringSpan(copy, literal.size());
+}
+
+StringSpan Parser::TokenText() {
+  return StringSpan(scanner_.GetSource().data() + scanner_.GetTokenOffset(),
+                    scanner_.GetTokenLength());
+}
+
+void Parser::ReportError(const char *message) {
+  if (!error_message_.empty()) return;
+  // The scanner describes its own errors
+  if (peek == Token::Illegal) {
+    error_message_ = scanner_.GetTokenLiteral().ToString();
+  } else {
+    error_message_ = message;
+  }
+  error_position_ = Position();
+}
+
+void Parser::ReportUnexpectedToken(Token expected) {
+  std::string message =
+      "expected " + Describe(expected) + " instead of " + Describe(peek);
+  ReportError(message.c_str());
+}
+
+Declaration* Parser::ParseDeclarationAt(const char *source,
+                                        std::size_t length,
+                                        std::size_t offset, Scope *scope) {
+  Initialize(source, length, offset);
+  current_ = scope;
+  bool ok = true;
+  Declaration *declaration =
+      scope->type() == ScopeType::Global && peek == Token::Import ?
+      ParseImportDeclaration(ok) : ParseDeclaration(ok);
+  current_ = nullptr;
+  RecordStatistics();
+  return ok ? declaration : nullptr;
+}
+
+// Declarations
+
+TranslationUnit* Parser::ParseProgram(bool &ok) {
   Scope *global = NewScope(ScopeType::Global);
-  Declaration *decl;
-  std::vector<Declaration*> decls;
-  while (true) {
+  ScopedPtrList<Declaration> declarations(&pointer_buffer_);
+  while (peek != Token::EndOfSource) {
+    Declaration *declaration = peek == Token::Import ?
+        ParseImportDeclaration(ok) : ParseDeclaration(ok);
+    CHECK_ERROR(ok);
+    declarations.Add(declaration);
+  }
+  CloseScope(global);
+  return factory_.New<TranslationUnit>(global, declarations.ToSpan(zone_));
+}
+
+// Declarations of namespaces and classes
+Declaration* Parser::ParseDeclaration(bool &ok) {
+  Declaration *declaration;
+  switch (peek) {
+  case Token::Namespace:
+    declaration = ParseNamespaceDeclaration(ok);
+    break;
+  case Token::Class:
+    declaration = ParseClassDeclaration(ok);
+    break;
+  case Token::Const:
+    declaration = ParseConstantDeclaration(ok);
+    break;
+  default:
+    declaration = ParseVariableOrFunctionDeclaration(ok);
+    break;
+  }
+  CHECK_ERROR(ok);
+  declaration->set_end_position(previous_end_);
+  return declaration;
+}
+
+ImportDeclaration* Parser::ParseImportDeclaration(bool &ok) {
+  // import A.B.C [as D];
+  std::uint32_t position = Position();
+  Expect(Token::Import, ok);
+  std::vector<StringSpan> path;
+  StringSpan alias;
+  Symbol symbol = kNoSymbol;
+  do {
+    if (peek != Token::Identifier) {
+      ReportUnexpectedToken(Token::Identifier);
+      ok = false;
+      return nullptr;
+    }
+    alias = TokenText();
+    symbol = scanner_.GetTokenSymbol();
+    path.push_back(alias);
+    Advance();
+  } while (Match(Token::Period));
+  if (Match(Token::As)) {
+    if (peek != Token::Identifier) {
+      ReportUnexpectedToken(Token::Identifier);
+      ok = false;
+      return nullptr;
+    }
+    alias = TokenText();
+    symbol = scanner_.GetTokenSymbol();
+    Advance();
+  }
+  Expect(Token::Semicolon, ok);
+  CHECK_ERROR(ok);
+  StringSpan *names = zone_->NewArray<StringSpan>(path.size());
+  std::copy(path.begin(), path.end(), names);
+  auto *declaration = factory_.New<ImportDeclaration>(
+      position, alias, ZoneSpan<StringSpan>(names, path.size()));
+  declaration->set_symbol(symbol);
+  declaration->set_end_position(previous_end_);
+  current_->Declare(declaration);
+  return declaration;
+}
+
+NamespaceDeclaration* Parser::ParseNamespaceDeclaration(bool &ok) {
+  // namespace A { declarations }
+  std::uint32_t position = Position();
+  Expect(Token::Namespace, ok);
+  if (peek != Token::Identifier) {
+    ReportError("missing name of the namespace");
+    ok = false;
+    return nullptr;
+  }
+  StringSpan the_name = TokenText();
+  Symbol the_symbol = scanner_.GetTokenSymbol();
+  Advance();
+  Expect(Token::LeftBrace, ok);
+  CHECK_ERROR(ok);
+  Scope *the_scope = NewScope(ScopeType::Namespace);
+  ScopedPtrList<Declaration> decls(&pointer_buffer_);
+  while (!Match(Token::RightBrace)) {
     if (peek == Token::EndOfSource) {
-      break;
-    } else if (peek == Token::Using) {
-      ParseUsingClause(ok);
-    } else if (peek == Token::Namespace) {
-      decl = ParseNamespaceDeclaration(ok);
-      if (!ok) break;
-    } else if (peek == Token::Class) {
-      decl = ParseClassDeclaration(ok);
-      if (!ok) break;
-    } else if (peek == Token::Const) {
-      decl = ParseConstantDeclaration(ok);
-      if (!ok) break;
-    } else { // Variable and function declaration
-      decl = ParseVariableOrFunctionDeclaration(ok);
-      if (!ok) break;
+      ReportUnexpectedToken(Token::RightBrace);
+      ok = false;
+      return nullptr;
     }
+    Declaration *declaration = ParseDeclaration(ok);
+    CHECK_ERROR(ok);
+    decls.Add(declaration);
   }
-  if (!ok) {
-    CleanUpParsing();
+  CloseScope(the_scope);
+  auto *declaration = factory_.New<NamespaceDeclaration>(
+      position, the_name, the_scope, decls.ToSpan(zone_));
+  declaration->set_symbol(the_symbol);
+  current_->Declare(declaration);
+  return declaration;
+}
+
+ClassDeclaration* Parser::ParseClassDeclaration(bool &ok) {
+  // class A [< Base, ...] { [public|private] [static] declarations }
+  std::uint32_t position = Position();
+  Expect(Token::Class, ok);
+  if (peek != Token::Identifier) {
+    ReportError("missing name of the class");
+    ok = false;
+    return nullptr;
+  }
+  StringSpan class_name = TokenText();
+  Symbol class_symbol = scanner_.GetTokenSymbol();
+  Advance();
+  // Parent classes
+  ScopedPtrList<TypeSpecifier> bases(&pointer_buffer_);
+  if (Match(Token::LessThan)) {
+    do {
+      TypeSpecifier *base = ParseTypeSpecifier(ok);
+      CHECK_ERROR(ok);
+      bases.Add(base);
+    } while (Match(Token::Comma));
+  }
+  // Before the members are added after the bases on the buffer
+  ZoneSpan<TypeSpecifier*> base_span = bases.ToSpan(zone_);
+  // Class body
+  Expect(Token::LeftBrace, ok);
+  CHECK_ERROR(ok);
+  Scope *the_scope = NewScope(ScopeType::Class);
+  ScopedPtrList<Declaration> members(&pointer_buffer_);
+  while (!Match(Token::RightBrace)) {
+    if (peek == Token::EndOfSource) {
+      ReportUnexpectedToken(Token::RightBrace);
+      ok = false;
+      return nullptr;
+    }
+    MemberVisibility visibility = MemberVisibility::Default;
+    if (Match(Token::Public)) {
+      visibility = MemberVisibility::Public;
+    } else if (Match(Token::Private)) {
+      visibility = MemberVisibility::Private;
+    }
+    bool is_static = Match(Token::Static);
+    Declaration *member = ParseDeclaration(ok);
+    CHECK_ERROR(ok);
+    member->set_visibility(visibility);
+    member->set_static(is_static);
+    members.Add(member);
   }
-  TranslationUnit *unit = new ast::TranslationUnit();
-  unit->scope_tree_ = global;
-  unit->declarations_ = std::move(decls);
-  return unit;
+  CloseScope(the_scope);
+  auto *declaration = factory_.New<ClassDeclaration>(
+      position, class_name, the_scope, base_span, members.ToSpan(zone_));
+  declaration->set_symbol(class_symbol);
+  current_->Declare(declaration);
+  return declaration;
 }
 
-UsingDeclaration* ParseUsingClause(bool &ok) {
-  // using A.B.C.D [as E];
-  Expect(Token::Using);
+ConstantDeclaration* Parser::ParseConstantDeclaration(bool &ok) {
+  // const [Type] name = value;
+  std::uint32_t position = Position();
+  Expect(Token::Const, ok);
+  TypeSpecifier *type = nullptr;
+  if (peek != Token::Identifier || scanner_.Peek(1) != Token::Assignment) {
+    type = ParseTypeSpecifier(ok);
+    CHECK_ERROR(ok);
+  }
+  if (peek != Token::Identifier) {
+    ReportUnexpectedToken(Token::Identifier);
+    ok = false;
+    return nullptr;
+  }
+  StringSpan name = TokenText();
+  Symbol symbol = scanner_.GetTokenSymbol();
+  Advance();
+  Expect(Token::Assignment, ok);
+  CHECK_ERROR(ok);
+  Expression *value = ParseExpression(ok);
+  CHECK_ERROR(ok);
+  Expect(Token::Semicolon, ok);
+  CHECK_ERROR(ok);
+  auto *declaration =
+      factory_.New<ConstantDeclaration>(position, name, type, value);
+  declaration->set_symbol(symbol);
+  current_->Declare(declaration);
+  return declaration;
+}
 
+Declaration* Parser::ParseVariableOrFunctionDeclaration(bool &ok) {
+  std::uint32_t position = Position();
+  TypeSpecifier *type = ParseTypeSpecifier(ok);
+  CHECK_ERROR(ok);
+  if (peek != Token::Identifier) {
+    ReportUnexpectedToken(Token::Identifier);
+    ok = false;
+    return nullptr;
+  }
+  StringSpan name = TokenText();
+  Symbol symbol = scanner_.GetTokenSymbol();
+  Advance();
+  if (peek == Token::LeftParenthesis)
+    return ParseFunctionRest(position, name, symbol, type, ok);
+  VariableDeclaration *declaration =
+      ParseVariableRest(position, name, symbol, type, ok);
+  CHECK_ERROR(ok);
+  Expect(Token::Semicolon, ok);
+  CHECK_ERROR(ok);
+  return declaration;
 }
 
-NamespaceDeclaration* ParseNamespace(bool &ok) {
-  Expect(Token::Namespace);
-  Scope *the_scope = NewScope(ScopeType::Namespace);
+VariableDeclaration* Parser::ParseVariableDeclaration(bool &ok) {
+  // Type name [= initializer]
+  std::uint32_t position = Position();
+  TypeSpecifier *type = ParseTypeSpecifier(ok);
+  CHECK_ERROR(ok);
   if (peek != Token::Identifier) {
-    ReportSyntaxError("missing name of the namespace");
+    ReportUnexpectedToken(Token::Identifier);
     ok = false;
     return nullptr;
   }
-  std::string the_name = scanner_.GetTokenLiteral();
+  StringSpan name = TokenText();
+  Symbol symbol = scanner_.GetTokenSymbol();
   Advance();
-  Expect(Token::LeftBrace);
+  return ParseVariableRest(position, name, symbol, type, ok);
+}
 
-  std::vector<Declaration*> decls;
-  while (true) {
+VariableDeclaration* Parser::ParseVariableRest(std::uint32_t position,
+                                               StringSpan name, Symbol symbol,
+                                               TypeSpecifier *type,
+                                               bool &ok) {
+  Expression *initializer = nullptr;
+  if (Match(Token::Assignment)) {
+    initializer = ParseExpression(ok);
+    CHECK_ERROR(ok);
+  }
+  auto *declaration =
+      factory_.New<VariableDeclaration>(position, name, type, initializer);
+  declaration->set_symbol(symbol);
+  current_->Declare(declaration);
+  return declaration;
+}
+
+FunctionDeclaration* Parser::ParseFunctionRest(std::uint32_t position,
+                                               StringSpan name, Symbol symbol,
+                                               TypeSpecifier *return_type,
+                                               bool &ok) {
+  // (parameters) { body }
+  Scope *the_scope = NewScope(ScopeType::Function);
+  ZoneSpan<VariableDeclaration*> parameters = ParseParameters(ok);
+  CHECK_ERROR(ok);
+  auto *declaration = factory_.New<FunctionDeclaration>(
+      position, name, the_scope, parameters, return_type, nullptr);
+  if (lazy_) {
+    PreParseFunctionBody(declaration, ok);
+  } else {
+    declaration->set_body(ParseBlock(ok));
+  }
+  CHECK_ERROR(ok);
+  CloseScope(the_scope);
+  declaration->set_symbol(symbol);
+  current_->Declare(declaration);
+  return declaration;
+}
+
+ZoneSpan<VariableDeclaration*> Parser::ParseParameters(bool &ok) {
+  // (Type name, ...)
+  ScopedPtrList<VariableDeclaration> parameters(&pointer_buffer_);
+  Expect(Token::LeftParenthesis, ok);
+  if (ok && !Match(Token::RightParenthesis)) {
+    do {
+      VariableDeclaration *parameter = ParseVariableDeclaration(ok);
+      if (!ok) break;
+      if (parameter->initializer()) {
+        ReportError("parameters have no initializers");
+        ok = false;
+        break;
+      }
+      parameters.Add(parameter);
+    } while (Match(Token::Comma));
+    if (ok) Expect(Token::RightParenthesis, ok);
+  }
+  return ok ? parameters.ToSpan(zone_) : ZoneSpan<VariableDeclaration*>();
+}
+
+void Parser::PreParseFunctionBody(FunctionDeclaration *function, bool &ok) {
+  if (peek != Token::LeftBrace) {
+    ReportUnexpectedToken(Token::LeftBrace);
+    ok = false;
+    return;
+  }
+  std::uint32_t start = Position();
+  std::uint32_t end = start;
+  references_.clear();
+  Token previous = Token::Illegal;
+  int depth = 0;
+  do {
     switch (peek) {
-    case Token::Namespace:
-      decls.push_back(ParseNamespace(ok));
+    case Token::LeftBrace:
+      depth++;
       break;
-    case Token::Class:
-      decls.push_back(ParseClass(ok));
+    case Token::RightBrace:
+      depth--;
       break;
+    case Token::Identifier:
+      // Names after a period are members
+      if (previous != Token::Period)
+        references_.push_back(scanner_.GetTokenSymbol());
+      break;
+    case Token::EndOfSource:
+      ReportUnexpectedToken(Token::RightBrace);
+      ok = false;
+      return;
+    case Token::Illegal:
+      ReportError("illegal token");
+      ok = false;
+      return;
     default:
-      decls.push_back(ParseVariableOrFunction(ok));
       break;
     }
-    if (!ok) return nullptr;
+    previous = peek;
+    end = Position() + static_cast<std::uint32_t>(scanner_.GetTokenLength());
+    Advance();
+  } while (depth > 0);
+  // Sorted and without the parameters, which are not free
+  std::sort(references_.begin(), references_.end());
+  references_.erase(std::unique(references_.begin(), references_.end()),
+                    references_.end());
+  for (VariableDeclaration *parameter : function->parameters()) {
+    auto it = std::lower_bound(references_.begin(), references_.end(),
+                               parameter->symbol());
+    if (it != references_.end() && *it == parameter->symbol())
+      references_.erase(it);
   }
-
-  Expect(Token::RightBrace);
-
-  return new ast::NamespaceDeclaration(the_name, the_scope ,decls);
+  Symbol *names = zone_->NewArray<Symbol>(references_.size());
+  std::copy(references_.begin(), references_.end(), names);
+  StringSpan source = scanner_.GetSource();
+  function->set_lazy_body(start, StringSpan(source.data() + start, end - start),
+                          ZoneSpan<Symbol>(names, references_.size()));
 }
 
-ClassDeclaration* ParseClass(bool &ok) {
-  Expect(Token::Class);
-  std::string class_name = scanner_->GetTokenLiteral();
-  // Parent classes
-  if (peek == Token::LessThan) {
+// Statements
 
+Block* Parser::ParseBlock(bool &ok) {
+  std::uint32_t position = Position();
+  Expect(Token::LeftBrace, ok);
+  CHECK_ERROR(ok);
+  Scope *the_scope = NewScope(ScopeType::Block);
+  ScopedPtrList<Statement> stmts(&pointer_buffer_);
+  while (!Match(Token::RightBrace)) {
+    if (peek == Token::EndOfSource) {
+      ReportUnexpectedToken(Token::RightBrace);
+      ok = false;
+      return nullptr;
+    }
+    Statement *stmt = ParseStatement(ok);
+    CHECK_ERROR(ok);
+    stmts.Add(stmt);
   }
-  // Class body
-  Expect(Token::LeftBrace);
-  while (true) {
-    MemberVisibility visibility;
-    if (peek == Token::Public) {
-      visibility = MemberVisibility::Public;
-    } else if (peek == Token::Private) {
-      visibility = MemberVisibility::Private;
-    } else if (peek == Token::Protected) {
-      visibility = MemberVisibility::Protected;
-    } else if (peek == Token::Internal) {
-      visibility = MemberVisibility::Internal;
-    } else {
+  CloseScope(the_scope);
+  return factory_.New<Block>(position, the_scope, stmts.ToSpan(zone_));
+}
 
-    }
-    bool is_static = Match(Token::Static);
-    
+Statement* Parser::ParseStatement(bool &ok) {
+  std::uint32_t position = Position();
+  switch (peek) {
+  case Token::LeftBrace:
+    return ParseBlock(ok);
+  case Token::If:
+    return ParseIfStatement(ok);
+  case Token::For:
+    return ParseForStatement(ok);
+  case Token::While:
+    return ParseWhileStatement(ok);
+  case Token::Do:
+    return ParseDoWhileStatement(ok);
+  case Token::Switch:
+    return ParseSwitchStatement(ok);
+  case Token::Return:
+    return ParseReturnStatement(ok);
+  case Token::Break:
+    Advance();
+    Expect(Token::Semicolon, ok);
+    CHECK_ERROR(ok);
+    return factory_.New<BreakStatement>(position);
+  case Token::Continue:
+    Advance();
+    Expect(Token::Semicolon, ok);
+    CHECK_ERROR(ok);
+    return factory_.New<ContinueStatement>(position);
+  case Token::Const: {
+    Declaration *declaration = ParseConstantDeclaration(ok);
+    CHECK_ERROR(ok);
+    return factory_.New<DeclarationStatement>(position, declaration);
+  }
+  default: {
+    Statement *stmt = ParseSimpleStatement(ok);
+    CHECK_ERROR(ok);
+    Expect(Token::Semicolon, ok);
+    CHECK_ERROR(ok);
+    return stmt;
+  }
   }
-  Expect(Token::RightBrace);
 }
 
-Block* Parser::ParseBlock(Scope *the_scope, bool &ok) {
-  if (the_scope = nullptr) {
-    the_scope = NewScope();
+Statement* Parser::ParseSimpleStatement(bool &ok) {
+  std::uint32_t position = Position();
+  if (Tokens::IsType(peek) ||
+      (peek == Token::Identifier && IsDeclarationAhead())) {
+    Declaration *declaration = ParseVariableDeclaration(ok);
+    CHECK_ERROR(ok);
+    return factory_.New<DeclarationStatement>(position, declaration);
   }
-  Expect(Token::LeftBrace);
-  std::vector<Statement*> stmts;
-  while (true) {
-    switch (peek) {
-    case Token::If:
-      stmts.push_back(ParseIfStatement(ok));
-      CHECK_ERROR(ok);
-    case Token::For:
-      stmts.push_back(ParseForStatement(ok));
-      CHECK_ERROR(ok);
-    case Token::While:
-      stmts.push_back(ParseWhileStatement(ok));
-      CHECK_ERROR(ok);
-    case Token::DoWhile:
-      stmts.push_back(ParseDoWhileStatement(ok));
-      CHECK_ERROR(ok);
-    default:
+  Expression *expr = ParseExpression(ok);
+  CHECK_ERROR(ok);
+  return factory_.New<ExpressionStatement>(position, expr);
+}
 
-    }
+IfStatement* Parser::ParseIfStatement(bool &ok) {
+  // if (condition) statement [else statement]
+  std::uint32_t position = Position();
+  Expect(Token::If, ok);
+  Expect(Token::LeftParenthesis, ok);
+  CHECK_ERROR(ok);
+  Expression *cond = ParseExpression(ok);
+  CHECK_ERROR(ok);
+  Expect(Token::RightParenthesis, ok);
+  CHECK_ERROR(ok);
+  Statement *then_stmt = ParseStatement(ok);
+  CHECK_ERROR(ok);
+  Statement *else_stmt = nullptr;
+  if (Match(Token::Else)) {
+    else_stmt = ParseStatement(ok);
+    CHECK_ERROR(ok);
   }
-  Expect(Token::RightBrace);
+  return factory_.New<IfStatement>(position, cond, then_stmt, else_stmt);
 }
 
-Expression* ParseExpression(int rightBindingPower, bool &ok) {
-  Expression *left = ParseNullDenotation(ok);
-  if (!ok) return nullptr;
-  while (rightBindingPower < Tokens::Precedence(peek)) {
-    left = ParseLeftDenotation(left, ok);
-    if (!ok) return nullptr;
+ForStatement* Parser::ParseForStatement(bool &ok) {
+  // for ([initializer]; [condition]; [step]) statement
+  std::uint32_t position = Position();
+  Expect(Token::For, ok);
+  Expect(Token::LeftParenthesis, ok);
+  CHECK_ERROR(ok);
+  // The scope of the variables declared by the initializer
+  Scope *the_scope = NewScope(ScopeType::Block);
+  Statement *init = nullptr;
+  if (peek != Token::Semicolon) {
+    init = ParseSimpleStatement(ok);
+    CHECK_ERROR(ok);
+  }
+  Expect(Token::Semicolon, ok);
+  CHECK_ERROR(ok);
+  Expression *cond = nullptr;
+  if (peek != Token::Semicolon) {
+    cond = ParseExpression(ok);
+    CHECK_ERROR(ok);
+  }
+  Expect(Token::Semicolon, ok);
+  CHECK_ERROR(ok);
+  Expression *step = nullptr;
+  if (peek != Token::RightParenthesis) {
+    step = ParseExpression(ok);
+    CHECK_ERROR(ok);
   }
-  return left;
+  Expect(Token::RightParenthesis, ok);
+  CHECK_ERROR(ok);
+  Statement *body = ParseStatement(ok);
+  CHECK_ERROR(ok);
+  CloseScope(the_scope);
+  return factory_.New<ForStatement>(position, the_scope, init, cond, step,
+                                    body);
 }
 
-Expression* Parser::ParseLeftDenotation(Expression *left, bool &ok) {
-  Token op;
-  switch (peek) {
-  // Function application:
-  case Token::LeftParenthesis:
-    return ParseFunctionApplication(left, ok);
-  // Indexing
-  case Token::LeftBracket:
-    return ParseIndex(left, ok);
-  // Assignment operators
-  case Token::Assignment:
-  case Token::AssignmentBitwiseOr:
-  case Token::AssignmentBitwiseXor:
-  case Token::AssignmentBitwiseAnd:
-  case Token::AssignmentShiftLeft:
-  case Token::AssignmentShiftRight:
-  case Token::AssignmentAddition:
-  case Token::AssignmentSubtraction:
-  case Token::AssignmentMultiplication:
-  case Token::AssignmentDivision:
-  case Token::AssignmentModulus:
-    return new ast::AssignmentOperation()
-  // Binary operators
-  case Token::LogicalOr:
-  case Token::LogicalAnd:
-  case Token::BitwiseOr:
-  case Token::BitwiseXor:
-  case Token::BitwiseAnd:
-  case Token::ShiftLeft:
-  case Token::ShiftRight:
-  case Token::Addition:
-  case Token::Subtraction:
-  case Token::Multiplication:
-  case Token::Division:
-  case Token::Modulus:
-    op = peek;
-    Advance();
-    return new ast::ArithmeticOperation(op, left, ParseExpression())
-  // Compare operators
-  case Token::Equal:
-  case Token::NotEqual:
-  case Token::LessThan:
-  case Token::GreaterThan:
-  case Token::LessThanOrEqual:
-  case Token::GreaterThanOrEqual:
+WhileStatement* Parser::ParseWhileStatement(bool &ok) {
+  // while (condition) statement
+  std::uint32_t position = Position();
+  Expect(Token::While, ok);
+  Expect(Token::LeftParenthesis, ok);
+  CHECK_ERROR(ok);
+  Expression *cond = ParseExpression(ok);
+  CHECK_ERROR(ok);
+  Expect(Token::RightParenthesis, ok);
+  CHECK_ERROR(ok);
+  Statement *body = ParseStatement(ok);
+  CHECK_ERROR(ok);
+  return factory_.New<WhileStatement>(position, cond, body);
+}
 
-  default:
-    ReportSyntaxError("");
+DoWhileStatement* Parser::ParseDoWhileStatement(bool &ok) {
+  // do statement while (condition);
+  std::uint32_t position = Position();
+  Expect(Token::Do, ok);
+  CHECK_ERROR(ok);
+  Statement *body = ParseStatement(ok);
+  CHECK_ERROR(ok);
+  Expect(Token::While, ok);
+  Expect(Token::LeftParenthesis, ok);
+  CHECK_ERROR(ok);
+  Expression *cond = ParseExpression(ok);
+  CHECK_ERROR(ok);
+  Expect(Token::RightParenthesis, ok);
+  Expect(Token::Semicolon, ok);
+  CHECK_ERROR(ok);
+  return factory_.New<DoWhileStatement>(position, body, cond);
+}
+
+SwitchStatement* Parser::ParseSwitchStatement(bool &ok) {
+  // switch (value) { clauses }
+  std::uint32_t position = Position();
+  Expect(Token::Switch, ok);
+  Expect(Token::LeftParenthesis, ok);
+  CHECK_ERROR(ok);
+  Expression *value = ParseExpression(ok);
+  CHECK_ERROR(ok);
+  Expect(Token::RightParenthesis, ok);
+  Expect(Token::LeftBrace, ok);
+  CHECK_ERROR(ok);
+  ScopedPtrList<CaseClause> clauses(&pointer_buffer_);
+  while (!Match(Token::RightBrace)) {
+    CaseClause *clause = ParseCaseClause(ok);
+    CHECK_ERROR(ok);
+    clauses.Add(clause);
+  }
+  return factory_.New<SwitchStatement>(position, value,
+                                       clauses.ToSpan(zone_));
+}
+
+CaseClause* Parser::ParseCaseClause(bool &ok) {
+  // case label: statements or default: statements
+  std::uint32_t position = Position();
+  Expression *label = nullptr;
+  if (Match(Token::Case)) {
+    label = ParseExpression(ok);
+    CHECK_ERROR(ok);
+  } else if (!Match(Token::Default)) {
+    ReportUnexpectedToken(Token::Case);
     ok = false;
     return nullptr;
   }
+  Expect(Token::Colon, ok);
+  CHECK_ERROR(ok);
+  ScopedPtrList<Statement> stmts(&pointer_buffer_);
+  while (peek != Token::Case && peek != Token::Default &&
+         peek != Token::RightBrace) {
+    if (peek == Token::EndOfSource) {
+      ReportUnexpectedToken(Token::RightBrace);
+      ok = false;
+      return nullptr;
+    }
+    Statement *stmt = ParseStatement(ok);
+    CHECK_ERROR(ok);
+    stmts.Add(stmt);
+  }
+  return factory_.New<CaseClause>(position, label, stmts.ToSpan(zone_));
 }
 
-Expression* Parser::ParseNullDenotation(bool &ok) {
-  switch (peek) {
-  case Token::EndOfSource:
-    ReportSyntaxError("expect expressions instead of end of source");
+Statement* Parser::ParseReturnStatement(bool &ok) {
+  // return [value];
+  std::uint32_t position = Position();
+  Expect(Token::Return, ok);
+  Expression *value = nullptr;
+  if (peek != Token::Semicolon) {
+    value = ParseExpression(ok);
+    CHECK_ERROR(ok);
+  }
+  Expect(Token::Semicolon, ok);
+  CHECK_ERROR(ok);
+  return factory_.New<ReturnStatement>(position, value);
+}
+
+// Types
+
+TypeSpecifier* Parser::ParseTypeSpecifier(bool &ok) {
+  // int, or A.B.C [<arguments>]
+  std::uint32_t position = Position();
+  Token kind = peek;
+  StringSpan name = TokenText();
+  if (Tokens::IsType(peek)) {
+    Advance();
+  } else if (peek == Token::Identifier) {
+    const char *start = name.begin();
+    Advance();
+    while (peek == Token::Period && scanner_.Peek(1) == Token::Identifier) {
+      Advance();
+      name = StringSpan(start, TokenText().end());
+      Advance();
+    }
+  } else {
+    ReportError("expected a type");
     ok = false;
     return nullptr;
-  case Token::LeftParenthesis:
-    return ParseExpressionOrTupleOrConversion();
-  case Token::LeftBracket:
-    return ParseArrayLiteral();
-  case Token::Addition:
-  case Token::Subtraction:
-  case Token::LogicalNot:
-  case Token::BitwiseNot:
-  case Token::Increment:
-  case Token::Decrement:
-
-  case Token::Integer:
-  case Token::RealNumber:
-  case Token::String:
-  case Token::Character:
-  }
-}
-
-Expression* ParseExpressionOrTupleOrConversion(bool &ok) {
-  bool success = false;
-  // conversion
-  TypeSpecifier type = ParseTypeSpecifier(success);
-  if (success) {
-    Expect(Token::RightParenthesis);
-    Expression *expr = ParseExpression();
-    return new ast::Conversion(type, expr);
-  }
-  // parenthesis expression or tuple
-  std::vector<Expression*> tuples;
-  Expression *expr = nullptr;
-  while (true) {
-    expr = ParseExpression(0, ok);
-    if ()
-  }
-}
-
-Expression* ParseFunctionApplication(Expression *func, bool &ok) {
-  std::vector<Expression*> arguments;
-  Expect(Token::LeftParenthesis);
-  if (peek != Token::RightParenthesis) {
+  }
+  ScopedPtrList<TypeSpecifier> arguments(&pointer_buffer_);
+  if (Match(Token::LessThan)) {
     do {
-      Expression *arg = ParseExpression(0, ok);
+      TypeSpecifier *argument = ParseTypeSpecifier(ok);
       CHECK_ERROR(ok);
-      arguments.push_back(arg);
+      arguments.Add(argument);
     } while (Match(Token::Comma));
+    if (!MatchTypeArgumentsEnd()) {
+      ReportUnexpectedToken(Token::GreaterThan);
+      ok = false;
+      return nullptr;
+    }
   }
-  Expect(Token::RightParenthesis);
-  return new ast::Invoke(func, arguments);
+  return factory_.New<TypeSpecifier>(position, kind, name,
+                                     arguments.ToSpan(zone_));
 }
 
-Expression* ParseArrayLiteral(bool &ok) {
-  std::vector<Expression*> array_exprs;
-  while (true) {
-    if (Match(Token::RightBracket)) break;
-    array_exprs.push_back(ParseExpression(0, ok));
-    if (!ok) return nullptr;
-    Expect
+bool Parser::SkipTypeSpecifier() {
+  if (Tokens::IsType(peek)) {
+    Advance();
+  } else if (peek == Token::Identifier) {
+    Advance();
+    while (peek == Token::Period && scanner_.Peek(1) == Token::Identifier) {
+      Advance();
+      Advance();
+    }
+  } else {
+    return false;
   }
+  if (Match(Token::LessThan)) {
+    do {
+      if (!SkipTypeSpecifier()) return false;
+    } while (Match(Token::Comma));
+    return MatchTypeArgumentsEnd();
+  }
+  return true;
 }
 
-ForStatement* ParseForStatement(bool &ok) {
-  // Create the scope
-  Scope *the_scope = NewScope(ScopeType::Block);
-  // Parse for (
-  Expect(Token::For);
-  Expect(Token::LeftParenthesis);
-  union {
-    Expression *init_expr;
-    VariableDeclaration *init_decl;
+bool Parser::MatchTypeArgumentsEnd() {
+  switch (peek) {
+  case Token::GreaterThan:
+    Advance();
+    return true;
+  case Token::ShiftRight:
+  case Token::AssignmentShiftRight:
+  case Token::GreaterThanOrEqual:
+    previous_end_ = Position() + 1;
+    peek = scanner_.SplitGreaterThan();
+    return true;
+  default:
+    return false;
+  }
+}
+
+bool Parser::IsDeclarationAhead() {
+  Scanner::Checkpoint checkpoint = scanner_.SaveCheckpoint();
+  bool declaration = SkipTypeSpecifier() && peek == Token::Identifier;
+  peek = scanner_.Rewind(checkpoint);
+  return declaration;
+}
+
+// Expressions
+
+Expression* Parser::ParseExpression(int power, bool &ok) {
+  std::size_t base = frames_.size();
+  std::size_t list_base = pointer_buffer_.size();
+  while (ok) {
+    // An operand, after the prefix operators and the opening brackets
+    // before it which are pushed as frames
+    NullDenotation nud = kNullDenotations[static_cast<int>(peek)];
+    if (!nud) {
+      ReportError("expected an expression");
+      ok = false;
+      break;
+    }
+    Expression *operand = (this->*nud)(ok);
+    // The operators after the operand which bind tighter than the one
+    // waiting for it, then the frames it completes
+    while (operand) {
+      int waiting = frames_.size() == base ? power : frames_.back().power;
+      LeftDenotation led = kLeftDenotations[static_cast<int>(peek)];
+      if (led && kLeftPowers[static_cast<int>(peek)] > waiting) {
+        operand = (this->*led)(operand, ok);
+      } else if (frames_.size() == base) {
+        return operand;
+      } else {
+        operand = ReduceFrame(operand, ok);
+      }
+    }
+  }
+  frames_.resize(base);
+  pointer_buffer_.resize(list_base);
+  return nullptr;
+}
+
+void Parser::PushFrame(FrameKind kind, Token op, int power,
+                       std::uint32_t position, Expression *left, Node *extra) {
+  ExpressionFrame frame = {
+    kind, op, static_cast<std::uint8_t>(power), position, left, extra,
+    pointer_buffer_.size()
   };
-  bool init_is_decl;
-  scanner_->SaveBookmark();
-  init_decl = ParseVariableDeclaration(init_is_decl);
-  if (init_is_decl) {
-    scanner_->ClearBookmark();
-  } else {
-    scanner_->LoadBookmark();
-    init_expr = ParseExpression(0, ok);
-  }
-  // Parse ; cond
-  Expect(Token::Semicolon);
-  Expression *cond = ParseExpression(0, ok);
-  Expect(Token::Semicolon);
-  Expression *extra = ParseExpression(0, ok);
-  Expect(Token::RightParenthesis);
-  // Parse the loop body
-  if (peek == Token::LeftBrace) {
-    Block *body = ParseBlock(the_scope, ok);
+  frames_.push_back(frame);
+}
+
+Expression* Parser::ReduceFrame(Expression *operand, bool &ok) {
+  ExpressionFrame &frame = frames_.back();
+  Expression *result;
+  Token closing = Token::RightParenthesis;
+  switch (frame.kind) {
+  case FrameKind::Prefix:
+    result = factory_.New<UnaryOperation>(frame.position, frame.op, operand,
+                                          false);
+    break;
+  case FrameKind::Conversion:
+    result = factory_.New<Conversion>(
+        frame.position, static_cast<TypeSpecifier*>(frame.extra), operand);
+    break;
+  case FrameKind::Binary:
+    if (Tokens::IsCompareOperator(frame.op)) {
+      result = factory_.New<CompareOperation>(frame.position, frame.op,
+                                              frame.left, operand);
+    } else {
+      result = factory_.New<ArithmeticOperation>(frame.position, frame.op,
+                                                 frame.left, operand);
+    }
+    break;
+  case FrameKind::Assignment:
+    result = factory_.New<AssignmentOperation>(frame.position, frame.op,
+                                               frame.left, operand);
+    break;
+  case FrameKind::Then:
+    // The else expression binds like the right operand of an assignment
+    Expect(Token::Colon, ok);
+    if (!ok) return nullptr;
+    frame.kind = FrameKind::Else;
+    frame.extra = operand;
+    frame.power = kConditionalPower - 1;
+    return nullptr;
+  case FrameKind::Else:
+    result = factory_.New<Conditional>(frame.position, frame.left,
+                                       static_cast<Expression*>(frame.extra),
+                                       operand);
+    break;
+  case FrameKind::Index:
+    Expect(Token::RightBracket, ok);
+    if (!ok) return nullptr;
+    result = factory_.New<Index>(frame.position, frame.left, operand);
+    break;
+  case FrameKind::Array:
+    closing = Token::RightBracket;
+    // Fall through
+  case FrameKind::Group:
+  case FrameKind::Invoke:
+    if (Match(Token::Comma)) {
+      pointer_buffer_.push_back(operand);
+      return nullptr;
+    }
+    Expect(closing, ok);
+    if (!ok) return nullptr;
+    if (frame.kind == FrameKind::Group) {
+      result = frame.list_start == pointer_buffer_.size() ? operand :
+          factory_.New<Tuple>(frame.position,
+                              PopList(frame.list_start, operand));
+    } else if (frame.kind == FrameKind::Invoke) {
+      result = factory_.New<Invoke>(frame.position, frame.left,
+                                    PopList(frame.list_start, operand));
+    } else {
+      result = factory_.New<ArrayLiteral>(frame.position,
+                                          PopList(frame.list_start, operand));
+    }
+    break;
+  default:
+    UNREACHABLE();
+  }
+  frames_.pop_back();
+  return result;
+}
+
+ZoneSpan<Expression*> Parser::PopList(std::size_t start, Expression *last) {
+  pointer_buffer_.push_back(last);
+  std::size_t count = pointer_buffer_.size() - start;
+  Expression **data = zone_->NewArray<Expression*>(count);
+  for (std::size_t i = 0; i < count; i++)
+    data[i] = static_cast<Expression*>(pointer_buffer_[start + i]);
+  pointer_buffer_.resize(start);
+  return ZoneSpan<Expression*>(data, count);
+}
+
+Expression* Parser::ParseLiteral(bool &) {
+  NumberLiteral number = scanner_.GetTokenNumber();
+  if (peek != Token::Integer && peek != Token::RealNumber) {
+    number.type = Token::Illegal;
+    number.integer = 0;
+  }
+  Expression *literal =
+      factory_.New<Literal>(Position(), peek, TokenLiteral(), number);
+  Advance();
+  return literal;
+}
+
+Expression* Parser::ParseVariable(bool &) {
+  Expression *variable = factory_.New<Variable>(Position(), TokenText(),
+                                                scanner_.GetTokenSymbol());
+  Advance();
+  return variable;
+}
+
+Expression* Parser::ParsePrefixOperation(bool &) {
+  PushFrame(FrameKind::Prefix, peek, kPrefixPower, Position(), nullptr,
+            nullptr);
+  Advance();
+  return nullptr;
+}
+
+Expression* Parser::ParseParenthesis(bool &ok) {
+  // (expression), (expressions, ...), (Type) expression or a lambda
+  if (IsLambdaAhead()) return ParseLambda(ok);
+  std::uint32_t position = Position();
+  Advance();
+  if (Tokens::IsType(peek)) {
+    TypeSpecifier *type = ParseTypeSpecifier(ok);
+    CHECK_ERROR(ok);
+    Expect(Token::RightParenthesis, ok);
+    CHECK_ERROR(ok);
+    PushFrame(FrameKind::Conversion, Token::LeftParenthesis, kPrefixPower,
+              position, nullptr, type);
   } else {
-    Statement *body = ParseStatement(ok);
+    PushFrame(FrameKind::Group, Token::LeftParenthesis, 0, position, nullptr,
+              nullptr);
+  }
+  return nullptr;
+}
+
+Expression* Parser::ParseArrayLiteral(bool &) {
+  // [elements, ...]
+  std::uint32_t position = Position();
+  Advance();
+  if (Match(Token::RightBracket))
+    return factory_.New<ArrayLiteral>(position, ZoneSpan<Expression*>());
+  PushFrame(FrameKind::Array, Token::LeftBracket, 0, position, nullptr,
+            nullptr);
+  return nullptr;
+}
+
+bool Parser::IsLambdaAhead() {
+  // The parameters are declarations, and => follows them
+  Scanner::Checkpoint checkpoint = scanner_.SaveCheckpoint();
+  Advance();
+  bool lambda = true;
+  if (peek != Token::RightParenthesis) {
+    do {
+      lambda = SkipTypeSpecifier() && Match(Token::Identifier);
+    } while (lambda && Match(Token::Comma));
   }
-  return new ast::ForStatement();
+  lambda = lambda && Match(Token::RightParenthesis) && peek == Token::Arrow;
+  peek = scanner_.Rewind(checkpoint);
+  return lambda;
 }
 
-WhileStatement* ParseWhileStatement(bool &ok) {
-  Expect(Token::While);
-  Expect(Token::LeftParenthesis);
-  Expression *cond = ParseExpression(0, ok);
-  RETURN_IF_ERROR(ok);
-  Expect(Token::RightParenthesis);
+Expression* Parser::ParseLambda(bool &ok) {
+  // (parameters) => { body } or (parameters) => expression
+  std::uint32_t position = Position();
+  Scope *the_scope = NewScope(ScopeType::Function);
+  ZoneSpan<VariableDeclaration*> parameters = ParseParameters(ok);
+  CHECK_ERROR(ok);
+  Expect(Token::Arrow, ok);
+  CHECK_ERROR(ok);
+  Statement *body;
   if (peek == Token::LeftBrace) {
-    Block *body = ParseBlock(the_scope, ok);
-    RETURN_IF_ERROR(ok);
+    body = ParseBlock(ok);
   } else {
-    Statement *body = ParseStatement(ok);
-    RETURN_IF_ERROR(ok);
+    std::uint32_t body_position = Position();
+    Expression *expr = ParseExpression(ok);
+    CHECK_ERROR(ok);
+    body = factory_.New<ExpressionStatement>(body_position, expr);
   }
-}
\ No newline at end of file
+  CHECK_ERROR(ok);
+  CloseScope(the_scope);
+  return factory_.New<Lambda>(position, the_scope, parameters, body);
+}
+
+Expression* Parser::ParseBinaryOperation(Expression *left, bool &) {
+  Token op = peek;
+  PushFrame(Tokens::IsAssignment(op) ? FrameKind::Assignment :
+                                       FrameKind::Binary,
+            op, kRightPowers[static_cast<int>(op)], left->position(), left,
+            nullptr);
+  Advance();
+  return nullptr;
+}
+
+Expression* Parser::ParseConditional(Expression *left, bool &) {
+  // condition ? then : else
+  PushFrame(FrameKind::Then, Token::Conditional, 0, left->position(), left,
+            nullptr);
+  Advance();
+  return nullptr;
+}
+
+Expression* Parser::ParseInvoke(Expression *left, bool &) {
+  // callee(arguments, ...)
+  Advance();
+  if (Match(Token::RightParenthesis)) {
+    return factory_.New<Invoke>(left->position(), left,
+                                ZoneSpan<Expression*>());
+  }
+  PushFrame(FrameKind::Invoke, Token::LeftParenthesis, 0, left->position(),
+            left, nullptr);
+  return nullptr;
+}
+
+Expression* Parser::ParseIndex(Expression *left, bool &) {
+  // object[index]
+  PushFrame(FrameKind::Index, Token::LeftBracket, 0, left->position(), left,
+            nullptr);
+  Advance();
+  return nullptr;
+}
+
+Expression* Parser::ParseMemberAccess(Expression *left, bool &ok) {
+  // object.name
+  Advance();
+  if (peek != Token::Identifier) {
+    ReportUnexpectedToken(Token::Identifier);
+    ok = false;
+    return nullptr;
+  }
+  Expression *access =
+      factory_.New<MemberAccess>(left->position(), left, TokenText(),
+                                 scanner_.GetTokenSymbol());
+  Advance();
+  return access;
+}
+
+Expression* Parser::ParsePostfixOperation(Expression *left, bool &) {
+  Expression *operation =
+      factory_.New<UnaryOperation>(left->position(), peek, left, true);
+  Advance();
+  return operation;
+}
+
+}
@@ -1,76 +1,229 @@
 #ifndef FLORA_PARSER_H
 #define FLORA_PARSER_H
 
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+
 #include "flora.h"
 #include "ast.h"
 #include "token.h"
 #include "scanner.h"
+#include "scope.h"
+#include "symbol-table.h"
+#include "zone.h"
 
 #define CHECK_ERROR(ok) if (!ok) return nullptr
 
 namespace flora {
 
+// Sizes of a parse, for choosing the segment size of zones
+struct ParseStatistics {
+  std::size_t node_count;
+  std::size_t zone_bytes;
+};
+
 class Parser {
 public:
   NOCOPY_CLASS(Parser)
 
-  Parser();
+  // The nodes and scopes of the translation unit are allocated in the
+  // zone, deleting or resetting the zone releases the whole tree.
+  // Identifiers are interned into the symbol table, which may be shared
+  // by the parsers of several translation units.
+  Parser(Zone *zone, SymbolTable *symbols);
   ~Parser();
 
-  
+  // Parse a translation unit, the source must outlive the tree. Returns
+  // nullptr if there is a syntax error.
+  ast::TranslationUnit* Parse(const char *source, std::size_t length);
+
+  // In lazy mode the bodies of functions are pre-parsed: only their braces
+  // are matched and the names they refer to recorded, and they are left
+  // without a body. Lexical errors in the bodies are reported, syntax
+  // errors only once the bodies are parsed.
+  void set_lazy(bool lazy) { lazy_ = lazy; }
+  bool lazy() const { return lazy_; }
+
+  // Parse the body of a pre-parsed function of the last translation unit,
+  // whose source must still be alive. Returns the body it already has if
+  // it is parsed, and nullptr if there is a syntax error.
+  ast::Block* ParseLazyFunction(ast::FunctionDeclaration *function);
+
+  // Parse the declaration at the offset of the source into the scope of
+  // the translation unit, a namespace or a class, for reparsing part of a
+  // tree. Returns nullptr if there is a syntax error.
+  ast::Declaration* ParseDeclarationAt(const char *source,
+                                       std::size_t length,
+                                       std::size_t offset, Scope *scope);
+
+  // The first syntax error of the last parse
+  const std::string& error_message() const { return error_message_; }
+  std::uint32_t error_position() const { return error_position_; }
+
+  // The nodes and zone bytes of the last parse, a translation unit, a
+  // lazy body or a declaration
+  ParseStatistics statistics() const { return statistics_; }
 
 private:
-
-#ifdef FLORA_DEBUG
-  // debugger printer
-  ParserDebugLogger debug_logger_;
-  ParserCallStackTracer call_stack_tracer_;
-#endif
   // The scanner
   Scanner scanner_;
+  // Owns everything the parser creates
+  Zone *zone_;
+  SymbolTable *symbols_;
+  ast::AstNodeFactory factory_;
+  // Shared by the ScopedPtrLists of nested lists under construction
+  std::vector<void*> pointer_buffer_;
+  ParseStatistics statistics_;
+  // The counts of the factory and the zone when the parse started
+  ParseStatistics statistics_start_;
+  std::string error_message_;
+  std::uint32_t error_position_;
+  bool lazy_;
+  // The names referred to by the body being pre-parsed
+  std::vector<Symbol> references_;
+  // Start scanning at the offset of the source
+  void Initialize(const char *source, std::size_t length,
+                  std::size_t offset);
+  // Set the statistics to what the parse added to the factory and zone
+  void RecordStatistics();
   // The current token
   Token peek;
+  // The offset after the last token before the current one
+  std::uint32_t previous_end_;
   INLINE(Token Advance());
-  INLINE(void Expect(Token expected));
+  INLINE(void Expect(Token expected, bool &ok));
   INLINE(bool Match(Token expected));
+  // The offset of the current token
+  INLINE(std::uint32_t Position());
+  // The literal of the current token, copied into the zone if it does
+  // not point into the source
+  StringSpan TokenLiteral();
+  // The source text of the current token
+  StringSpan TokenText();
 
   // current scope
   Scope *current_;
 
-  Scope* NewScope();
+  Scope* NewScope(ScopeType type) {
+    current_ = new (zone_) Scope(zone_, type, current_);
+    return current_;
+  }
+  void CloseScope(Scope *scope) { current_ = scope->outer(); }
 
+  // Only the first error is kept
   void ReportError(const char *message);
   void ReportUnexpectedToken(Token expected);
 
-  void ParseProgram(bool &ok);
-
-  NamespaceDeclararion* ParseNamespaceDeclaration(bool &ok);
-  ClassDeclararion* ParseClassDeclaration(bool &ok);
-  FunctionDeclararion* ParseFunctionDeclaration(bool &ok);
-  ConstantDeclararion* ParseConstantDeclaration(bool &ok);
-  VariableDeclararion* ParseVariableDeclaration(bool &ok);
-
-  Block* ParseBlock(Scope *the_scope, bool &ok);
-  Statement* ParseStatement(bool &ok);
-  IfStatement* ParseIfStatement(bool &ok);
-  ForStatement* ParseForStatement(bool &ok);
-  WhileStatement* ParseWhileStatement(bool &ok);
-  DoWhileStatement* ParseDoWhileStatement(bool &ok);
-  CaseClause* ParseCaseClause(bool &ok);
-  SwitchStatement* ParseSwitchStatement(bool &ok);
-
-  TypeSpecifier* ParseTypeSpecifier(bool &ok);
-
-  Expression* ParseExpression(bool &ok);
-  Expression* ParseNullDenotation(bool &ok);
-  Expression* ParseLeftDenotation(Expression *left, bool &ok);
-  Expression* ParseCondition(Expression *cond, bool &ok);
-
-  Expression* ParseArrayLiteral(bool &ok);
-  Expression* ParseLambdaExpression(bool &ok);
-
+  // Declarations
+  ast::TranslationUnit* ParseProgram(bool &ok);
+  ast::Declaration* ParseDeclaration(bool &ok);
+  ast::ImportDeclaration* ParseImportDeclaration(bool &ok);
+  ast::NamespaceDeclaration* ParseNamespaceDeclaration(bool &ok);
+  ast::ClassDeclaration* ParseClassDeclaration(bool &ok);
+  ast::ConstantDeclaration* ParseConstantDeclaration(bool &ok);
+  // Type name = initializer; or Type name(parameters) { body }
+  ast::Declaration* ParseVariableOrFunctionDeclaration(bool &ok);
+  ast::VariableDeclaration* ParseVariableDeclaration(bool &ok);
+  // [= initializer] after the name of a variable
+  ast::VariableDeclaration* ParseVariableRest(std::uint32_t position,
+                                              StringSpan name, Symbol symbol,
+                                              ast::TypeSpecifier *type,
+                                              bool &ok);
+  ast::FunctionDeclaration* ParseFunctionRest(std::uint32_t position,
+                                              StringSpan name, Symbol symbol,
+                                              ast::TypeSpecifier *return_type,
+                                              bool &ok);
+  ZoneSpan<ast::VariableDeclaration*> ParseParameters(bool &ok);
+  // Match the braces of a function body and record the names it refers to
+  void PreParseFunctionBody(ast::FunctionDeclaration *function, bool &ok);
+
+  // Statements
+  ast::Block* ParseBlock(bool &ok);
+  ast::Statement* ParseStatement(bool &ok);
+  ast::IfStatement* ParseIfStatement(bool &ok);
+  ast::ForStatement* ParseForStatement(bool &ok);
+  ast::WhileStatement* ParseWhileStatement(bool &ok);
+  ast::DoWhileStatement* ParseDoWhileStatement(bool &ok);
+  ast::SwitchStatement* ParseSwitchStatement(bool &ok);
+  ast::CaseClause* ParseCaseClause(bool &ok);
+  ast::Statement* ParseReturnStatement(bool &ok);
+  // A local variable or constant, or an expression
+  ast::Statement* ParseSimpleStatement(bool &ok);
+
+  // Types
+  ast::TypeSpecifier* ParseTypeSpecifier(bool &ok);
+  // Skips a type specifier if there is one, for looking ahead
+  bool SkipTypeSpecifier();
+  // Match the '>' closing type arguments. It may be the first character
+  // of '>>', '>>=' or '>=', the rest of which becomes the current token.
+  bool MatchTypeArgumentsEnd();
+  // Returns true if a type specifier and a name follow
+  bool IsDeclarationAhead();
+
+  // Expressions are parsed by a Pratt parser. The denotations of each
+  // token are found in tables indexed by the token, and the operators
+  // waiting for their right operand are kept on frames_ instead of the
+  // call stack, so long chains and deep nesting need no recursion.
+  enum class FrameKind : std::uint8_t {
+    Prefix, Conversion, Binary, Assignment, Then, Else, Group, Invoke, Index,
+    Array
+  };
+  struct ExpressionFrame {
+    FrameKind kind;
+    Token op;
+    // Only operators binding tighter than this join the operand
+    std::uint8_t power;
+    std::uint32_t position;
+    // The left operand, the callee, the indexed object or the condition
+    ast::Expression *left;
+    // The then expression of a conditional or the type of a conversion
+    ast::Node *extra;
+    // Where the elements of a list start in pointer_buffer_
+    std::size_t list_start;
+  };
+  std::vector<ExpressionFrame> frames_;
+
+  // Null denotations either return an operand, or push a frame and return
+  // nullptr to ask for the operand of the frame. Left denotations do the
+  // same with the operand before them.
+  typedef ast::Expression* (Parser::*NullDenotation)(bool &ok);
+  typedef ast::Expression* (Parser::*LeftDenotation)(ast::Expression *left,
+                                                     bool &ok);
+  static const NullDenotation kNullDenotations[];
+  static const LeftDenotation kLeftDenotations[];
+
+  // Parse an expression of operators binding tighter than the power
+  ast::Expression* ParseExpression(int power, bool &ok);
+  ast::Expression* ParseExpression(bool &ok) { return ParseExpression(0, ok); }
+  void PushFrame(FrameKind kind, Token op, int power, std::uint32_t position,
+                 ast::Expression *left, ast::Node *extra);
+  // Complete the top frame with its last operand. Returns nullptr if the
+  // frame takes another operand.
+  ast::Expression* ReduceFrame(ast::Expression *operand, bool &ok);
+  ZoneSpan<ast::Expression*> PopList(std::size_t start,
+                                     ast::Expression *last);
+
+  ast::Expression* ParseLiteral(bool &ok);
+  ast::Expression* ParseVariable(bool &ok);
+  ast::Expression* ParsePrefixOperation(bool &ok);
+  ast::Expression* ParseParenthesis(bool &ok);
+  ast::Expression* ParseArrayLiteral(bool &ok);
+  ast::Expression* ParseLambda(bool &ok);
+  ast::Expression* ParseBinaryOperation(ast::Expression *left, bool &ok);
+  ast::Expression* ParseConditional(ast::Expression *left, bool &ok);
+  ast::Expression* ParseInvoke(ast::Expression *left, bool &ok);
+  ast::Expression* ParseIndex(ast::Expression *left, bool &ok);
+  ast::Expression* ParseMemberAccess(ast::Expression *left, bool &ok);
+  ast::Expression* ParsePostfixOperation(ast::Expression *left, bool &ok);
+  // Returns true if the parenthesis starts a lambda
+  bool IsLambdaAhead();
+
+  static constexpr NullDenotation NullDenotationOf(Token token);
+  static constexpr LeftDenotation LeftDenotationOf(Token token);
 };
 
 }
 
-#endif
\ No newline at end of file
+#endif
@@ -1,118 +1,252 @@
-#include "debug.h"
 #include "scanner.h"
 
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "character-search.h"
+#include "operator-dfa.h"
+#include "token-buffer.h"
+#include "utf8.h"
+
 namespace flora {
 
 // Public Methods
 
 Scanner::Scanner() {
   state_ = Scanner::State::Uninitialized;
-  stream_ = nullptr;
+  source_ = cursor_ = limit_ = nullptr;
+  token_start_ = nullptr;
   peek = 0;
+  peek_length_ = 0;
+  symbols_ = nullptr;
+  symbol_ = kNoSymbol;
+  number_.type = Token::Int;
+  number_.integer = 0;
+  ResetLookahead();
 }
 
 Scanner::~Scanner() {
   
 }
 
-void Scanner::Initialize(CharacterStream *stream) {
-  stream_ = stream;
+void Scanner::Initialize(const char *source, std::size_t length) {
+  Initialize(source, length, 0);
+}
+
+void Scanner::Initialize(const char *source, std::size_t length,
+                         std::size_t offset) {
+  source_ = source;
+  cursor_ = source + offset;
+  limit_ = source + length;
+  token_start_ = cursor_;
   state_ = Scanner::State::Running;
-  peek = stream->Advance();
+  peek = 0;
+  peek_length_ = 0;
+  Next();
+  ResetLookahead();
+}
+
+void Scanner::Initialize(CharacterStream *stream) {
+  buffer_.clear();
+  for (char32_t ch; (ch = stream->Advance()) != character::EOS; )
+    utf8::Append(&buffer_, ch);
+  Initialize(buffer_.data(), buffer_.size());
 }
 
 Token Scanner::Advance() {
-  switch (state_) {
-  case Scanner::State::Uninitialized:
+  if (state_ == Scanner::State::Uninitialized) {
+    // The placeholder record repeats from now on
     ReportScannerError("the scanner is uninitialized");
-    return Token::Illegal;
+    ring_[current_ & kLookaheadMask].literal = literal_;
+  }
+  current_++;
+  if (current_ == scanned_) ScanIntoRing();
+  return Current().token;
+}
 
-  case Scanner::State::Running:
-    return Scan();
+Token Scanner::Peek(std::size_t n) {
+  CHECK(n < kLookaheadCapacity);
+  while (current_ + n >= scanned_) ScanIntoRing();
+  return ring_[(current_ + n) & kLookaheadMask].token;
+}
+
+void Scanner::TokenizeAll(TokenBuffer *tokens) {
+  // Typical sources have a token every 4 to 8 characters
+  tokens->Reserve(tokens->size() + (limit_ - cursor_) / 6 + 1);
+  TokenizeUntil(tokens, limit_ - source_ + 1);
+}
 
-  case Scanner::State::Recording: {
-    Token token = Scan();
-    records_.push(std::make_pair(token, literal_));
-    return token;
+void Scanner::TokenizeUntil(TokenBuffer *tokens, std::size_t offset) {
+  tokens->set_source(StringSpan(source_, limit_));
+  if (static_cast<std::size_t>(limit_ - source_) > UINT32_MAX) {
+    ReportScannerError("source is too large to tokenize");
+    tokens->Append(Token::Illegal, 0, 0, literal_);
+    return;
   }
+  while (true) {
+    Token token = Advance();
+    if (GetTokenOffset() >= offset && token != Token::EndOfSource)
+      break;
+    AppendToken(tokens, token);
+    if (token == Token::EndOfSource || token == Token::Illegal)
+      break;
+  }
+}
 
-  case Scanner::State::Restoring: {
-    // Sequeeze the first recorded token
-    std::pair<Token, std::string> &token = records_.front();
-    records_.pop();
-    // Check if no more recorded tokens
-    if (records_.empty())
-      state_ = Scanner::State::Running;
-    SetTokenLiteral(token.second);
-    return token.first;
+void Scanner::AppendToken(TokenBuffer *tokens, Token token) const {
+  const Record &record = Current();
+  std::uint32_t offset = static_cast<std::uint32_t>(record.start - source_);
+  std::uint32_t length = static_cast<std::uint32_t>(record.end - record.start);
+  if (token == Token::Integer || token == Token::RealNumber) {
+    tokens->Append(token, offset, length, record.number);
+  } else if (record.literal.empty() || (record.literal.data() >= source_ &&
+                                        record.literal.data() < limit_)) {
+    tokens->Append(token, offset, length);
+  } else {
+    tokens->Append(token, offset, length, record.literal);
   }
+}
 
-  case Scanner::State::End:
-    return Token::EndOfSource;
+Scanner::Checkpoint Scanner::SaveCheckpoint() const {
+  Checkpoint checkpoint = { current_, Current().start };
+  return checkpoint;
+}
 
-  case Scanner::State::Error:
-    return Token::Illegal;
+Token Scanner::Rewind(const Checkpoint &checkpoint) {
+  // Without a source every record is the same error
+  if ((checkpoint.index + kLookaheadCapacity >= scanned_ &&
+       checkpoint.index >= split_) || !source_) {
+    // Still in the ring, and not split since
+    current_ = checkpoint.index;
+    return Current().token;
+  }
+  // Tokens carry no state, so scanning again from the start of the
+  // checkpoint token gives the same tokens
+  state_ = Scanner::State::Running;
+  Seek(checkpoint.start);
+  // Splits before the checkpoint may remain in the tokens before it
+  std::size_t split = std::min(split_, checkpoint.index);
+  ResetLookahead();
+  split_ = split;
+  if (checkpoint.index > 0) {
+    current_ = scanned_ = checkpoint.index;
+    ScanIntoRing();
   }
-  UNREACHABLE();
+  return Current().token;
 }
 
-void Scanner::SaveBookmark() {
-  // Clean the recording queue
-  while (!records_.empty())
-    records_.pop();
-  // Set state to recording
-  state_ = Scanner::State::Recording;
+Token Scanner::SplitGreaterThan() {
+  Record &record = ring_[current_ & kLookaheadMask];
+  switch (record.token) {
+  case Token::ShiftRight:
+    record.token = Token::GreaterThan;
+    break;
+  case Token::AssignmentShiftRight:
+    record.token = Token::GreaterThanOrEqual;
+    break;
+  case Token::GreaterThanOrEqual:
+    record.token = Token::Assignment;
+    break;
+  default:
+    UNREACHABLE();
+  }
+  record.start++;
+  split_ = current_ + 1;
+  return record.token;
 }
 
-void Scanner::LoadBookmark() {
-  // Set state to restoring
-  state_ = Scanner::State::Restoring;
+StringSpan Scanner::GetTokenLiteral() const {
+  return Current().literal;
 }
 
-void Scanner::ClearBookmark() {
-  // Clean the recording queue
-  while (!records_.empty())
-    records_.pop();
-  // Set state to running
-  state_ = Scanner::State::Running;
+std::size_t Scanner::GetTokenOffset() const {
+  return Current().start - source_;
 }
 
-const std::string& Scanner::GetTokenLiteral() {
-  return literal_;
+std::size_t Scanner::GetTokenLength() const {
+  return Current().end - Current().start;
 }
 
 // Private methods
 
 char32_t Scanner::Next() {
   char32_t save = peek;
-  peek = stream_->Advance();
+  cursor_ += peek_length_;
+  if (cursor_ != limit_ && static_cast<unsigned char>(*cursor_) < 0x80) {
+    peek = static_cast<unsigned char>(*cursor_);
+    peek_length_ = 1;
+  } else {
+    DecodePeek();
+  }
   return save;
 }
 
+void Scanner::DecodePeek() {
+  if (cursor_ == limit_) {
+    peek = character::EOS;
+    peek_length_ = 0;
+  } else {
+    peek_length_ = utf8::Decode(cursor_, limit_, &peek);
+    if (peek_length_ == 0) {
+      peek = character::MALFORMED;
+      peek_length_ = 1;
+    }
+  }
+}
+
 bool Scanner::Match(char32_t expected) {
   if (expected == peek) {
-    peek = stream_->Advance();
+    Next();
     return true;
   }
   return false;
 }
 
-void Scanner::SetTokenLiteral(const char *literal) {
-  literal_ = literal;
+const char* Scanner::PeekPosition() const {
+  return cursor_;
 }
 
-void Scanner::SetTokenLiteral(std::string &literal) {
-  literal_ = std::move(literal);
+void Scanner::Seek(const char *position) {
+  cursor_ = position;
+  peek_length_ = 0;
+  Next();
 }
 
-void Scanner::SetTokenLiteral(char literal) {
-  literal_.clear();
-  literal_.push_back(literal);
+void Scanner::SetTokenLiteral(StringSpan literal) {
+  literal_ = literal;
+}
+
+void Scanner::SetTokenLiteral(const char *start, const char *end) {
+  literal_ = StringSpan(start, end);
 }
 
+void Scanner::SetTokenLiteral(char32_t codepoint) {
+  literal_buffer_.clear();
+  utf8::Append(&literal_buffer_, codepoint);
+  literal_ = StringSpan(literal_buffer_);
+}
 
 void Scanner::ClearTokenLiteral() {
-  literal_.clear();
+  literal_ = StringSpan();
+}
+
+bool Scanner::SetIntegerValue(const char *digits, int base) {
+  std::uint64_t value;
+  if (!StringToUint64(digits, PeekPosition(), base, &value)) return false;
+  // Decimal literals are int or long. Literals with a base prefix are bit
+  // patterns, so they may also be unsigned and use the sign bit of long.
+  if (value <= INT32_MAX) {
+    number_.type = Token::Int;
+  } else if (base != 10 && value <= UINT32_MAX) {
+    number_.type = Token::Unsigned;
+  } else if (base != 10 || value <= INT64_MAX) {
+    number_.type = Token::Long;
+  } else {
+    return false;
+  }
+  number_.integer = value;
+  return true;
 }
 
 void Scanner::ReportScannerError(const char *message) {
@@ -124,11 +258,74 @@ void Scanner::MarkEndOfSource() {
   state_ = Scanner::State::End;
 }
 
+void Scanner::ScanIntoRing() {
+  Record &record = ring_[scanned_ & kLookaheadMask];
+  if (state_ == Scanner::State::Running) {
+    record.token = Scan();
+    record.start = token_start_;
+    record.end = PeekPosition();
+    record.symbol = record.token == Token::Identifier ? symbol_ : kNoSymbol;
+    record.number = number_;
+    if (!literal_.empty() && literal_.data() == literal_buffer_.data()) {
+      // Trade buffers with the slot, both keep their storage
+      record.decoded.swap(literal_buffer_);
+      record.literal = StringSpan(record.decoded);
+    } else {
+      record.literal = literal_;
+    }
+  } else {
+    // After the end of source or an error the last token repeats
+    const Record &last = ring_[(scanned_ - 1) & kLookaheadMask];
+    record.token = last.token;
+    record.start = last.start;
+    record.end = last.end;
+    record.symbol = last.symbol;
+    record.number = last.number;
+    if (!last.literal.empty() && last.literal.data() == last.decoded.data()) {
+      record.decoded = last.decoded;
+      record.literal = StringSpan(record.decoded);
+    } else {
+      record.literal = last.literal;
+    }
+  }
+  scanned_++;
+}
+
+void Scanner::ResetLookahead() {
+  Record &first = ring_[0];
+  first.token = Token::Illegal;
+  first.start = first.end = cursor_;
+  first.literal = StringSpan();
+  first.symbol = kNoSymbol;
+  first.number = number_;
+  current_ = 0;
+  scanned_ = 1;
+  split_ = 0;
+}
+
+Token Scanner::ScanOperator(int state) {
+  // Take characters while they extend the operator, the longest match.
+  // Operators are ASCII, so the bytes are followed without decoding.
+  const char *position = PeekPosition();
+  const char *end = position;
+  while (end != limit_) {
+    int next = operators::Next(state, static_cast<unsigned char>(*end));
+    if (next == 0) break;
+    state = next;
+    end++;
+  }
+  if (end != position) Seek(end);
+  Token token = operators::Accept(state);
+  if (token == Token::Illegal)
+    ReportScannerError("illegal token");
+  return token;
+}
 
 Token Scanner::Scan() {
   ClearTokenLiteral();
   char32_t ch;
   while (true) {
+    token_start_ = PeekPosition();
     switch (ch = Next()) {
     case character::EOS:
       MarkEndOfSource();
@@ -136,110 +333,33 @@ Token Scanner::Scan() {
     case '\n':
     case ' ':
     case '\t':
+      // Jump over the rest of a whitespace run such as an indentation
+      if (character::IsWhitespace(peek))
+        Seek(character::SkipWhitespace(PeekPosition(), limit_));
       continue;
-    case '(': return Token::LeftParenthesis;
-    case ')': return Token::RightParenthesis;
-    case '[': return Token::LeftBracket;
-    case ']': return Token::RightBracket;
-    case '{': return Token::LeftBrace;
-    case '}': return Token::RightBrace;
-    case ':': return Token::Colon;
-    case ';': return Token::Semicolon;
-    case '~': return Token::BitwiseNot;
-    case '?': return Token::Conditional;
-    case ',': return Token::Comma;
-    case '.': // . ...
-      if (Match('.')) {
-        if (Match('.')) {
-          return Token::Ellipsis;
-        } else {
-          ReportScannerError("illegal token");
-          return Token::Illegal;
-        }
-      }
-      return Token::Period;
-    case '&': // & && &=
-      if (Match('&')) {
-        return Token::LogicalAnd;
-      } else if (Match('=')) {
-        return Token::AssignmentBitwiseAnd;
-      } else {
-        return Token::BitwiseAnd;
-      }
-    case '|': // | || |=
-      if (Match('|')) {
-        return Token::LogicalOr;
-      } else if (Match('=')) {
-        return Token::AssignmentBitwiseOr;
-      } else {
-        return Token::BitwiseOr;
-      }
-    case '^': // ^ ^=
-      return Match('=') ? Token::AssignmentBitwiseXor : Token::BitwiseXor;
-    case '<': // < << <= <<=
-      if (Match('<')) {
-        return Match('=') ? Token::AssignmentShiftLeft : Token::ShiftLeft;
-      } else if (Match('=')) {
-        return Token::LessThanOrEqual;
-      } else {
-        return Token::LessThan;
-      }
-    case '>': // > >> >= >>=
-      if (Match('>')) {
-        return Match('=') ? Token::AssignmentShiftRight : Token::ShiftRight;
-      } else if (Match('=')) {
-        return Token::GreaterThanOrEqual;
-      } else {
-        return Token::GreaterThan;
-      }
-    case '!': // ! !=
-      return Match('=') ? Token::NotEqual : Token::LogicalNot;
-    case '=': // = == =>
-      if (Match('>')) {
-        return Token::Arrow;
-      } else if (Match('=')) {
-        return Token::Equal;
-      } else {
-        return Token::Assignment;
-      }
-    case '+': // + ++ +=
-      if (Match('+')) {
-        return Token::Increment;
-      } else if (Match('=')) {
-        return Token::AssignmentAddition;
-      } else {
-        return Token::Addition;
-      }
-    case '-': // - -- -=
-      if (Match('-')) {
-        return Token::Decrement;
-      } else if (Match('=')) {
-        return Token::AssignmentSubtraction;
-      } else {
-        return Token::Subtraction;
-      }
-    case '*': // * *=
-      return Match('=') ? Token::AssignmentMultiplication:Token::Multiplication;
     case '/': // / /= /* multiple line comment */ // single line comment
-      if (Match('=')) {
-        return Token::AssignmentDivision;
-      } else if (Match('*')) {
-        SkipMultipleLineComment();
+      if (Match('*')) {
+        if (!SkipMultipleLineComment())
+          return Token::Illegal;
       } else if (Match('/')) {
-        SkipSingleLineComment();
+        if (!SkipSingleLineComment())
+          return Token::Illegal;
       } else {
-        return Token::Division;
+        return ScanOperator(operators::Start(ch));
       }
       continue;
-    case '%': // % %=
-      return Match('=') ? Token::AssignmentModulus : Token::Modulus;
     case '"': // string literal
       return ScanStringLiteral();
     case '\'': // character literal
       return ScanCharacterLiteral();
+    case character::MALFORMED:
+      ReportScannerError("malformed UTF-8 sequence");
+      return Token::Illegal;
     default:
-      if (character::IsIdentifierStart(ch)) {
-        return ScanIdentifierOrKeyword(ch);
+      if (int state = operators::Start(ch)) {
+        return ScanOperator(state);
+      } else if (character::IsIdentifierStart(ch)) {
+        return ScanIdentifierOrKeyword();
       } else if (character::IsDecimalDigit(ch)) {
         return ScanIntegerOrRealNumber(ch);
       } else {
@@ -252,8 +372,17 @@ Token Scanner::Scan() {
 
 bool Scanner::SkipMultipleLineComment() {
   int cascade = 1;
-  char ch;
+  char32_t ch;
   while (true) {
+    // Only '*' and '/' can open or close a comment, the characters in
+    // between are only validated
+    const char *position = PeekPosition();
+    const char *delimiter = character::FindCommentDelimiter(position, limit_);
+    if (utf8::Validate(position, delimiter) != delimiter) {
+      ReportScannerError("malformed UTF-8 sequence in comment");
+      return false;
+    }
+    Seek(delimiter);
     ch = Next();
     if (ch == '/') {
       if (peek == '*') {
@@ -269,67 +398,109 @@ bool Scanner::SkipMultipleLineComment() {
     } else if (ch == character::EOS) {
       ReportScannerError("unexpected end of source in multiple line comment");
       return false;
+    } else if (ch == character::MALFORMED) {
+      ReportScannerError("malformed UTF-8 sequence in comment");
+      return false;
     }
   }
   return true;
 }
 
-void Scanner::SkipSingleLineComment() {
-  while (!character::IsLineFeed(peek) && peek != character::EOS)
-    Next();
+bool Scanner::SkipSingleLineComment() {
+  const char *position = PeekPosition();
+  const char *line_feed = character::FindLineFeed(position, limit_);
+  if (utf8::Validate(position, line_feed) != line_feed) {
+    ReportScannerError("malformed UTF-8 sequence in comment");
+    return false;
+  }
+  Seek(line_feed);
+  return true;
 }
 
 Token Scanner::ScanStringLiteral() {
-  std::string literal;
+  // The literal points into the source until the first escape is met
+  const char *start = PeekPosition();
+  bool decoded = false;
   char32_t ch;
   while (true) {
+    // Take the run of ASCII characters which need no attention at once
+    const char *run = PeekPosition();
+    const char *stop = character::FindStringDelimiter(run, limit_);
+    if (stop != run) {
+      if (decoded) literal_buffer_.append(run, stop);
+      Seek(stop);
+    }
+    const char *position = PeekPosition();
     ch = Next();
     if (ch == character::EOS) {
       ReportScannerError("unexpected EOF in string literal");
       return Token::Illegal;
+    } else if (ch == character::MALFORMED) {
+      ReportScannerError("malformed UTF-8 sequence in string literal");
+      return Token::Illegal;
     } else if (ch == '\\') {
+      if (!decoded) {
+        literal_buffer_.assign(start, position);
+        decoded = true;
+      }
       ch = ScanCharacterEscape();
       if (ch == character::EOS)
         return Token::Illegal;
-      literal.push_back(ch);
+      utf8::Append(&literal_buffer_, ch);
     } else if (ch == '"') {
       break;
     } else if (ch == '\n') {
       ReportScannerError("unexpected line feed in string literal");
       return Token::Illegal;
-    } else {
-      literal.push_back(ch);
+    } else if (decoded) {
+      // Copy the encoded character as it is
+      literal_buffer_.append(position, PeekPosition());
     }
   }
-  SetTokenLiteral(literal);
+  if (decoded) {
+    SetTokenLiteral(literal_buffer_);
+  } else {
+    SetTokenLiteral(start, PeekPosition() - 1);
+  }
   return Token::String;
 }
 
 Token Scanner::ScanCharacterLiteral() {
+  const char *start = PeekPosition();
+  bool decoded = false;
   char32_t literal = Next();
   if (literal == character::EOS) {
     ReportScannerError("unexpected EOF in character literal");
     return Token::Illegal;
+  } else if (literal == character::MALFORMED) {
+    ReportScannerError("malformed UTF-8 sequence in character literal");
+    return Token::Illegal;
   } else if (literal == '\\') {
     literal = ScanCharacterEscape();
     if (literal == character::EOS)
       return Token::Illegal;
+    decoded = true;
   } else if (literal == '\n') {
     ReportScannerError("unexpected line feed in character literal");
     return Token::Illegal;
   }
+  const char *end = PeekPosition();
   // to ensure that there is only one character in literal
   if (Next() != '\'') {
     ReportScannerError("too more character in literal");
     return Token::Illegal;
   }
-  SetTokenLiteral(literal);
+  if (decoded) {
+    SetTokenLiteral(literal);
+  } else {
+    SetTokenLiteral(start, end);
+  }
   return Token::Character;
 }
 
 char32_t Scanner::ScanCharacterEscape() {
   char32_t codepoint = 0;
-  switch (peek) {
+  switch (Next()) {
   case 'n': return '\n';
   case 'r': return '\r';
   case 't': return '\t';
@@ -337,15 +508,14 @@ char32_t Scanner::ScanCharacterEscape() {
   case '\'': return '\'';
   case '\"': return '\"';
   case 'u':
-    Next();
     while (character::IsDecimalDigit(peek)) {
       codepoint *= 10;
       codepoint += peek - '0';
       Next();
+      if (codepoint > 0x10FFFF) break;
     }
-    return codepoint;
+    break;
   case 'x':
-    Next();
     while (character::IsHexDigit(peek)) {
       codepoint *= 16;
       if (character::IsDecimalDigit(peek)) {
@@ -354,24 +524,37 @@ char32_t Scanner::ScanCharacterEscape() {
         codepoint += 10 + character::AsciiToLowerCase(peek) - 'a';
       }
       Next();
+      if (codepoint > 0x10FFFF) break;
     }
-    return codepoint;
+    break;
   default:
     ReportScannerError("illegal character escape");
     return character::EOS;
   }
+  // Escaped codepoints are encoded as UTF-8, so they must be encodable
+  if (!utf8::IsValidCodepoint(codepoint)) {
+    ReportScannerError("escaped codepoint is out of range");
+    return character::EOS;
+  }
+  return codepoint;
 }
 
-Token Scanner::ScanIdentifierOrKeyword(char32_t firstChar) {
-  std::string identifier;
-  identifier.push_back(firstChar);
-
-  while (character::IsIdentifierBody(peek)) {
-    identifier.push_back(Next());
+Token Scanner::ScanIdentifierOrKeyword() {
+  while (true) {
+    // Skip the ASCII run with the block search
+    if (character::HasAsciiClass(peek, character::kIdentifierBody))
+      Seek(character::SkipIdentifierBody(PeekPosition(), limit_));
+    // A non-ASCII character continues the identifier if it is XID_Continue
+    if (character::IsAscii(peek) || !character::IsXIDContinue(peek))
+      break;
+    Next();
+  }
+  const char *end = PeekPosition();
+  Token token = Tokens::LookupKeyword(token_start_, end - token_start_);
+  if (token == Token::Identifier) {
+    SetTokenLiteral(token_start_, end);
+    symbol_ = symbols_ ? symbols_->Intern(literal_) : kNoSymbol;
   }
-  Token token = Tokens::LookupKeyword(identifier);
-  if (token == Token::Identifier)
-    SetTokenLiteral(identifier);
   return token;
 }
 
@@ -382,7 +565,6 @@ Token Scanner::ScanIntegerOrRealNumber(char32_t firstChar) {
   // (3) Octal integer
   // (4) Binary integer
   // (1), (3) and (4) has a prefix, so we can easily dintinguish them
-  std::string num;
   if (firstChar == '0') {
     if (peek == 'x') {
       Next();
@@ -395,68 +577,74 @@ Token Scanner::ScanIntegerOrRealNumber(char32_t firstChar) {
       return ScanBinaryInteger();
     }
   }
-  num.push_back(firstChar);
   // Scan the integral part
   while (character::IsDecimalDigit(peek)) {
-    num.push_back(Next());
+    Next();
   }
   // Real number
   if (peek == '.' || character::AsciiToLowerCase(peek) == 'e') {
-    return ScanRealNumber(&num);
+    return ScanRealNumber();
   }
   // Integer
-  SetTokenLiteral(num);
+  if (!SetIntegerValue(token_start_, 10)) {
+    ReportScannerError("integer literal is too large");
+    return Token::Illegal;
+  }
+  SetTokenLiteral(token_start_, PeekPosition());
   return Token::Integer;
 }
 
-Token Scanner::ScanRealNumber(const std::string *integral_part,
-                              bool scanned_period) {
-  std::string num;
-  if (integral_part) {
-    num = *integral_part;
-  } else {
-    num.push_back('0');
-  }
+Token Scanner::ScanRealNumber() {
   // Fraction part
   if (Match('.')) {
     while (character::IsDecimalDigit(peek)) {
-      num.push_back(Next());
+      Next();
     }
   }
   // Exponent part
   if (peek == 'E' || peek == 'e') {
-    num.push_back(Next());
+    Next();
     if (peek == '+' || peek == '-')
-      num.push_back(Next());
+      Next();
     // An error circumstance: 1.234E
     if (!character::IsDecimalDigit(peek)) {
       ReportScannerError("unexpected end of source in real number literal");
       return Token::Illegal;
     }
     while (character::IsDecimalDigit(peek)) {
-      num.push_back(Next());
+      Next();
     }
   }
-  SetTokenLiteral(num);
+  number_.type = Token::Double;
+  number_.real = StringToDouble(token_start_, PeekPosition());
+  if (std::isinf(number_.real)) {
+    ReportScannerError("real number literal is too large");
+    return Token::Illegal;
+  }
+  SetTokenLiteral(token_start_, PeekPosition());
   return Token::RealNumber;
 }
 
-#define SCAN_INTEGER(base, ch, checker)\
-  Token Scanner::Scan##base##Integer() {\
-    std::string num;\
-    num.push_back(ch);\
+// The literal of integers keeps the base prefix, e.g. 0x1F
+#define SCAN_INTEGER(name, base, checker)\
+  Token Scanner::Scan##name##Integer() {\
     if (!checker(peek)) {\
       ReportScannerError("unexpected end of source in integer literal");\
       return Token::Illegal;\
     }\
+    const char *digits = PeekPosition();\
     while (checker(peek))\
-      num.push_back(Next());\
-    SetTokenLiteral(num);\
+      Next();\
+    if (!SetIntegerValue(digits, base)) {\
+      ReportScannerError("integer literal is too large");\
+      return Token::Illegal;\
+    }\
+    SetTokenLiteral(token_start_, PeekPosition());\
     return Token::Integer;\
   }
 
-SCAN_INTEGER(Hex, 'x', character::IsHexDigit)
-SCAN_INTEGER(Octal, 'o', character::IsOctalDigit)
-SCAN_INTEGER(Binary, 'b', character::IsBinaryDigit)
+SCAN_INTEGER(Hex, 16, character::IsHexDigit)
+SCAN_INTEGER(Octal, 8, character::IsOctalDigit)
+SCAN_INTEGER(Binary, 2, character::IsBinaryDigit)
 
 }
\ No newline at end of file
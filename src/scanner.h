@@ -1,7 +1,8 @@
 #ifndef FLORA_SCANNER_H
 #define FLORA_SCANNER_H
 
-#include <queue>
+#include <cstddef>
+#include <string>
 #include <utility>
 
 #include "flora.h"
@@ -9,9 +10,14 @@
 #include "token.h"
 #include "character-predicates.h"
 #include "character-stream.h"
+#include "conversions.h"
+#include "string-span.h"
+#include "symbol-table.h"
 
 namespace flora {
 
+class TokenBuffer;
+
 class Scanner {
 public:
   // Forbid copy behaviors
@@ -19,54 +25,156 @@ public:
 
   Scanner();
   ~Scanner();
-  // TODO
+  // Scan a source held in memory, the buffer must outlive the scanner
+  void Initialize(const char *source, std::size_t length);
+  // Start scanning at an offset of the buffer, which must be a character
+  // boundary. Token offsets stay relative to the start of the buffer.
+  void Initialize(const char *source, std::size_t length, std::size_t offset);
+  // Read the whole stream into an owned buffer and scan it
   void Initialize(CharacterStream *stream);
   Token Advance();
-  void SaveBookmark();
-  void LoadBookmark();
-  void ClearBookmark();
-  const std::string& GetTokenLiteral();
+  // The number of tokens kept for Peek() and Rewind()
+  static const std::size_t kLookaheadCapacity = 32;
+
+  // Returns the n-th token after the current one without advancing,
+  // Peek(1) is what the next Advance() returns. n must be less than
+  // kLookaheadCapacity.
+  Token Peek(std::size_t n);
+  // Scan all remaining tokens into the buffer, up to and including
+  // EndOfSource or Illegal. Offsets are limited to 32 bits.
+  void TokenizeAll(TokenBuffer *tokens);
+  // Like TokenizeAll, but stops before the first token other than
+  // EndOfSource which starts at or after the offset. That token is consumed
+  // and not appended.
+  void TokenizeUntil(TokenBuffer *tokens, std::size_t offset);
+  // Append the current token, as returned by Advance(), to the buffer
+  void AppendToken(TokenBuffer *tokens, Token token) const;
+  // A position in the token stream for speculative parsing. Checkpoints
+  // are plain values, so they nest and need no release.
+  struct Checkpoint {
+    // The index of the current token when the checkpoint was taken
+    std::size_t index;
+    // Where that token starts, to scan it again if it left the ring
+    const char *start;
+  };
+  Checkpoint SaveCheckpoint() const;
+  // Make the token of the checkpoint current again, returns its kind
+  Token Rewind(const Checkpoint &checkpoint);
+  // Consume the leading '>' of the current token, which must be '>>',
+  // '>>=' or '>=', and make the rest of it the current token. Closes
+  // nested type arguments such as A<B<C>>. Returns the kind of the rest.
+  Token SplitGreaterThan();
+  // The literal of the current token. It points into the source buffer
+  // unless escapes had to be decoded, and is valid until the next Advance().
+  StringSpan GetTokenLiteral() const;
+  // Intern identifiers into the table while scanning, nullptr stops it.
+  // The table must outlive the scanner.
+  void set_symbol_table(SymbolTable *symbols) { symbols_ = symbols; }
+  // The symbol of the current token if it is an identifier and a symbol
+  // table is set, kNoSymbol otherwise
+  Symbol GetTokenSymbol() const { return Current().symbol; }
+  // The value of the current token if it is an Integer or a RealNumber
+  NumberLiteral GetTokenNumber() const { return Current().number; }
+  // The source buffer, token offsets are relative to its start
+  StringSpan GetSource() const { return StringSpan(source_, limit_); }
+  // The location of the current token in the source buffer
+  std::size_t GetTokenOffset() const;
+  std::size_t GetTokenLength() const;
 private:
   enum class State {
-    Uninitialized, Running, Recording, Restoring, Error, End
+    Uninitialized, Running, Error, End
+  };
+  // A scanned token in the lookahead ring
+  struct Record {
+    Token token;
+    const char *start;
+    const char *end;
+    StringSpan literal;
+    Symbol symbol;
+    NumberLiteral number;
+    // Holds the literal if it could not point into the source. It stays
+    // with the slot, so its storage is reused by later tokens.
+    std::string decoded;
   };
-  // The recording queue for bookmark function
-  std::queue<std::pair<Token, std::string>> records_;
+  static const std::size_t kLookaheadMask = kLookaheadCapacity - 1;
+  static_assert((kLookaheadCapacity & kLookaheadMask) == 0,
+                "the lookahead capacity must be a power of two");
+  // The ring holds the tokens with index in [scanned_ - capacity, scanned_).
+  // current_ is the index of the token returned by the last Advance(),
+  // index 0 is a placeholder for the position before the first token.
+  Record ring_[kLookaheadCapacity];
+  std::size_t current_;
+  std::size_t scanned_;
+  // One past the index of the last token split in the ring, 0 if none.
+  // Rewinding before it scans the tokens again.
+  std::size_t split_;
   // The current state of scanner
   State state_;
-  // The stream
-  CharacterStream *stream_;
-  // Next character
+  // The source buffer and the cursor walking through it. The cursor points
+  // at peek.
+  const char *source_;
+  const char *cursor_;
+  const char *limit_;
+  // Owns the source when it is read from a CharacterStream
+  std::string buffer_;
+  // Next character and the length of its encoding
   char32_t peek;
-  // The literal of token
-  std::string literal_;
+  int peek_length_;
+  // The start of the token being scanned
+  const char *token_start_;
+  // The literal of the token being scanned
+  StringSpan literal_;
+  // Holds literals which can not point into the source buffer
+  std::string literal_buffer_;
+  // Interns identifiers if set, symbol_ is the symbol of the token
+  SymbolTable *symbols_;
+  Symbol symbol_;
+  // The value of the number literal being scanned
+  NumberLiteral number_;
   // Advance next character.
-  char32_t Next();
+  inline char32_t Next();
+  // Decode peek at the cursor, the slow path of Next() for multibyte
+  // characters and the end of source
+  void DecodePeek();
   // Returns true if the next character is expected character
-  bool Match(char32_t expected);
+  inline bool Match(char32_t expected);
+  // Returns the position of peek in the source buffer
+  inline const char* PeekPosition() const;
+  // Move peek to the given position of the source buffer
+  inline void Seek(const char *position);
   // Set the literal of token
-  inline void SetTokenLiteral(const char *literal);
-  inline void SetTokenLiteral(std::string &literal);
-  inline void SetTokenLiteral(char literal);
+  inline void SetTokenLiteral(StringSpan literal);
+  inline void SetTokenLiteral(const char *start, const char *end);
+  inline void SetTokenLiteral(char32_t codepoint);
   inline void ClearTokenLiteral();
+  // Set the value of an integer literal, returns false if it is too large
+  // for its type
+  inline bool SetIntegerValue(const char *digits, int base);
   // Report error, call before returning Token::Illegal
   inline void ReportScannerError(const char *message);
   inline void MarkEndOfSource();
   // Scan a token
   Token Scan();
-  // Skip comments, returns true if error occurs
+  // Scan the next token into the ring
+  void ScanIntoRing();
+  // Empty the ring, the next token is scanned from the cursor
+  void ResetLookahead();
+  const Record& Current() const { return ring_[current_ & kLookaheadMask]; }
+  // Skip comments, returns false if error occurs
   bool SkipMultipleLineComment();
-  void SkipSingleLineComment();
+  bool SkipSingleLineComment();
   // Scan literals and escapees of strings and characters
   Token ScanStringLiteral();
   Token ScanCharacterLiteral();
   char32_t ScanCharacterEscape();
-  // Scan identifiers and keywords
-  Token ScanIdentifierOrKeyword(char32_t firstChar);
+  // Scan an operator or punctuation mark from the state after its first
+  // character
+  inline Token ScanOperator(int state);
+  // Scan identifiers and keywords, the first character is already consumed
+  Token ScanIdentifierOrKeyword();
   // Scan integers and real numebers
   Token ScanIntegerOrRealNumber(char32_t firstChar);
-  Token ScanRealNumber(const std::string *integral_part,
-                       bool scanned_period = false);
+  Token ScanRealNumber();
   // Scan integer in different base
   Token ScanHexInteger();
   Token ScanOctalInteger();
@@ -0,0 +1,70 @@
+#ifndef FLORA_SCOPE_H
+#define FLORA_SCOPE_H
+
+#include "flora.h"
+#include "ast.h"
+#include "symbol-table.h"
+#include "zone.h"
+
+namespace flora {
+
+enum class ScopeType : std::uint8_t {
+  Global, Namespace, Class, Function, Block
+};
+
+// The names declared in a block, a function, a class or a namespace.
+// Scopes and their declaration lists live in the zone of the translation
+// unit. Names are looked up by symbol, declarations must have one set.
+class Scope : public ZoneObject {
+public:
+  Scope(Zone *zone, ScopeType type, Scope *outer)
+      : zone_(zone), type_(type), outer_(outer), declarations_(nullptr) { }
+
+  ScopeType type() const { return type_; }
+  Scope* outer() const { return outer_; }
+
+  void Declare(ast::Declaration *declaration) {
+    declarations_ = new (zone_->New(sizeof(Entry)))
+        Entry { declaration->symbol(), declaration, declarations_ };
+  }
+  // Forget a declaration, when it is replaced by a reparse
+  void Remove(ast::Declaration *declaration) {
+    for (Entry **entry = &declarations_; *entry; entry = &(*entry)->next) {
+      if ((*entry)->declaration == declaration) {
+        *entry = (*entry)->next;
+        return;
+      }
+    }
+  }
+  // Returns nullptr if the name is not declared in this scope
+  ast::Declaration* LookupLocal(Symbol name) const {
+    for (Entry *entry = declarations_; entry; entry = entry->next) {
+      if (entry->symbol == name) return entry->declaration;
+    }
+    return nullptr;
+  }
+  // Looks through the outer scopes as well
+  ast::Declaration* Lookup(Symbol name) const {
+    for (const Scope *scope = this; scope; scope = scope->outer_) {
+      ast::Declaration *declaration = scope->LookupLocal(name);
+      if (declaration) return declaration;
+    }
+    return nullptr;
+  }
+private:
+  // Declarations in reverse order, so the latest one shadows the others
+  struct Entry {
+    // Copied from the declaration so the walk stays in the entries
+    Symbol symbol;
+    ast::Declaration *declaration;
+    Entry *next;
+  };
+  Zone *zone_;
+  ScopeType type_;
+  Scope *outer_;
+  Entry *declarations_;
+};
+
+}
+
+#endif
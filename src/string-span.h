@@ -0,0 +1,49 @@
+#ifndef FLORA_STRING_SPAN_H
+#define FLORA_STRING_SPAN_H
+
+#include <cstddef>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+#include "flora.h"
+
+namespace flora {
+
+// A non-owning view of characters, usually a slice of the source buffer.
+class StringSpan {
+public:
+  StringSpan() : data_(nullptr), size_(0) { }
+  StringSpan(const char *data, std::size_t size) : data_(data), size_(size) { }
+  StringSpan(const char *begin, const char *end)
+      : data_(begin), size_(end - begin) { }
+  StringSpan(const char *str) : data_(str), size_(std::strlen(str)) { }
+  StringSpan(const std::string &str) : data_(str.data()), size_(str.size()) { }
+
+  const char* data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+  char operator[] (std::size_t index) const { return data_[index]; }
+
+  // Copies the characters into an owned string
+  std::string ToString() const { return std::string(data_, size_); }
+
+  bool operator== (const StringSpan &other) const {
+    return size_ == other.size_ &&
+        (size_ == 0 || std::memcmp(data_, other.data_, size_) == 0);
+  }
+  bool operator!= (const StringSpan &other) const { return !(*this == other); }
+private:
+  const char *data_;
+  std::size_t size_;
+};
+
+inline std::ostream& operator<< (std::ostream &os, const StringSpan &span) {
+  return os.write(span.data(), span.size());
+}
+
+}
+
+#endif
@@ -0,0 +1,76 @@
+#include "symbol-table.h"
+
+#include <cstring>
+
+namespace flora {
+
+SymbolTable::SymbolTable() : slots_(kInitialCapacity) {
+  for (Slot &slot : slots_) slot.symbol = kNoSymbol;
+}
+
+std::uint32_t SymbolTable::Hash(StringSpan name) {
+  // FNV-1a, then mixed so that the high bits depend on every character
+  std::uint32_t hash = 2166136261u;
+  for (char ch : name) {
+    hash ^= static_cast<unsigned char>(ch);
+    hash *= 16777619u;
+  }
+  hash ^= hash >> 16;
+  hash *= 0x85EBCA6Bu;
+  hash ^= hash >> 13;
+  return hash;
+}
+
+std::size_t SymbolTable::Probe(StringSpan name, std::uint32_t hash) const {
+  std::size_t mask = slots_.size() - 1;
+  for (std::size_t index = hash & mask; ; index = (index + 1) & mask) {
+    const Slot &slot = slots_[index];
+    if (slot.symbol == kNoSymbol ||
+        (slot.hash == hash && names_[slot.symbol] == name))
+      return index;
+  }
+}
+
+Symbol SymbolTable::Intern(StringSpan name, std::uint32_t hash) {
+  std::size_t index = Probe(name, hash);
+  if (slots_[index].symbol != kNoSymbol) return slots_[index].symbol;
+  char *copy = zone_.NewArray<char>(name.size());
+  if (!name.empty()) std::memcpy(copy, name.data(), name.size());
+  Symbol symbol = static_cast<Symbol>(names_.size());
+  names_.push_back(StringSpan(copy, name.size()));
+  slots_[index].hash = hash;
+  slots_[index].symbol = symbol;
+  // Keep the load factor at most one half
+  if (names_.size() * 2 > slots_.size()) Grow();
+  return symbol;
+}
+
+Symbol SymbolTable::Lookup(StringSpan name) const {
+  return slots_[Probe(name, Hash(name))].symbol;
+}
+
+void SymbolTable::Grow() {
+  std::vector<Slot> old(slots_.size() * 2);
+  old.swap(slots_);
+  for (Slot &slot : slots_) slot.symbol = kNoSymbol;
+  std::size_t mask = slots_.size() - 1;
+  for (const Slot &slot : old) {
+    if (slot.symbol == kNoSymbol) continue;
+    std::size_t index = slot.hash & mask;
+    while (slots_[index].symbol != kNoSymbol) index = (index + 1) & mask;
+    slots_[index] = slot;
+  }
+}
+
+std::size_t SymbolTable::ByteSize() const {
+  return zone_.segment_bytes() + slots_.capacity() * sizeof(Slot) +
+      names_.capacity() * sizeof(StringSpan);
+}
+
+void SymbolTable::Clear() {
+  zone_.Reset();
+  names_.clear();
+  for (Slot &slot : slots_) slot.symbol = kNoSymbol;
+}
+
+}
@@ -0,0 +1,60 @@
+#ifndef FLORA_SYMBOL_TABLE_H
+#define FLORA_SYMBOL_TABLE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#include "flora.h"
+#include "string-span.h"
+#include "zone.h"
+
+namespace flora {
+
+// An interned identifier. Equal names have equal symbols, so comparing
+// names is comparing integers.
+typedef std::uint32_t Symbol;
+
+const Symbol kNoSymbol = 0xFFFFFFFFu;
+
+// Interns identifiers. Each distinct name is copied once into a zone, and
+// symbols are numbered from 0 in order of first appearance. The hash table
+// uses open addressing with linear probing and keeps the hash of each
+// entry, so most probes do not touch the names.
+class SymbolTable {
+public:
+  NOCOPY_CLASS(SymbolTable)
+
+  SymbolTable();
+
+  // Returns the symbol of the name, adding it if it is new
+  Symbol Intern(StringSpan name) { return Intern(name, Hash(name)); }
+  Symbol Intern(StringSpan name, std::uint32_t hash);
+  // Returns kNoSymbol if the name has not been interned
+  Symbol Lookup(StringSpan name) const;
+  // The name of a symbol, valid as long as the table
+  StringSpan Name(Symbol symbol) const { return names_[symbol]; }
+
+  std::size_t size() const { return names_.size(); }
+  // Bytes of the names and of the table itself
+  std::size_t ByteSize() const;
+  void Clear();
+
+  static std::uint32_t Hash(StringSpan name);
+private:
+  struct Slot {
+    std::uint32_t hash;
+    Symbol symbol;
+  };
+  static const std::size_t kInitialCapacity = 256;
+  Zone zone_;
+  std::vector<Slot> slots_;
+  std::vector<StringSpan> names_;
+  // Returns the slot holding the name, or the empty slot where it belongs
+  std::size_t Probe(StringSpan name, std::uint32_t hash) const;
+  void Grow();
+};
+
+}
+
+#endif
@@ -0,0 +1,248 @@
+#include "token-buffer.h"
+
+#include <algorithm>
+
+namespace flora {
+
+const std::size_t TokenBuffer::kChunkSize;
+
+void TokenBuffer::Clear() {
+  // The storage is kept for the next tokens
+  for (const Chunk &chunk : chunks_) free_.push_back(chunk.storage);
+  chunks_.clear();
+  size_ = 0;
+  pending_ = 0;
+  pending_growth_ = 0;
+  pending_shift_ = 0;
+  decoded_.clear();
+  numbers_.clear();
+  dead_decoded_ = 0;
+  dead_numbers_ = 0;
+}
+
+void TokenBuffer::Reserve(std::size_t count) {
+  std::size_t chunks = (count + kChunkSize - 1) / kChunkSize;
+  chunks_.reserve(chunks);
+  if (chunks > chunks_.size()) ReserveStorage(chunks - chunks_.size());
+}
+
+void TokenBuffer::ReserveStorage(std::size_t count) {
+  if (free_.size() >= count) return;
+  count -= free_.size();
+  Storage *block = new Storage[count];
+  blocks_.emplace_back(block);
+  // Reversed, so that chunks take the block in order
+  for (std::size_t i = count; i > 0; i--) free_.push_back(block + i - 1);
+}
+
+TokenBuffer::Storage* TokenBuffer::NewStorage() {
+  // Blocks double with the buffer, so appending allocates rarely
+  if (free_.empty()) ReserveStorage(std::max<std::size_t>(chunks_.size(), 1));
+  Storage *storage = free_.back();
+  free_.pop_back();
+  return storage;
+}
+
+void TokenBuffer::AddChunk() {
+  Chunk chunk = { NewStorage(), size_, 0, 0 };
+  chunks_.push_back(chunk);
+  pending_ = chunks_.size();
+}
+
+void TokenBuffer::Settle(std::size_t chunk) {
+  for (; pending_ < chunk; pending_++) {
+    chunks_[pending_].start += pending_growth_;
+    chunks_[pending_].base += pending_shift_;
+  }
+  for (; pending_ > chunk; pending_--) {
+    chunks_[pending_ - 1].start -= pending_growth_;
+    chunks_[pending_ - 1].base -= pending_shift_;
+  }
+  if (pending_ == chunks_.size()) {
+    pending_growth_ = 0;
+    pending_shift_ = 0;
+  }
+}
+
+void TokenBuffer::Append(Token token, std::uint32_t offset,
+                         std::uint32_t length, StringSpan decoded) {
+  DecodedLiteral literal;
+  literal.length = length;
+  literal.text = decoded.ToString();
+  Push(token, offset,
+       kDecodedFlag | static_cast<std::uint32_t>(decoded_.size()));
+  decoded_.push_back(std::move(literal));
+}
+
+void TokenBuffer::AppendLong(Token token, std::uint32_t offset,
+                             std::uint32_t length) {
+  NumberLiteral number;
+  number.type = Token::Illegal;
+  number.integer = 0;
+  Append(token, offset, length, number);
+}
+
+void TokenBuffer::Append(const TokenBuffer &other, std::size_t begin,
+                         std::size_t end) {
+  other.ForEachToken(begin, end, [this, &other](std::uint8_t kind,
+      std::uint32_t offset, std::uint32_t extent) {
+    Push(static_cast<Token>(kind), offset, Adopt(other, extent));
+  });
+}
+
+std::uint32_t TokenBuffer::Adopt(const TokenBuffer &other,
+                                 std::uint32_t extent) {
+  if (extent & kDecodedFlag) {
+    decoded_.push_back(other.decoded_[extent & kIndexMask]);
+    return kDecodedFlag | static_cast<std::uint32_t>(decoded_.size() - 1);
+  }
+  if (extent & kNumberFlag) {
+    numbers_.push_back(other.numbers_[extent & kIndexMask]);
+    return kNumberFlag | static_cast<std::uint32_t>(numbers_.size() - 1);
+  }
+  return extent;
+}
+
+void TokenBuffer::Splice(std::size_t begin, std::size_t end,
+                         const TokenBuffer &other, std::ptrdiff_t shift) {
+  if (empty()) {
+    Append(other, 0, other.size());
+    return;
+  }
+  // The chunks of the replaced tokens are rewritten, with the next one if
+  // they would be left small
+  std::size_t first = ChunkOf(std::min(begin, size_ - 1));
+  std::size_t last = end > begin ? ChunkOf(end - 1) : first;
+  if (last + 1 < chunks_.size() &&
+      Start(last + 1) - Start(first) - (end - begin) + other.size() <
+          kChunkSize / 2)
+    last++;
+  Settle(last + 1);
+  std::size_t start = chunks_[first].start;
+  std::size_t stop = chunks_[last].start + chunks_[last].count;
+  std::size_t total = stop - start - (end - begin) + other.size();
+  spliced_kinds_.clear();
+  spliced_offsets_.clear();
+  spliced_extents_.clear();
+  auto gather = [this](std::uint32_t shift) {
+    return [this, shift](std::uint8_t kind, std::uint32_t offset,
+                         std::uint32_t extent) {
+      spliced_kinds_.push_back(kind);
+      spliced_offsets_.push_back(offset + shift);
+      spliced_extents_.push_back(extent);
+    };
+  };
+  ForEachToken(start, begin, gather(0));
+  ForEachToken(begin, end, [this](std::uint8_t, std::uint32_t,
+                                  std::uint32_t extent) {
+    if (extent & kDecodedFlag) dead_decoded_++;
+    if (extent & kNumberFlag) dead_numbers_++;
+  });
+  other.ForEachToken(0, other.size(), [this, &other](std::uint8_t kind,
+      std::uint32_t offset, std::uint32_t extent) {
+    spliced_kinds_.push_back(kind);
+    spliced_offsets_.push_back(offset);
+    spliced_extents_.push_back(Adopt(other, extent));
+  });
+  ForEachToken(end, stop, gather(static_cast<std::uint32_t>(shift)));
+
+  // Split the tokens evenly into as few chunks as hold them
+  std::size_t pieces = (total + kChunkSize - 1) / kChunkSize;
+  std::size_t old = last + 1 - first;
+  if (pieces < old) {
+    for (std::size_t chunk = first + pieces; chunk <= last; chunk++)
+      free_.push_back(chunks_[chunk].storage);
+    chunks_.erase(chunks_.begin() + first + pieces,
+                  chunks_.begin() + last + 1);
+  } else if (pieces > old) {
+    ReserveStorage(pieces - old);
+    Chunk added = { nullptr, 0, 0, 0 };
+    chunks_.insert(chunks_.begin() + last + 1, pieces - old, added);
+    for (std::size_t piece = old; piece < pieces; piece++)
+      chunks_[first + piece].storage = NewStorage();
+  }
+  std::size_t written = 0;
+  for (std::size_t piece = 0; piece < pieces; piece++) {
+    Chunk &chunk = chunks_[first + piece];
+    std::size_t count = total / pieces + (piece < total % pieces);
+    std::copy(spliced_kinds_.begin() + written,
+              spliced_kinds_.begin() + written + count,
+              chunk.storage->kinds);
+    std::copy(spliced_offsets_.begin() + written,
+              spliced_offsets_.begin() + written + count,
+              chunk.storage->offsets);
+    std::copy(spliced_extents_.begin() + written,
+              spliced_extents_.begin() + written + count,
+              chunk.storage->extents);
+    chunk.start = start + written;
+    chunk.count = static_cast<std::uint32_t>(count);
+    chunk.base = 0;
+    written += count;
+  }
+  // The later chunks only move, which is left pending
+  std::size_t growth = other.size() - (end - begin);
+  size_ += growth;
+  pending_ = first + pieces;
+  pending_growth_ += growth;
+  pending_shift_ += static_cast<std::uint32_t>(shift);
+  if (pending_ == chunks_.size()) Settle(pending_);
+
+  // Compacting walks every token, so it waits for enough dead entries
+  std::size_t dead = dead_decoded_ + dead_numbers_;
+  if (dead > (decoded_.size() + numbers_.size()) / 2 && dead > size_ / 16)
+    CompactSideTables();
+}
+
+void TokenBuffer::CompactSideTables() {
+  std::vector<DecodedLiteral> decoded;
+  std::vector<NumberEntry> numbers;
+  decoded.reserve(decoded_.size() - dead_decoded_);
+  numbers.reserve(numbers_.size() - dead_numbers_);
+  for (Chunk &chunk : chunks_) {
+    for (std::uint32_t at = 0; at < chunk.count; at++) {
+      std::uint32_t &extent = chunk.storage->extents[at];
+      if (extent & kDecodedFlag) {
+        decoded.push_back(std::move(decoded_[extent & kIndexMask]));
+        extent = kDecodedFlag | static_cast<std::uint32_t>(decoded.size() - 1);
+      } else if (extent & kNumberFlag) {
+        numbers.push_back(numbers_[extent & kIndexMask]);
+        extent = kNumberFlag | static_cast<std::uint32_t>(numbers.size() - 1);
+      }
+    }
+  }
+  decoded_ = std::move(decoded);
+  numbers_ = std::move(numbers);
+  dead_decoded_ = 0;
+  dead_numbers_ = 0;
+}
+
+NumberLiteral TokenBuffer::number(std::size_t index) const {
+  std::size_t chunk = ChunkOf(index);
+  std::uint32_t extent =
+      chunks_[chunk].storage->extents[index - Start(chunk)];
+  return numbers_[extent & kIndexMask].number;
+}
+
+StringSpan TokenBuffer::literal(std::size_t index) const {
+  std::size_t chunk = ChunkOf(index);
+  std::size_t at = index - Start(chunk);
+  std::uint32_t extent = chunks_[chunk].storage->extents[at];
+  if (extent & kDecodedFlag)
+    return StringSpan(decoded_[extent & kIndexMask].text);
+  std::uint32_t length = Length(extent);
+  const char *start = source_.data() + Offset(chunk, at);
+  switch (kind(index)) {
+  case Token::Identifier:
+  case Token::Integer:
+  case Token::RealNumber:
+    return StringSpan(start, length);
+  case Token::String:
+  case Token::Character:
+    // Strip the quotes
+    return StringSpan(start + 1, length - 2);
+  default:
+    return StringSpan();
+  }
+}
+
+}
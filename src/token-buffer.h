@@ -0,0 +1,226 @@
+#ifndef FLORA_TOKEN_BUFFER_H
+#define FLORA_TOKEN_BUFFER_H
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "flora.h"
+#include "conversions.h"
+#include "token.h"
+#include "string-span.h"
+
+namespace flora {
+
+// Tokens of a whole source stored as parallel arrays. Each token takes
+// 9 bytes: its kind, its offset in the source and its length. Tokens whose
+// literal had to be decoded store an index into a side table instead of
+// the length, and so do number literals, whose values are kept in another
+// side table. The last token is always EndOfSource or Illegal.
+//
+// The arrays are cut into chunks of at most kChunkSize tokens, and the
+// offsets of a chunk are relative to a base of its own. Splice rewrites
+// only the chunks of the replaced tokens. The later chunks move by the
+// change of the token count and of the offsets, which is kept pending and
+// added when they are read, until an edit further on applies it to the
+// chunks in between. An edit costs the size of the change and a chunk,
+// plus a few words for each chunk since the last edit.
+class TokenBuffer {
+public:
+  TokenBuffer() = default;
+
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  void Clear();
+  void Reserve(std::size_t count);
+
+  // The source the offsets refer to
+  StringSpan source() const { return source_; }
+  void set_source(StringSpan source) { source_ = source; }
+
+  Token kind(std::size_t index) const {
+    std::size_t chunk = ChunkOf(index);
+    return static_cast<Token>(
+        chunks_[chunk].storage->kinds[index - Start(chunk)]);
+  }
+  std::uint32_t offset(std::size_t index) const {
+    std::size_t chunk = ChunkOf(index);
+    return Offset(chunk, index - Start(chunk));
+  }
+  std::uint32_t length(std::size_t index) const {
+    std::size_t chunk = ChunkOf(index);
+    return Length(chunks_[chunk].storage->extents[index - Start(chunk)]);
+  }
+  std::uint32_t end(std::size_t index) const {
+    std::size_t chunk = ChunkOf(index);
+    std::size_t at = index - Start(chunk);
+    return Offset(chunk, at) + Length(chunks_[chunk].storage->extents[at]);
+  }
+  // Returns the literal as GetTokenLiteral() would have during scanning
+  StringSpan literal(std::size_t index) const;
+  // The value of an Integer or RealNumber token
+  NumberLiteral number(std::size_t index) const;
+
+  void Append(Token token, std::uint32_t offset, std::uint32_t length) {
+    if (length & ~kIndexMask) {
+      AppendLong(token, offset, length);
+    } else {
+      Push(token, offset, length);
+    }
+  }
+  // Append a token whose literal does not point into the source
+  void Append(Token token, std::uint32_t offset, std::uint32_t length,
+              StringSpan decoded);
+  // Append an Integer or RealNumber token with its value
+  void Append(Token token, std::uint32_t offset, std::uint32_t length,
+              NumberLiteral number) {
+    NumberEntry entry = { length, number };
+    Push(token, offset,
+         kNumberFlag | static_cast<std::uint32_t>(numbers_.size()));
+    numbers_.push_back(entry);
+  }
+  // Append the tokens [begin, end) of another buffer over the same source
+  void Append(const TokenBuffer &other, std::size_t begin, std::size_t end);
+  // Replace the tokens [begin, end) by all tokens of another buffer, and
+  // move the offsets of the tokens after them by the shift
+  void Splice(std::size_t begin, std::size_t end, const TokenBuffer &other,
+              std::ptrdiff_t shift);
+
+  // Calls f(kinds, count) for the kinds of consecutive tokens, from the
+  // first token to the last, for passes which walk all tokens
+  template <typename F>
+  void ForEachRun(F f) const {
+    for (const Chunk &chunk : chunks_)
+      f(static_cast<const std::uint8_t*>(chunk.storage->kinds), chunk.count);
+  }
+
+  static const std::size_t kChunkSize = 1024;
+private:
+  static_assert(static_cast<int>(Token::TOKEN_COUNT) <= 256,
+                "token kinds must fit in one byte");
+  static const std::uint32_t kDecodedFlag = 0x80000000u;
+  static const std::uint32_t kNumberFlag = 0x40000000u;
+  static const std::uint32_t kIndexMask = 0x3FFFFFFFu;
+  struct Storage {
+    std::uint8_t kinds[kChunkSize];
+    std::uint32_t offsets[kChunkSize];
+    // Either the length or a flag | index into a side table
+    std::uint32_t extents[kChunkSize];
+  };
+  struct Chunk {
+    Storage *storage;
+    // The index of the first token
+    std::size_t start;
+    std::uint32_t count;
+    // Added to the offsets of the chunk
+    std::uint32_t base;
+  };
+  struct DecodedLiteral {
+    std::uint32_t length;
+    std::string text;
+  };
+  // Also holds the lengths of other tokens too long for an extent
+  struct NumberEntry {
+    std::uint32_t length;
+    NumberLiteral number;
+  };
+  StringSpan source_;
+  std::size_t size_ = 0;
+  std::vector<Chunk> chunks_;
+  // The chunks from pending_ on have yet to add the pending growth to
+  // their start and the pending shift to their base
+  std::size_t pending_ = 0;
+  std::size_t pending_growth_ = 0;
+  std::uint32_t pending_shift_ = 0;
+  // Storage is allocated in blocks of many chunks, and the storage of
+  // removed chunks is reused
+  std::vector<std::unique_ptr<Storage[]>> blocks_;
+  std::vector<Storage*> free_;
+  std::vector<DecodedLiteral> decoded_;
+  std::vector<NumberEntry> numbers_;
+  // Side table entries of tokens removed by Splice
+  std::size_t dead_decoded_ = 0;
+  std::size_t dead_numbers_ = 0;
+  // The tokens of the chunks Splice rewrites, with their offsets
+  std::vector<std::uint8_t> spliced_kinds_;
+  std::vector<std::uint32_t> spliced_offsets_;
+  std::vector<std::uint32_t> spliced_extents_;
+
+  std::size_t Start(std::size_t chunk) const {
+    return chunks_[chunk].start + (chunk >= pending_ ? pending_growth_ : 0);
+  }
+  std::uint32_t Base(std::size_t chunk) const {
+    return chunks_[chunk].base + (chunk >= pending_ ? pending_shift_ : 0);
+  }
+  // Chunks filled by Append are full, so the quotient is the chunk unless
+  // a splice changed the size of an earlier one
+  std::size_t ChunkOf(std::size_t index) const {
+    std::size_t chunk = std::min(index / kChunkSize, chunks_.size() - 1);
+    std::size_t start = Start(chunk);
+    if (start <= index && index < start + chunks_[chunk].count) return chunk;
+    // The last chunk starting at or before the index
+    std::size_t low = 0, high = chunks_.size();
+    while (high - low > 1) {
+      std::size_t middle = low + (high - low) / 2;
+      if (Start(middle) <= index) {
+        low = middle;
+      } else {
+        high = middle;
+      }
+    }
+    return low;
+  }
+  std::uint32_t Offset(std::size_t chunk, std::size_t at) const {
+    return chunks_[chunk].storage->offsets[at] + Base(chunk);
+  }
+  std::uint32_t Length(std::uint32_t extent) const {
+    if (extent & kDecodedFlag) return decoded_[extent & kIndexMask].length;
+    if (extent & kNumberFlag) return numbers_[extent & kIndexMask].length;
+    return extent;
+  }
+  void Push(Token token, std::uint32_t offset, std::uint32_t extent) {
+    if (pending_ < chunks_.size()) Settle(chunks_.size());
+    if (chunks_.empty() || chunks_.back().count == kChunkSize) AddChunk();
+    Chunk &chunk = chunks_.back();
+    chunk.storage->kinds[chunk.count] = static_cast<std::uint8_t>(token);
+    chunk.storage->offsets[chunk.count] = offset - chunk.base;
+    chunk.storage->extents[chunk.count] = extent;
+    chunk.count++;
+    size_++;
+  }
+  void AddChunk();
+  Storage* NewStorage();
+  // Makes sure that count more chunks need no allocation
+  void ReserveStorage(std::size_t count);
+  // Applies the pending move to the chunks before the given one, or takes
+  // it back from the chunks from there on
+  void Settle(std::size_t chunk);
+  void AppendLong(Token token, std::uint32_t offset, std::uint32_t length);
+  // Calls f(kind, offset, extent) for the tokens [begin, end)
+  template <typename F>
+  void ForEachToken(std::size_t begin, std::size_t end, F f) const {
+    while (begin < end) {
+      std::size_t chunk = ChunkOf(begin);
+      const Storage &from = *chunks_[chunk].storage;
+      std::uint32_t base = Base(chunk);
+      std::size_t at = begin - Start(chunk);
+      std::size_t stop = std::min<std::size_t>(chunks_[chunk].count,
+                                               at + end - begin);
+      begin += stop - at;
+      for (; at < stop; at++)
+        f(from.kinds[at], from.offsets[at] + base, from.extents[at]);
+    }
+  }
+  // The extent of a token of another buffer, its side table entry is
+  // copied to this buffer
+  std::uint32_t Adopt(const TokenBuffer &other, std::uint32_t extent);
+  // Drops the side table entries of removed tokens
+  void CompactSideTables();
+};
+
+}
+
+#endif
@@ -1,44 +1,33 @@
 #include "token.h"
 
-namespace flora {
-
-Token Tokens::LookupKeyword(const std::string &identifier) {
-  auto result = lookup_table_.find(identifier);
-  return result == lookup_table_.end() ? Token::Identifier : result->second;
-}
-
-#define T(name, literal, precedence) #name,
-const char *Tokens::name_[Tokens::TOKEN_COUNT] = {
-  TOKEN_LIST(T, T)
-};
-#undef T
-
-#define T(name, literal, precedence) literal,
-const char *Tokens::literal_[Tokens::TOKEN_COUNT] = {
-  TOKEN_LIST(T, T)
-};
-#undef T
-
-#define T(name, literal, precedence) precedence,
-const int Tokens::precedence_[Tokens::TOKEN_COUNT] = {
-  TOKEN_LIST(T, T)
-};
-#undef T
+#include <cstring>
 
-std::unordered_map<std::string, Token> Tokens::lookup_table_;
+namespace flora {
 
-void Tokens::InitializeKeywordLookupTable() {
-#define K(name, literal, precedence) lookup_table_[std::string(literal)] = Token::name;
-#define T(name, literal, precedence)
-  TOKEN_LIST(K, T)
+Token Tokens::LookupKeyword(const char *identifier, std::size_t length) {
+  if (length == 0) return Token::Identifier;
+  // A hash collision between two keywords is a duplicate case label, so the
+  // hash is checked to be perfect at compile time.
+#define K(name, literal, precedence, flags)\
+  case KeywordHash(literal, sizeof(literal) - 1):\
+    if (length == sizeof(literal) - 1 &&\
+        std::memcmp(identifier, literal, length) == 0)\
+      return Token::name;\
+    break;
+#define T(name, literal, precedence, flags)
+  switch (KeywordHash(identifier, length)) {
+    TOKEN_LIST(K, T)
+  }
 #undef K
 #undef T
+  return Token::Identifier;
 }
 
-Tokens::Tokens() {
-  InitializeKeywordLookupTable();
-}
-
-Tokens Tokens::singleton;
+// The tables are used with indices only known at run time, which needs
+// a definition
+constexpr const char *Tokens::name_[];
+constexpr const char *Tokens::literal_[];
+constexpr int Tokens::precedence_[];
+constexpr std::uint8_t Tokens::flags_[];
 
 }
\ No newline at end of file
@@ -1,154 +1,215 @@
 #ifndef FLORA_TOKEN_H
 #define FLORA_TOKEN_H
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
-#include <unordered_map>
 
 #include "flora.h"
 
 namespace flora {
 
+// Classification bits of the flags column, keywords are marked by K
+enum TokenFlag : std::uint8_t {
+  kKeywordFlag = 1 << 0,
+  kBinaryFlag = 1 << 1,
+  kAssignmentFlag = 1 << 2,
+  kTypeFlag = 1 << 3,
+  kCompareFlag = 1 << 4
+};
+
 #define TOKEN_LIST(K, T)\
-  K(EndOfSource, "(end of source)", 0)\
+  T(EndOfSource, "(end of source)", 0, 0)\
   /* Punctuation marks */\
-  T(LeftParenthesis, "(", 0)\
-  T(RightParenthesis, ")", 0)\
-  T(LeftBracket, "[", 0)\
-  T(RightBracket, "]", 0)\
-  T(LeftBrace, "{", 0)\
-  T(RightBrace, "}", 0)\
-  T(Colon, ":", 0)\
-  T(Semicolon, ";", 0)\
-  T(Period, ".", 0)\
-  T(Ellipsis, "...", 0)\
-  T(Conditional, "?", 0)\
-  T(Increment, "++", 0)\
-  T(Decrement, "--", 0)\
-  T(Arrow, "=>", 0)\
+  T(LeftParenthesis, "(", 0, 0)\
+  T(RightParenthesis, ")", 0, 0)\
+  T(LeftBracket, "[", 0, 0)\
+  T(RightBracket, "]", 0, 0)\
+  T(LeftBrace, "{", 0, 0)\
+  T(RightBrace, "}", 0, 0)\
+  T(Colon, ":", 0, 0)\
+  T(Semicolon, ";", 0, 0)\
+  T(Period, ".", 0, 0)\
+  T(Ellipsis, "...", 0, 0)\
+  T(Conditional, "?", 0, 0)\
+  T(Increment, "++", 0, 0)\
+  T(Decrement, "--", 0, 0)\
+  T(Arrow, "=>", 0, 0)\
   /* Assignment operators */\
-  T(Assignment, "=", 2)\
-  T(AssignmentBitwiseOr, "|=", 2)\
-  T(AssignmentBitwiseXor, "^=", 2)\
-  T(AssignmentBitwiseAnd, "&=", 2)\
-  T(AssignmentShiftLeft, "<<=",2)\
-  T(AssignmentShiftRight, ">>=",2)\
-  T(AssignmentAddition, "+=", 2)\
-  T(AssignmentSubtraction, "-=", 2)\
-  T(AssignmentMultiplication, "*=", 2)\
-  T(AssignmentDivision, "/=", 2)\
-  T(AssignmentModulus, "%=", 2)\
+  T(Assignment, "=", 2, kAssignmentFlag)\
+  T(AssignmentBitwiseOr, "|=", 2, kAssignmentFlag)\
+  T(AssignmentBitwiseXor, "^=", 2, kAssignmentFlag)\
+  T(AssignmentBitwiseAnd, "&=", 2, kAssignmentFlag)\
+  T(AssignmentShiftLeft, "<<=", 2, kAssignmentFlag)\
+  T(AssignmentShiftRight, ">>=", 2, kAssignmentFlag)\
+  T(AssignmentAddition, "+=", 2, kAssignmentFlag)\
+  T(AssignmentSubtraction, "-=", 2, kAssignmentFlag)\
+  T(AssignmentMultiplication, "*=", 2, kAssignmentFlag)\
+  T(AssignmentDivision, "/=", 2, kAssignmentFlag)\
+  T(AssignmentModulus, "%=", 2, kAssignmentFlag)\
   /* Binary operators */\
-  T(Comma, ",", 1)\
-  T(LogicalOr, "||", 4)\
-  T(LogicalAnd, "&&", 4)\
-  T(BitwiseOr, "|", 6)\
-  T(BitwiseXor, "^", 7)\
-  T(BitwiseAnd, "&", 8)\
-  T(ShiftLeft, "<<", 11)\
-  T(ShiftRight, ">>", 11)\
-  T(Addition, "+", 12)\
-  T(Subtraction, "-", 12)\
-  T(Multiplication, "*", 12)\
-  T(Division, "/", 13)\
-  T(Modulus, "%", 13)\
+  T(Comma, ",", 1, kBinaryFlag)\
+  T(LogicalOr, "||", 4, kBinaryFlag)\
+  T(LogicalAnd, "&&", 5, kBinaryFlag)\
+  T(BitwiseOr, "|", 6, kBinaryFlag)\
+  T(BitwiseXor, "^", 7, kBinaryFlag)\
+  T(BitwiseAnd, "&", 8, kBinaryFlag)\
+  T(ShiftLeft, "<<", 11, kBinaryFlag)\
+  T(ShiftRight, ">>", 11, kBinaryFlag)\
+  T(Addition, "+", 12, kBinaryFlag)\
+  T(Subtraction, "-", 12, kBinaryFlag)\
+  T(Multiplication, "*", 13, kBinaryFlag)\
+  T(Division, "/", 13, kBinaryFlag)\
+  T(Modulus, "%", 13, kBinaryFlag)\
   /* Compare operators */\
-  T(Equal, "==", 9)\
-  T(NotEqual, "!=", 9)\
-  T(LessThan, "<", 10)\
-  T(GreaterThan, ">", 10)\
-  T(LessThanOrEqual, "<=", 10)\
-  T(GreaterThanOrEqual, ">=", 10)\
+  T(Equal, "==", 9, kBinaryFlag | kCompareFlag)\
+  T(NotEqual, "!=", 9, kBinaryFlag | kCompareFlag)\
+  T(LessThan, "<", 10, kBinaryFlag | kCompareFlag)\
+  T(GreaterThan, ">", 10, kBinaryFlag | kCompareFlag)\
+  T(LessThanOrEqual, "<=", 10, kBinaryFlag | kCompareFlag)\
+  T(GreaterThanOrEqual, ">=", 10, kBinaryFlag | kCompareFlag)\
   /* Unary operators */\
-  T(LogicalNot, "!", 0)\
-  T(BitwiseNot, "~", 0)\
+  T(LogicalNot, "!", 0, 0)\
+  T(BitwiseNot, "~", 0, 0)\
   /* Keywords */\
-  K(As, "as", 0)\
-  K(Break, "break", 0)\
-  K(Case, "case", 0)\
-  K(Catch, "catch", 0)\
-  K(Class, "class", 0)\
-  K(Const, "const", 0)\
-  K(Continue, "continue", 0)\
-  K(Default, "default", 0)\
-  K(Do, "do", 0)\
-  K(Else, "else", 0)\
-  K(Enum, "enum", 0)\
-  K(Export, "export", 0)\
-  K(Finally, "finally", 0)\
-  K(For, "for", 0)\
-  K(From, "from", 0)\
-  K(If, "if", 0)\
-  K(Import, "import", 0)\
-  K(New, "new", 0)\
-  K(Private, "private", 0)\
-  K(Public, "public", 0)\
-  K(Return, "return", 0)\
-  K(Static, "static", 0)\
-  K(Switch, "switch", 0)\
-  K(This, "this", 0)\
-  K(Throw, "throw", 0)\
-  K(Try, "try", 0)\
-  K(While, "while", 0)\
+  K(As, "as", 0, 0)\
+  K(Break, "break", 0, 0)\
+  K(Case, "case", 0, 0)\
+  K(Catch, "catch", 0, 0)\
+  K(Class, "class", 0, 0)\
+  K(Const, "const", 0, 0)\
+  K(Continue, "continue", 0, 0)\
+  K(Default, "default", 0, 0)\
+  K(Do, "do", 0, 0)\
+  K(Else, "else", 0, 0)\
+  K(Enum, "enum", 0, 0)\
+  K(Export, "export", 0, 0)\
+  K(Finally, "finally", 0, 0)\
+  K(For, "for", 0, 0)\
+  K(From, "from", 0, 0)\
+  K(If, "if", 0, 0)\
+  K(Import, "import", 0, 0)\
+  K(Namespace, "namespace", 0, 0)\
+  K(New, "new", 0, 0)\
+  K(Private, "private", 0, 0)\
+  K(Public, "public", 0, 0)\
+  K(Return, "return", 0, 0)\
+  K(Static, "static", 0, 0)\
+  K(Switch, "switch", 0, 0)\
+  K(This, "this", 0, 0)\
+  K(Throw, "throw", 0, 0)\
+  K(Try, "try", 0, 0)\
+  K(While, "while", 0, 0)\
   /* Built-in types */\
-  K(Bool, "bool", 0)\
-  K(Char, "char", 0)\
-  K(Double, "double", 0)\
-  K(Float, "float", 0)\
-  K(Int, "int", 0)\
-  K(Long, "long", 0)\
-  K(Short, "short", 0)\
-  K(Unsigned, "unsigned", 0)\
+  K(Bool, "bool", 0, kTypeFlag)\
+  K(Char, "char", 0, kTypeFlag)\
+  K(Double, "double", 0, kTypeFlag)\
+  K(Float, "float", 0, kTypeFlag)\
+  K(Int, "int", 0, kTypeFlag)\
+  K(Long, "long", 0, kTypeFlag)\
+  K(Short, "short", 0, kTypeFlag)\
+  K(Unsigned, "unsigned", 0, kTypeFlag)\
   /* Literals */\
-  K(Null, "null", 0)\
-  K(True, "true", 0)\
-  K(False, "false", 0)\
-  T(Integer, nullptr, 0)\
-  T(RealNumber, nullptr, 0)\
-  T(Character, nullptr, 0)\
-  T(String, nullptr, 0)\
+  K(Null, "null", 0, 0)\
+  K(True, "true", 0, 0)\
+  K(False, "false", 0, 0)\
+  T(Integer, nullptr, 0, 0)\
+  T(RealNumber, nullptr, 0, 0)\
+  T(Character, nullptr, 0, 0)\
+  T(String, nullptr, 0, 0)\
   /* Identifier */\
-  T(Identifier, nullptr, 0)\
+  T(Identifier, nullptr, 0, 0)\
   /* Illegal token */\
-  T(Illegal, nullptr, 0)
+  T(Illegal, nullptr, 0, 0)
 
 
 enum class Token : int {
-#define T(name, string, precedence) name,
+#define T(name, string, precedence, flags) name,
   TOKEN_LIST(T, T)
   TOKEN_COUNT
 #undef T
 };
 
+// The tables are constant initialized and never written, so every thread
+// of the driver reads them without locks
 class Tokens {
 public:
 
-  static const char* Name(Token token) {
+  static constexpr const char* Name(Token token) {
     return name_[static_cast<int>(token)];
   }
 
-  static const char* Literal(Token token) {
+  static constexpr const char* Literal(Token token) {
     return literal_[static_cast<int>(token)];
   }
 
-  static int Precedence(Token token) {
+  static constexpr int Precedence(Token token) {
     return precedence_[static_cast<int>(token)];
   }
 
-  static Token LookupKeyword(const std::string &identifier);
+  static constexpr bool IsKeyword(Token token) {
+    return flags_[static_cast<int>(token)] & kKeywordFlag;
+  }
+
+  // Binary and compare operators, the comma included
+  static constexpr bool IsBinaryOperator(Token token) {
+    return flags_[static_cast<int>(token)] & kBinaryFlag;
+  }
+
+  static constexpr bool IsCompareOperator(Token token) {
+    return flags_[static_cast<int>(token)] & kCompareFlag;
+  }
+
+  static constexpr bool IsAssignment(Token token) {
+    return flags_[static_cast<int>(token)] & kAssignmentFlag;
+  }
+
+  // Built-in types
+  static constexpr bool IsType(Token token) {
+    return flags_[static_cast<int>(token)] & kTypeFlag;
+  }
+
+  // Returns Token::Identifier if the identifier is not a keyword
+  static Token LookupKeyword(const char *identifier, std::size_t length);
+  static Token LookupKeyword(const std::string &identifier) {
+    return LookupKeyword(identifier.data(), identifier.size());
+  }
 
 private:
   // The number of tokens
   static const int TOKEN_COUNT = static_cast<int>(Token::TOKEN_COUNT);
-  // Token information
-  static const char *name_[TOKEN_COUNT];
-  static const char *literal_[TOKEN_COUNT];
-  static const int precedence_[TOKEN_COUNT];
-  // Hashtable used to lookup keywords
-  static std::unordered_map<std::string, Token> lookup_table_;
-  static void InitializeKeywordLookupTable();
-  // Singleton object used to automatically initialize hashtable
-  Tokens();
-  static Tokens singleton;
+  // Token information, constant so that there is nothing to initialize at
+  // program start
+#define T(name, literal, precedence, flags) #name,
+  static constexpr const char *name_[TOKEN_COUNT] = {
+    TOKEN_LIST(T, T)
+  };
+#undef T
+#define T(name, literal, precedence, flags) literal,
+  static constexpr const char *literal_[TOKEN_COUNT] = {
+    TOKEN_LIST(T, T)
+  };
+#undef T
+#define T(name, literal, precedence, flags) precedence,
+  static constexpr int precedence_[TOKEN_COUNT] = {
+    TOKEN_LIST(T, T)
+  };
+#undef T
+#define K(name, literal, precedence, flags) kKeywordFlag | flags,
+#define T(name, literal, precedence, flags) flags,
+  static constexpr std::uint8_t flags_[TOKEN_COUNT] = {
+    TOKEN_LIST(K, T)
+  };
+#undef K
+#undef T
+  // Perfect hash of keywords, computed from the first character, the last
+  // character and the length. The coefficients are chosen so that every
+  // keyword in TOKEN_LIST lands in a distinct slot.
+  static constexpr unsigned KeywordHash(const char *s, std::size_t length) {
+    return (static_cast<unsigned char>(s[0]) +
+            static_cast<unsigned char>(s[length - 1]) * 57u +
+            static_cast<unsigned>(length) * 12u) & 127u;
+  }
 };
 
 }
@@ -0,0 +1,41 @@
+#include "utf8.h"
+
+#include <cstdint>
+#include <cstring>
+
+#include "character-search.h"
+
+namespace flora {
+namespace utf8 {
+
+const char* Validate(const char *begin, const char *end) {
+  const std::uint64_t kHighBits = 0x8080808080808080ull;
+  const char *p = begin;
+  while (p != end) {
+    if (static_cast<unsigned char>(*p) < 0x80) {
+      // Short ASCII runs between multibyte characters are skipped a word at
+      // a time, long runs are handed to the block search
+      int words = 0;
+      std::uint64_t word;
+      while (end - p >= 8) {
+        std::memcpy(&word, p, sizeof(word));
+        if (word & kHighBits) break;
+        p += 8;
+        if (++words == 4) {
+          p = character::FindNonAscii(p, end);
+          break;
+        }
+      }
+      while (p != end && static_cast<unsigned char>(*p) < 0x80) p++;
+      continue;
+    }
+    char32_t codepoint;
+    int length = Decode(p, end, &codepoint);
+    if (length == 0) return p;
+    p += length;
+  }
+  return end;
+}
+
+}
+}
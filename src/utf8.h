@@ -0,0 +1,99 @@
+#ifndef FLORA_UTF8_H
+#define FLORA_UTF8_H
+
+#include <cstddef>
+#include <string>
+
+#include "flora.h"
+
+namespace flora {
+namespace utf8 {
+
+// Decodes one UTF-8 sequence at [p, end). Returns its length in bytes and
+// stores the codepoint, or returns 0 if the sequence is malformed: truncated,
+// overlong, a surrogate or beyond U+10FFFF.
+inline int Decode(const char *p, const char *end, char32_t *codepoint) {
+  const unsigned char *s = reinterpret_cast<const unsigned char*>(p);
+  std::ptrdiff_t available = end - p;
+  if (available <= 0) return 0;
+  unsigned char lead = s[0];
+  if (lead < 0x80) {
+    *codepoint = lead;
+    return 1;
+  }
+  int length;
+  char32_t value;
+  char32_t minimum;
+  if ((lead & 0xE0) == 0xC0) {
+    length = 2; value = lead & 0x1F; minimum = 0x80;
+  } else if ((lead & 0xF0) == 0xE0) {
+    length = 3; value = lead & 0x0F; minimum = 0x800;
+  } else if ((lead & 0xF8) == 0xF0) {
+    length = 4; value = lead & 0x07; minimum = 0x10000;
+  } else {
+    return 0;
+  }
+  if (available < length) return 0;
+  for (int i = 1; i < length; i++) {
+    if ((s[i] & 0xC0) != 0x80) return 0;
+    value = (value << 6) | (s[i] & 0x3F);
+  }
+  if (value < minimum || value > 0x10FFFF ||
+      (value >= 0xD800 && value <= 0xDFFF))
+    return 0;
+  *codepoint = value;
+  return length;
+}
+
+// Decodes one multibyte sequence of a buffer that is known to be valid,
+// returns its length
+inline int DecodeValid(const char *p, char32_t *codepoint) {
+  const unsigned char *s = reinterpret_cast<const unsigned char*>(p);
+  if (s[0] < 0xE0) {
+    *codepoint = ((s[0] & 0x1F) << 6) | (s[1] & 0x3F);
+    return 2;
+  } else if (s[0] < 0xF0) {
+    *codepoint = ((s[0] & 0x0F) << 12) | ((s[1] & 0x3F) << 6) | (s[2] & 0x3F);
+    return 3;
+  }
+  *codepoint = ((s[0] & 0x07) << 18) | ((s[1] & 0x3F) << 12) |
+      ((s[2] & 0x3F) << 6) | (s[3] & 0x3F);
+  return 4;
+}
+
+// Returns true if the codepoint can be encoded, i.e. it is at most U+10FFFF
+// and not a surrogate
+inline bool IsValidCodepoint(char32_t codepoint) {
+  return codepoint <= 0x10FFFF && (codepoint < 0xD800 || codepoint > 0xDFFF);
+}
+
+// Appends the UTF-8 encoding of the codepoint, invalid codepoints are
+// replaced with U+FFFD
+inline void Append(std::string *out, char32_t codepoint) {
+  if (!IsValidCodepoint(codepoint)) codepoint = 0xFFFD;
+  if (codepoint < 0x80) {
+    out->push_back(static_cast<char>(codepoint));
+  } else if (codepoint < 0x800) {
+    out->push_back(static_cast<char>(0xC0 | (codepoint >> 6)));
+    out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+  } else if (codepoint < 0x10000) {
+    out->push_back(static_cast<char>(0xE0 | (codepoint >> 12)));
+    out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+  } else {
+    out->push_back(static_cast<char>(0xF0 | (codepoint >> 18)));
+    out->push_back(static_cast<char>(0x80 | ((codepoint >> 12) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | ((codepoint >> 6) & 0x3F)));
+    out->push_back(static_cast<char>(0x80 | (codepoint & 0x3F)));
+  }
+}
+
+// Returns the end of the longest valid UTF-8 prefix of [begin, end). ASCII
+// blocks are skipped with the block search, only multibyte sequences are
+// decoded one by one.
+const char* Validate(const char *begin, const char *end);
+
+}
+}
+
+#endif
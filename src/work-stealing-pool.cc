@@ -0,0 +1,97 @@
+#include "work-stealing-pool.h"
+
+namespace flora {
+
+namespace {
+
+// The pool and the worker index of the current thread, so that tasks
+// submitted by a worker go to its own queue
+thread_local const WorkStealingPool *current_pool = nullptr;
+thread_local unsigned current_worker = 0;
+
+}
+
+WorkStealingPool::WorkStealingPool(unsigned threads)
+    : next_queue_(0), pending_(0), queued_(0), stopping_(false) {
+  if (threads == 0) threads = std::thread::hardware_concurrency();
+  if (threads == 0) threads = 1;
+  for (unsigned i = 0; i < threads; i++)
+    queues_.emplace_back(new Queue());
+  for (unsigned i = 0; i < threads; i++)
+    workers_.emplace_back(&WorkStealingPool::Run, this, i);
+}
+
+WorkStealingPool::~WorkStealingPool() {
+  Wait();
+  {
+    std::lock_guard<std::mutex> lock(sleep_mutex_);
+    stopping_ = true;
+  }
+  work_available_.notify_all();
+  for (std::thread &worker : workers_) worker.join();
+}
+
+void WorkStealingPool::Submit(Task task) {
+  unsigned index = current_pool == this ? current_worker :
+      next_queue_.fetch_add(1, std::memory_order_relaxed) % threads();
+  pending_.fetch_add(1);
+  Queue &queue = *queues_[index];
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.tasks.push_back(std::move(task));
+    queued_.fetch_add(1);
+  }
+  // A worker checks for work under the sleep lock, taking it here means
+  // the worker either sees the task or is already waiting
+  { std::lock_guard<std::mutex> lock(sleep_mutex_); }
+  work_available_.notify_one();
+}
+
+void WorkStealingPool::Wait() {
+  std::unique_lock<std::mutex> lock(sleep_mutex_);
+  all_done_.wait(lock, [this] { return pending_.load() == 0; });
+}
+
+void WorkStealingPool::Run(unsigned worker) {
+  current_pool = this;
+  current_worker = worker;
+  Task task;
+  while (true) {
+    if (Take(worker, &task)) {
+      task(worker);
+      task = nullptr;
+      if (pending_.fetch_sub(1) == 1) {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        all_done_.notify_all();
+      }
+      continue;
+    }
+    std::unique_lock<std::mutex> lock(sleep_mutex_);
+    work_available_.wait(lock, [this] {
+      return stopping_ || queued_.load() > 0;
+    });
+    if (stopping_) return;
+  }
+}
+
+bool WorkStealingPool::Take(unsigned worker, Task *task) {
+  unsigned count = threads();
+  for (unsigned i = 0; i < count; i++) {
+    Queue &queue = *queues_[(worker + i) % count];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) continue;
+    // The newest of its own tasks, the oldest of another's
+    if (i == 0) {
+      *task = std::move(queue.tasks.back());
+      queue.tasks.pop_back();
+    } else {
+      *task = std::move(queue.tasks.front());
+      queue.tasks.pop_front();
+    }
+    queued_.fetch_sub(1);
+    return true;
+  }
+  return false;
+}
+
+}
@@ -0,0 +1,67 @@
+#ifndef FLORA_WORK_STEALING_POOL_H
+#define FLORA_WORK_STEALING_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "flora.h"
+
+namespace flora {
+
+// Runs tasks on a fixed set of threads. Each worker has its own queue:
+// it takes its newest task first, and when the queue is empty it steals
+// the oldest task of another worker. Tasks submitted by a worker go to
+// its own queue, so a task that spawns more work keeps it close, and the
+// other workers only touch that queue when they run dry.
+class WorkStealingPool {
+public:
+  NOCOPY_CLASS(WorkStealingPool)
+
+  // The index of the worker running the task, from 0 to threads() - 1
+  typedef std::function<void(unsigned worker)> Task;
+
+  // Zero threads means one per hardware thread
+  explicit WorkStealingPool(unsigned threads = 0);
+  // Waits for the submitted tasks
+  ~WorkStealingPool();
+
+  unsigned threads() const { return static_cast<unsigned>(queues_.size()); }
+
+  // Safe to call from any thread, including from a task
+  void Submit(Task task);
+  // Block until every submitted task has run, tasks they submit included.
+  // Must not be called from a task.
+  void Wait();
+private:
+  struct Queue {
+    std::mutex mutex;
+    std::deque<Task> tasks;
+  };
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::vector<std::thread> workers_;
+  // Where tasks from outside the pool go next
+  std::atomic<unsigned> next_queue_;
+  // Tasks submitted and not finished, and tasks in the queues
+  std::atomic<std::size_t> pending_;
+  std::atomic<std::size_t> queued_;
+  // Idle workers and Wait() sleep here
+  std::mutex sleep_mutex_;
+  std::condition_variable work_available_;
+  std::condition_variable all_done_;
+  bool stopping_;
+
+  void Run(unsigned worker);
+  // Take a task from the worker's queue, or steal one
+  bool Take(unsigned worker, Task *task);
+};
+
+}
+
+#endif
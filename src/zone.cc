@@ -0,0 +1,61 @@
+#include "zone.h"
+
+#include <cstdlib>
+
+namespace flora {
+
+Zone::Zone()
+    : position_(nullptr), limit_(nullptr), head_(nullptr),
+      allocation_size_(0), segment_bytes_(0) { }
+
+Zone::~Zone() {
+  DeleteSegments(head_);
+}
+
+void Zone::Reset() {
+  if (!head_) return;
+  // The first segment is the last one in the list
+  Segment *first = head_;
+  while (first->next) first = first->next;
+  Segment *segment = head_;
+  while (segment != first) {
+    Segment *next = segment->next;
+    std::free(segment);
+    segment = next;
+  }
+  head_ = first;
+  segment_bytes_ = first->size;
+  position_ = reinterpret_cast<char*>(first) + sizeof(Segment);
+  limit_ = reinterpret_cast<char*>(first) + first->size;
+  allocation_size_ = 0;
+}
+
+void* Zone::NewExpand(std::size_t size) {
+  // Segments double in size up to the maximum, a larger object gets a
+  // segment of its own
+  std::size_t segment_size = head_ ? head_->size * 2 : kMinimumSegmentSize;
+  if (segment_size > kMaximumSegmentSize) segment_size = kMaximumSegmentSize;
+  if (segment_size < size + sizeof(Segment))
+    segment_size = size + sizeof(Segment);
+  Segment *segment = static_cast<Segment*>(std::malloc(segment_size));
+  if (!segment) throw std::bad_alloc();
+  segment->next = head_;
+  segment->size = segment_size;
+  head_ = segment;
+  segment_bytes_ += segment_size;
+  char *start = reinterpret_cast<char*>(segment) + sizeof(Segment);
+  position_ = start + size;
+  limit_ = reinterpret_cast<char*>(segment) + segment_size;
+  allocation_size_ += size;
+  return start;
+}
+
+void Zone::DeleteSegments(Segment *segment) {
+  while (segment) {
+    Segment *next = segment->next;
+    std::free(segment);
+    segment = next;
+  }
+}
+
+}
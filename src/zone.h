@@ -0,0 +1,128 @@
+#ifndef FLORA_ZONE_H
+#define FLORA_ZONE_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <utility>
+#include <vector>
+
+#include "flora.h"
+#include "checks.h"
+
+namespace flora {
+
+// A bump-pointer arena. Objects allocated in a zone are never destructed
+// one by one, the whole zone is released at once. The parser allocates
+// every node, scope and child list of a translation unit in one zone.
+class Zone {
+public:
+  NOCOPY_CLASS(Zone)
+
+  Zone();
+  ~Zone();
+
+  // Allocate size bytes aligned to kAlignment
+  void* New(std::size_t size) {
+    size = (size + kAlignment - 1) & ~(kAlignment - 1);
+    if (static_cast<std::size_t>(limit_ - position_) < size)
+      return NewExpand(size);
+    void *result = position_;
+    position_ += size;
+    allocation_size_ += size;
+    return result;
+  }
+
+  template <typename T>
+  T* NewArray(std::size_t count) {
+    return static_cast<T*>(New(count * sizeof(T)));
+  }
+
+  // Release everything but the first segment, which is kept for reuse
+  void Reset();
+
+  // The bytes handed out and the bytes held in segments
+  std::size_t allocation_size() const { return allocation_size_; }
+  std::size_t segment_bytes() const { return segment_bytes_; }
+
+  static const std::size_t kAlignment = 8;
+private:
+  // Segments are linked through a header at their start
+  struct Segment {
+    Segment *next;
+    std::size_t size;
+  };
+  static const std::size_t kMinimumSegmentSize = 8 * 1024;
+  static const std::size_t kMaximumSegmentSize = 1024 * 1024;
+  char *position_;
+  char *limit_;
+  Segment *head_;
+  std::size_t allocation_size_;
+  std::size_t segment_bytes_;
+  void* NewExpand(std::size_t size);
+  void DeleteSegments(Segment *segment);
+};
+
+// Base of classes which live in a zone. They must not own memory outside
+// the zone since their destructors are never called.
+class ZoneObject {
+public:
+  void* operator new(std::size_t size, Zone *zone) { return zone->New(size); }
+  // Only called if a constructor throws
+  void operator delete(void*, Zone*) { }
+  // Zone objects are released with their zone
+  void operator delete(void*, std::size_t) { UNREACHABLE(); }
+};
+
+// A fixed array of elements allocated in a zone
+template <typename T>
+class ZoneSpan {
+public:
+  ZoneSpan() : data_(nullptr), size_(0) { }
+  ZoneSpan(T *data, std::size_t size)
+      : data_(data), size_(static_cast<std::uint32_t>(size)) { }
+
+  T* data() const { return data_; }
+  std::size_t size() const { return size_; }
+  bool empty() const { return size_ == 0; }
+  T* begin() const { return data_; }
+  T* end() const { return data_ + size_; }
+  T& operator[] (std::size_t index) const { return data_[index]; }
+private:
+  T *data_;
+  std::uint32_t size_;
+};
+
+// Collects pointers for one list on a buffer shared by all lists being
+// built, then copies them into the zone. Lists nest like the grammar does,
+// so the buffer works as a stack and no list needs its own vector. An
+// inner list must be gone before its outer list adds again.
+template <typename T>
+class ScopedPtrList {
+public:
+  NOCOPY_CLASS(ScopedPtrList)
+
+  explicit ScopedPtrList(std::vector<void*> *buffer)
+      : buffer_(buffer), start_(buffer->size()) { }
+  ~ScopedPtrList() { buffer_->resize(start_); }
+
+  void Add(T *element) { buffer_->push_back(element); }
+  std::size_t size() const { return buffer_->size() - start_; }
+  T* at(std::size_t index) const {
+    return static_cast<T*>((*buffer_)[start_ + index]);
+  }
+
+  ZoneSpan<T*> ToSpan(Zone *zone) const {
+    std::size_t count = size();
+    T **data = zone->NewArray<T*>(count);
+    for (std::size_t i = 0; i < count; i++) data[i] = at(i);
+    return ZoneSpan<T*>(data, count);
+  }
+private:
+  std::vector<void*> *buffer_;
+  std::size_t start_;
+};
+
+}
+
+#endif
@@ -0,0 +1,153 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../src/driver.h"
+#include "../../src/module-loader.h"
+
+using flora::Driver;
+using flora::ModuleLoader;
+
+namespace {
+
+const int kFiles = 400;
+const int kClassesPerFile = 10;
+const int kMethodsPerClass = 20;
+const char *kModuleRoot = "bench_modules.tmp";
+
+// Writes the corpus, files of classes of small methods. Every fourth file
+// is four times larger, so that the workers have to balance.
+std::vector<std::string> GenerateCorpus() {
+  std::vector<std::string> paths;
+  for (int i = 0; i < kFiles; i++) {
+    std::string path = "bench_" + std::to_string(i) + ".tmp";
+    std::ofstream out(path);
+    out << "import std.io;\n";
+    int classes = i % 4 == 0 ? 4 * kClassesPerFile : kClassesPerFile;
+    for (int klass = 0; klass < classes; klass++) {
+      out << "class C" << klass << " {\n  public int value;\n";
+      for (int method = 0; method < kMethodsPerClass; method++) {
+        out << "  int m" << method << "(int x) {\n"
+               "    int y = x * " << method << " + value;\n"
+               "    if (y > 100) return y - 1;\n"
+               "    return io.print(y);\n"
+               "  }\n";
+      }
+      out << "}\n";
+    }
+    paths.push_back(path);
+  }
+  return paths;
+}
+
+// Writes kFiles modules of one class each, with the imports of the graph.
+// In the wide graph main imports every module and they all import base,
+// in the chain each module imports the next one.
+void GenerateModules(bool chain) {
+  mkdir(kModuleRoot, 0755);
+  std::string root = kModuleRoot;
+  std::ofstream(root + "/base.flora") << "int base() { return 0; }\n";
+  std::ofstream main(root + "/main.flora");
+  for (int i = 0; i < kFiles; i++) {
+    if (!chain || i == 0) main << "import m" << i << ";\n";
+    std::ofstream out(root + "/m" + std::to_string(i) + ".flora");
+    if (!chain) {
+      out << "import base;\n";
+    } else if (i + 1 < kFiles) {
+      out << "import m" << i + 1 << ";\n";
+    }
+    out << "class C {\n";
+    for (int method = 0; method < kMethodsPerClass; method++) {
+      out << "  int m" << method << "(int x) {\n"
+             "    return x * " << method << " + " << i << ";\n"
+             "  }\n";
+    }
+    out << "}\n";
+  }
+  main << "int main() { return 0; }\n";
+}
+
+void RemoveModules() {
+  std::string root = kModuleRoot;
+  std::remove((root + "/base.flora").c_str());
+  std::remove((root + "/main.flora").c_str());
+  for (int i = 0; i < kFiles; i++)
+    std::remove((root + "/m" + std::to_string(i) + ".flora").c_str());
+  rmdir(kModuleRoot);
+}
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+// Parses the corpus with a new driver, returns the seconds taken
+double Run(const std::vector<std::string> &paths, unsigned threads,
+           bool lazy, std::size_t *bytes) {
+  auto start = std::chrono::steady_clock::now();
+  Driver driver(threads);
+  driver.set_lazy(lazy);
+  driver.Parse(paths);
+  double seconds = Seconds(start);
+  *bytes = 0;
+  for (const auto &file : driver.files()) *bytes += file->source().size();
+  return seconds;
+}
+
+// Loads the module graph from main with a new driver, returns the seconds
+// taken
+double Load(unsigned threads, std::size_t *modules) {
+  auto start = std::chrono::steady_clock::now();
+  Driver driver(threads);
+  ModuleLoader loader(&driver, { kModuleRoot });
+  loader.Load({ "main" });
+  double seconds = Seconds(start);
+  *modules = loader.size();
+  return seconds;
+}
+
+}
+
+int main() {
+  std::vector<std::string> paths = GenerateCorpus();
+  unsigned hardware = std::thread::hardware_concurrency();
+  if (hardware == 0) hardware = 1;
+  for (int lazy = 0; lazy < 2; lazy++) {
+    double single = 0;
+    for (unsigned threads = 1; ; threads *= 2) {
+      if (threads > hardware) threads = hardware;
+      std::size_t bytes;
+      double seconds = Run(paths, threads, lazy, &bytes);
+      if (threads == 1) single = seconds;
+      std::printf("%-6s %2u threads %10.1f MB/s  %5.2fx  (%zu files, %zu "
+                  "bytes)\n", lazy ? "lazy" : "eager", threads,
+                  bytes / seconds / (1024 * 1024), single / seconds,
+                  paths.size(), bytes);
+      if (threads == hardware) break;
+    }
+  }
+  for (const std::string &path : paths) std::remove(path.c_str());
+  for (int chain = 0; chain < 2; chain++) {
+    GenerateModules(chain);
+    double single = 0;
+    for (unsigned threads = 1; ; threads *= 2) {
+      if (threads > hardware) threads = hardware;
+      std::size_t modules;
+      double seconds = Load(threads, &modules);
+      if (threads == 1) single = seconds;
+      std::printf("%-6s %2u threads %10.2f ms    %5.2fx  (%zu modules)\n",
+                  chain ? "chain" : "wide", threads, seconds * 1000,
+                  single / seconds, modules);
+      if (threads == hardware) break;
+    }
+    RemoveModules();
+  }
+  return 0;
+}
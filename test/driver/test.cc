@@ -0,0 +1,192 @@
+#include <atomic>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "../../src/ast.h"
+#include "../../src/driver.h"
+#include "../../src/flat-ast.h"
+#include "../../src/module-loader.h"
+#include "../../src/parser.h"
+#include "../../src/symbol-table.h"
+#include "../../src/work-stealing-pool.h"
+#include "../../src/zone.h"
+
+using flora::Driver;
+using flora::Module;
+using flora::ModuleLoader;
+using flora::Parser;
+using flora::SourceFile;
+using flora::StringSpan;
+using flora::SymbolTable;
+using flora::WorkStealingPool;
+using flora::Zone;
+using namespace flora::ast;
+
+// Returns true if every task runs once, also tasks submitted by tasks,
+// and the pool can be waited for again
+bool CheckPool() {
+  WorkStealingPool pool(4);
+  std::atomic<int> runs(0);
+  std::atomic<bool> bad_worker(false);
+  for (int round = 0; round < 3; round++) {
+    runs = 0;
+    for (int i = 0; i < 1000; i++) {
+      pool.Submit([&](unsigned worker) {
+        if (worker >= pool.threads()) bad_worker = true;
+        runs++;
+        // Each task spawns two more, which spawn none
+        for (int j = 0; j < 2; j++)
+          pool.Submit([&](unsigned) { runs++; });
+      });
+    }
+    pool.Wait();
+    if (runs != 3000 || bad_worker) return false;
+  }
+  return true;
+}
+
+// Returns true if the names of the declarations are their global symbols
+bool SameSymbols(const Driver &driver, const SourceFile &file) {
+  for (Declaration *declaration : file.unit->declarations()) {
+    flora::Symbol symbol = driver.GlobalSymbol(file, declaration->symbol());
+    if (driver.symbols().Name(symbol) != declaration->name()) return false;
+  }
+  return true;
+}
+
+// Returns true if parsing files on several threads gives the trees and
+// errors of parsing them one by one
+bool CheckDriver() {
+  std::vector<std::string> paths;
+  for (int i = 0; i < 40; i++) {
+    std::string path = "driver_" + std::to_string(i) + ".tmp";
+    std::ofstream out(path);
+    out << "import std.io;\n"
+           "class C" << i << " {\n"
+           "  public int value = " << i << ";\n"
+           "  int get(int x) { return value + x * " << i << "; }\n"
+           "}\n"
+           "int f" << i << "() { return C" << i << ".get(" << i << "); }\n";
+    // Every tenth file has a syntax error
+    if (i % 10 == 9) out << "int broken( {\n";
+    paths.push_back(path);
+  }
+  paths.push_back("driver_missing.tmp");
+  Driver driver(4);
+  std::size_t failed = driver.Parse(paths);
+  bool result = failed == 5 && driver.files().size() == paths.size();
+  for (const auto &file : driver.files()) {
+    if (file->path == "driver_missing.tmp") {
+      result = result && !file->unit && !file->error_message.empty();
+      continue;
+    }
+    Zone zone;
+    SymbolTable symbols;
+    Parser parser(&zone, &symbols);
+    StringSpan source = file->source();
+    TranslationUnit *expected = parser.Parse(source.data(), source.size());
+    if (!expected || !file->unit) {
+      result = result && !expected && !file->unit &&
+          file->error_message == parser.error_message() &&
+          file->error_position == parser.error_position();
+      continue;
+    }
+    result = result &&
+        flora::flat::SameTree(file->unit, expected, source) &&
+        SameSymbols(driver, *file);
+  }
+  for (int i = 0; i < 40; i++)
+    std::remove(("driver_" + std::to_string(i) + ".tmp").c_str());
+  return result;
+}
+
+// Returns true if modules load after their imports, each once, and
+// missing modules, cycles and late imports are errors of their importers
+bool CheckModuleLoader() {
+  const char *directories[] = { "modules.tmp", "modules.tmp/lib" };
+  const struct {
+    const char *path;
+    const char *source;
+  } files[] = {
+    { "modules.tmp/app.flora",
+      "import lib.b;\nimport lib.c as c;\nint main() { return c.f(); }\n" },
+    { "modules.tmp/lib/b.flora", "import lib.d;\nint f() { return 1; }\n" },
+    { "modules.tmp/lib/c.flora",
+      "/* header */ import lib.d;\nimport lib.d;\nint f() { return 2; }\n" },
+    { "modules.tmp/lib/d.flora", "int g() { return 3; }\n" },
+    { "modules.tmp/first.flora", "import second;\n" },
+    { "modules.tmp/second.flora", "import first;\n" },
+    { "modules.tmp/user.flora", "import first;\nimport lib.d;\n" },
+    { "modules.tmp/late.flora", "int x = 1;\nimport lib.d;\n" },
+    { "modules.tmp/missing.flora", "import nowhere;\n" },
+    { "modules.tmp/broken.flora", "import lib.d;\nint f( {\n" },
+    { "modules.tmp/uses_broken.flora", "import broken;\n" },
+  };
+  for (const char *directory : directories) mkdir(directory, 0755);
+  for (const auto &file : files) std::ofstream(file.path) << file.source;
+
+  Driver driver(4);
+  ModuleLoader loader(&driver, { "absent.tmp", "modules.tmp" });
+  std::vector<const Module*> loaded = loader.Load({ "app", "lib.b" });
+  const Module *app = loaded[0], *b = app->imports[0];
+  const Module *c = app->imports[1], *d = b->imports[0];
+  bool result = app->ok() && b == loaded[1] && loader.size() == 4 &&
+      driver.files().size() == 4 && c->imports.size() == 2 &&
+      c->imports[0] == d && c->imports[1] == d && d->imports.empty() &&
+      d->order < b->order && d->order < c->order &&
+      b->order < app->order && c->order < app->order &&
+      app->file->path == "modules.tmp/app.flora";
+  // Loaded modules are reused
+  loaded = loader.Load({ "lib.c", "user", "late", "missing", "uses_broken" });
+  result = result && loaded[0] == c && loader.size() == 12 &&
+      driver.files().size() == 11;
+  const Module *user = loaded[1];
+  const Module *first = user->imports[0];
+  result = result && !first->ok() && !first->imports[0]->ok() &&
+      first->error_message == "import cycle through first" &&
+      first->order == Module::kNotAnalyzed &&
+      user->error_message == "imports a module in an import cycle" &&
+      loaded[2]->error_message ==
+          "imports must come before other declarations" &&
+      loaded[3]->error_message == "imported module nowhere has errors" &&
+      loaded[3]->imports[0]->error_message ==
+          "cannot find module nowhere" &&
+      !loaded[3]->imports[0]->file &&
+      loaded[4]->error_message == "imported module broken has errors" &&
+      loaded[4]->imports[0]->error_message ==
+          loaded[4]->imports[0]->file->error_message;
+
+  for (const auto &file : files) std::remove(file.path);
+  rmdir(directories[1]);
+  rmdir(directories[0]);
+  return result;
+}
+
+int main(int argc, char const *argv[]) {
+  int result = 0;
+  if (CheckPool()) {
+    std::cout << "WorkStealingPool matches" << std::endl;
+  } else {
+    std::cout << "WorkStealingPool mismatches" << std::endl;
+    result = 1;
+  }
+  if (CheckDriver()) {
+    std::cout << "Driver matches" << std::endl;
+  } else {
+    std::cout << "Driver mismatches" << std::endl;
+    result = 1;
+  }
+  if (CheckModuleLoader()) {
+    std::cout << "ModuleLoader matches" << std::endl;
+  } else {
+    std::cout << "ModuleLoader mismatches" << std::endl;
+    result = 1;
+  }
+  return result;
+}
@@ -0,0 +1,184 @@
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "../../src/ast.h"
+#include "../../src/flat-ast.h"
+#include "../../src/incremental-parser.h"
+#include "../../src/parser.h"
+#include "../../src/symbol-table.h"
+#include "../../src/zone.h"
+
+using flora::IncrementalParser;
+using flora::Parser;
+using flora::SymbolTable;
+using flora::TextEdit;
+using flora::Zone;
+using flora::flat::FlatAst;
+using flora::flat::NodeIndex;
+
+namespace {
+
+const std::size_t kLines = 100000;
+
+// Writes namespaces of classes of small methods, about kLines lines
+std::string GenerateProgram() {
+  std::string program = "import std.io;\n";
+  std::size_t lines = 1;
+  for (int space = 0; lines < kLines; space++) {
+    program += "namespace n" + std::to_string(space) + " {\n";
+    lines++;
+    for (int klass = 0; klass < 20 && lines < kLines; klass++) {
+      program += "  class C" + std::to_string(klass) + " {\n"
+                 "    public int value;\n";
+      lines += 2;
+      for (int method = 0; method < 10; method++) {
+        program += "    int m" + std::to_string(method) + "(int x) {\n"
+                   "      int y = x * 3 + value;\n"
+                   "      if (y > 100) return y - 1;\n"
+                   "      return y;\n"
+                   "    }\n";
+        lines += 5;
+      }
+      program += "  }\n";
+      lines++;
+    }
+    program += "}\n";
+    lines++;
+  }
+  return program;
+}
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void Report(const char *name, std::size_t runs, double seconds,
+            const char *counter, std::size_t count) {
+  std::printf("%-28s %10.1f us/run    (%zu runs, %s %zu)\n", name,
+              seconds * 1e6 / runs, runs, counter, count);
+}
+
+void BenchFullParse(const std::string &program) {
+  SymbolTable symbols;
+  IncrementalParser parser(&symbols);
+  const std::size_t kParses = 5;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < kParses; i++)
+    parser.Parse(program.data(), program.size());
+  double seconds = Seconds(start);
+  // The statistics are those of the last parse alone
+  flora::ParseStatistics statistics = parser.parser()->statistics();
+  Report("full parse", kParses, seconds, "nodes", statistics.node_count);
+  std::printf("%-28s %10.1f MB\n", "zone per parse",
+              statistics.zone_bytes / (1024.0 * 1024));
+}
+
+// Sums the lengths of the variable names, a pass over the whole tree
+class VariableLengths : public flora::flat::FlatAstVisitor<VariableLengths> {
+public:
+  explicit VariableLengths(const FlatAst *ast)
+      : flora::flat::FlatAstVisitor<VariableLengths>(ast), total(0) { }
+  void VisitVariable(NodeIndex node) { total += ast_->rhs(node); }
+  std::size_t total;
+};
+
+// The same pass over the pointer tree
+std::size_t PointerVariableLengths(const flora::ast::Node *root) {
+  std::size_t total = 0;
+  std::vector<const flora::ast::Node*> stack(1, root);
+  while (!stack.empty()) {
+    const flora::ast::Node *node = stack.back();
+    stack.pop_back();
+    if (node->IsVariable()) {
+      total += static_cast<const flora::ast::Variable*>(node)->name().size();
+    }
+    flora::ast::ForEachChild(node, [&stack](const flora::ast::Node *child) {
+      if (child) stack.push_back(child);
+    });
+  }
+  return total;
+}
+
+// Compares the sizes of the two trees and the speed of a pass over each
+void BenchFlatAst(const std::string &program) {
+  Zone zone;
+  SymbolTable symbols;
+  Parser parser(&zone, &symbols);
+  flora::ast::TranslationUnit *unit =
+      parser.Parse(program.data(), program.size());
+  flora::ParseStatistics statistics = parser.statistics();
+  FlatAst flat;
+  const std::size_t kPasses = 20;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < kPasses; i++)
+    flora::flat::Flatten(unit, program, &flat);
+  Report("flatten", kPasses, Seconds(start), "nodes", flat.size());
+  std::printf("%-28s %10.1f MB  (pointer tree %.1f MB)\n", "flat tree",
+              flat.ByteSize() / (1024.0 * 1024),
+              statistics.zone_bytes / (1024.0 * 1024));
+  std::size_t flat_total = 0, pointer_total = 0;
+  start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < kPasses; i++) {
+    VariableLengths pass(&flat);
+    pass.VisitAll();
+    flat_total += pass.total;
+  }
+  Report("pass over flat tree", kPasses, Seconds(start), "name bytes",
+         flat_total / kPasses);
+  start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < kPasses; i++)
+    pointer_total += PointerVariableLengths(unit);
+  Report("pass over pointer tree", kPasses, Seconds(start), "name bytes",
+         pointer_total / kPasses);
+}
+
+// Spreads single character edits over the program, each undone by the next.
+// The tree is not read, so the shifts after the edits stay pending.
+void BenchReparse(std::string program, bool replace) {
+  SymbolTable symbols;
+  IncrementalParser parser(&symbols);
+  parser.Parse(program.data(), program.size());
+  const std::size_t kEdits = 1000;
+  std::size_t functions = 0;
+  auto start = std::chrono::steady_clock::now();
+  for (std::size_t i = 0; i < kEdits; i++) {
+    // The 3 of some method, or the space before it
+    std::size_t offset = program.find("* 3", program.size() * i / kEdits);
+    if (offset == std::string::npos) offset = program.find("* 3");
+    offset += replace ? 2 : 1;
+    TextEdit edit = { offset, 1, replace ? 1u : 0u };
+    TextEdit undo = { offset, edit.inserted, 1 };
+    if (replace) {
+      program[offset] = '4';
+    } else {
+      program.erase(offset, 1);
+    }
+    parser.Reparse(program.data(), program.size(), edit);
+    if (parser.reparsed()) functions++;
+    if (replace) {
+      program[offset] = '3';
+    } else {
+      program.insert(offset, 1, ' ');
+    }
+    parser.Reparse(program.data(), program.size(), undo);
+    if (parser.reparsed()) functions++;
+  }
+  Report(replace ? "reparse (replace)" : "reparse (delete, insert)",
+         2 * kEdits, Seconds(start), "functions reparsed", functions);
+}
+
+}
+
+int main() {
+  std::string program = GenerateProgram();
+  std::printf("%zu lines, %zu bytes\n", kLines, program.size());
+  BenchFullParse(program);
+  BenchFlatAst(program);
+  BenchReparse(program, true);
+  BenchReparse(program, false);
+  return 0;
+}
@@ -0,0 +1,666 @@
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "../../src/ast.h"
+#include "../../src/flat-ast.h"
+#include "../../src/incremental-parser.h"
+#include "../../src/parser.h"
+#include "../../src/symbol-table.h"
+#include "../../src/zone.h"
+
+using flora::IncrementalParser;
+using flora::Parser;
+using flora::StringSpan;
+using flora::Symbol;
+using flora::ZoneSpan;
+using flora::SymbolTable;
+using flora::TextEdit;
+using flora::Token;
+using flora::Tokens;
+using flora::Zone;
+using flora::flat::FlatAst;
+using flora::flat::FlatAstVisitor;
+using flora::flat::NodeIndex;
+using namespace flora::ast;
+
+// Prints an expression as an S-expression, for comparing shapes
+std::string Print(Expression *expr) {
+  switch (expr->type()) {
+  case NodeType::Literal:
+    return static_cast<Literal*>(expr)->literal().ToString();
+  case NodeType::Variable:
+    return static_cast<Variable*>(expr)->name().ToString();
+  case NodeType::UnaryOperation: {
+    auto *unary = static_cast<UnaryOperation*>(expr);
+    return std::string("(") + (unary->is_postfix() ? "post" : "") +
+        Tokens::Literal(unary->op()) + " " + Print(unary->operand()) + ")";
+  }
+  case NodeType::ArithmeticOperation: {
+    auto *binary = static_cast<ArithmeticOperation*>(expr);
+    return std::string("(") + Tokens::Literal(binary->op()) + " " +
+        Print(binary->left()) + " " + Print(binary->right()) + ")";
+  }
+  case NodeType::CompareOperation: {
+    auto *compare = static_cast<CompareOperation*>(expr);
+    return std::string("(") + Tokens::Literal(compare->op()) + " " +
+        Print(compare->left()) + " " + Print(compare->right()) + ")";
+  }
+  case NodeType::AssignmentOperation: {
+    auto *assignment = static_cast<AssignmentOperation*>(expr);
+    return std::string("(") + Tokens::Literal(assignment->op()) + " " +
+        Print(assignment->target()) + " " + Print(assignment->value()) + ")";
+  }
+  case NodeType::Conditional: {
+    auto *conditional = static_cast<Conditional*>(expr);
+    return "(? " + Print(conditional->condition()) + " " +
+        Print(conditional->then_expression()) + " " +
+        Print(conditional->else_expression()) + ")";
+  }
+  case NodeType::Invoke: {
+    auto *invoke = static_cast<Invoke*>(expr);
+    std::string result = "(call " + Print(invoke->callee());
+    for (Expression *argument : invoke->arguments())
+      result += " " + Print(argument);
+    return result + ")";
+  }
+  case NodeType::Index: {
+    auto *index = static_cast<Index*>(expr);
+    return "(index " + Print(index->object()) + " " +
+        Print(index->index()) + ")";
+  }
+  case NodeType::MemberAccess: {
+    auto *access = static_cast<MemberAccess*>(expr);
+    return "(. " + Print(access->object()) + " " +
+        access->name().ToString() + ")";
+  }
+  case NodeType::Tuple:
+  case NodeType::ArrayLiteral: {
+    ZoneSpan<Expression*> elements = expr->IsTuple() ?
+        static_cast<Tuple*>(expr)->elements() :
+        static_cast<ArrayLiteral*>(expr)->elements();
+    std::string result = expr->IsTuple() ? "(tuple" : "(array";
+    for (Expression *element : elements) result += " " + Print(element);
+    return result + ")";
+  }
+  case NodeType::Conversion: {
+    auto *conversion = static_cast<Conversion*>(expr);
+    return "(" + conversion->type_specifier()->name().ToString() + " " +
+        Print(conversion->expression()) + ")";
+  }
+  case NodeType::Lambda: {
+    auto *lambda = static_cast<Lambda*>(expr);
+    std::string result = "(lambda";
+    for (VariableDeclaration *parameter : lambda->parameters())
+      result += " " + parameter->name().ToString();
+    if (lambda->body()->IsExpressionStatement()) {
+      result += " " + Print(static_cast<ExpressionStatement*>(
+          lambda->body())->expression());
+    }
+    return result + ")";
+  }
+  default:
+    return "?";
+  }
+}
+
+// Parses the expression as the initializer of a variable
+Expression* ParseInitializer(Parser *parser, const std::string &source) {
+  TranslationUnit *unit = parser->Parse(source.data(), source.size());
+  if (!unit || unit->declarations().size() != 1 ||
+      !unit->declarations()[0]->IsVariableDeclaration())
+    return nullptr;
+  return static_cast<VariableDeclaration*>(
+      unit->declarations()[0])->initializer();
+}
+
+// Returns true if the expressions parse into the expected shapes
+bool CheckExpressions() {
+  struct {
+    const char *source;
+    const char *expected;
+  } cases[] = {
+    { "a + b * c", "(+ a (* b c))" },
+    { "a - b - c", "(- (- a b) c)" },
+    { "a * b / c % d", "(% (/ (* a b) c) d)" },
+    { "a = b += c", "(= a (+= b c))" },
+    { "a || b && c | d ^ e & f", "(|| a (&& b (| c (^ d (& e f)))))" },
+    { "a << 1 < b + 1 == c", "(== (< (<< a 1) (+ b 1)) c)" },
+    { "-a.b++ * !c[1]", "(* (- (post++ (. a b))) (! (index c 1)))" },
+    { "a ? b : c ? d : e", "(? a b (? c d e))" },
+    { "a = b ? c = d : e", "(= a (? b (= c d) e))" },
+    { "f(a, b + 1)(c)()", "(call (call (call f a (+ b 1)) c))" },
+    { "(a + b) * c", "(* (+ a b) c)" },
+    { "(a, (b), [c, []])", "(tuple a b (array c (array)))" },
+    { "(int) a + b", "(+ (int a) b)" },
+    { "(int a, List<T> b) => a + b", "(lambda a b (+ a b))" },
+    { "() => (x) + 1", "(lambda (+ x 1))" },
+  };
+  for (const auto &test : cases) {
+    Zone zone;
+    SymbolTable symbols;
+    Parser parser(&zone, &symbols);
+    std::string source = std::string("int x = ") + test.source + ";";
+    Expression *expr = ParseInitializer(&parser, source);
+    std::string printed = expr ? Print(expr) : parser.error_message();
+    if (printed != test.expected) {
+      std::cout << test.source << ": " << printed << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if number literals keep the values the scanner converted
+bool CheckNumberLiterals() {
+  struct {
+    const char *source;
+    Token type;
+    std::uint64_t integer;
+  } cases[] = {
+    { "42", Token::Int, 42 },
+    { "0b101", Token::Int, 5 },
+    { "0xFFFFFFFF", Token::Unsigned, 0xFFFFFFFFu },
+    { "4294967296", Token::Long, 4294967296u },
+    { "'a'", Token::Illegal, 0 },
+  };
+  Zone zone;
+  SymbolTable symbols;
+  Parser parser(&zone, &symbols);
+  for (const auto &test : cases) {
+    std::string source = std::string("int x = ") + test.source + ";";
+    Expression *expr = ParseInitializer(&parser, source);
+    if (!expr || !expr->IsLiteral()) return false;
+    flora::NumberLiteral number = static_cast<Literal*>(expr)->number();
+    if (number.type != test.type || number.integer != test.integer) {
+      std::cout << test.source << ": " << number.integer << std::endl;
+      return false;
+    }
+  }
+  Expression *expr = ParseInitializer(&parser, "int x = 1.5e3;");
+  return expr && expr->IsLiteral() &&
+      static_cast<Literal*>(expr)->number().type == Token::Double &&
+      static_cast<Literal*>(expr)->number().real == 1500.0;
+}
+
+// Returns true if a million operands in a chain and in nested parentheses
+// parse without running out of stack
+bool CheckLongExpressions() {
+  const int kOperands = 1000000;
+  std::string chain = "int x = a";
+  for (int i = 1; i < kOperands; i++) chain += " + a";
+  chain += ";";
+  std::string assignments = "int x = ";
+  for (int i = 1; i < kOperands; i++) assignments += "a = ";
+  assignments += "a;";
+  std::string nested = "int x = " + std::string(kOperands, '(') + "a" +
+      std::string(kOperands, ')') + ";";
+  Zone zone;
+  SymbolTable symbols;
+  Parser parser(&zone, &symbols);
+  // The operations lean to the left
+  Expression *expr = ParseInitializer(&parser, chain);
+  int depth = 0;
+  while (expr && expr->IsArithmeticOperation()) {
+    expr = static_cast<ArithmeticOperation*>(expr)->left();
+    depth++;
+  }
+  if (depth != kOperands - 1) return false;
+  // Assignments lean to the right
+  expr = ParseInitializer(&parser, assignments);
+  depth = 0;
+  while (expr && expr->IsAssignmentOperation()) {
+    expr = static_cast<AssignmentOperation*>(expr)->value();
+    depth++;
+  }
+  if (depth != kOperands - 1) return false;
+  expr = ParseInitializer(&parser, nested);
+  return expr && expr->IsVariable();
+}
+
+// Returns true if a program of every declaration and statement parses
+bool CheckProgram() {
+  const char *source =
+      "import std.io as io;\n"
+      "namespace geometry {\n"
+      "  const double pi = 3.14159;\n"
+      "  class Circle < Shape {\n"
+      "    public double radius;\n"
+      "    public static Circle unit() { return new_circle(1.0); }\n"
+      "    private double area() { return pi * radius * radius; }\n"
+      "  }\n"
+      "}\n"
+      "int main(List<string> arguments) {\n"
+      "  int total = 0;\n"
+      "  const limit = 10;\n"
+      "  for (int i = 0; i < limit; i++) {\n"
+      "    if (i % 2 == 0) continue; else total += i;\n"
+      "  }\n"
+      "  while (total > 100) total -= 1;\n"
+      "  do { total++; } while (false);\n"
+      "  switch (total) {\n"
+      "  case 1: break;\n"
+      "  default: total = 0;\n"
+      "  }\n"
+      "  Callback cb = (int x) => { return x * 2; };\n"
+      "  geometry.Circle c = geometry.Circle.unit();\n"
+      "  io.print(\"total: \\\"\" + total);\n"
+      "  return total;\n"
+      "}\n";
+  Zone zone;
+  SymbolTable symbols;
+  Parser parser(&zone, &symbols);
+  TranslationUnit *unit = parser.Parse(source, std::strlen(source));
+  if (!unit) {
+    std::cout << parser.error_message() << " at "
+              << parser.error_position() << std::endl;
+    return false;
+  }
+  if (unit->declarations().size() != 3) return false;
+  // Declarations are found in their scopes by symbol
+  auto *main = static_cast<FunctionDeclaration*>(unit->declarations()[2]);
+  if (unit->scope()->LookupLocal(symbols.Lookup("main")) != main)
+    return false;
+  auto *geometry =
+      static_cast<NamespaceDeclaration*>(unit->declarations()[1]);
+  auto *circle =
+      static_cast<ClassDeclaration*>(geometry->declarations()[1]);
+  if (circle->members().size() != 3 || !circle->members()[1]->is_static() ||
+      circle->members()[2]->visibility() != MemberVisibility::Private)
+    return false;
+  if (main->body()->statements().size() != 10) return false;
+  // References carry the symbols of their declarations, so they resolve
+  // by comparing integers
+  ZoneSpan<Statement*> statements = main->body()->statements();
+  Declaration *total =
+      static_cast<DeclarationStatement*>(statements[0])->declaration();
+  auto *returned = static_cast<Variable*>(
+      static_cast<ReturnStatement*>(statements[9])->value());
+  auto *c = static_cast<VariableDeclaration*>(
+      static_cast<DeclarationStatement*>(statements[7])->declaration());
+  auto *access = static_cast<MemberAccess*>(
+      static_cast<Invoke*>(c->initializer())->callee());
+  if (returned->symbol() != total->symbol() ||
+      main->body()->scope()->Lookup(returned->symbol()) != total ||
+      access->symbol() != circle->members()[1]->symbol())
+    return false;
+  // The statistics are those of one parse, not of the whole zone
+  flora::ParseStatistics first = parser.statistics();
+  if (!parser.Parse(source, std::strlen(source))) return false;
+  flora::ParseStatistics second = parser.statistics();
+  return second.node_count == 112 && first.node_count == second.node_count &&
+      first.zone_bytes == second.zone_bytes;
+}
+
+// Prints a type specifier with its arguments, such as A<B,C<D>>
+std::string PrintType(TypeSpecifier *type) {
+  std::string result = type->name().ToString();
+  if (type->arguments().empty()) return result;
+  for (std::size_t i = 0; i < type->arguments().size(); i++)
+    result += (i == 0 ? "<" : ",") + PrintType(type->arguments()[i]);
+  return result + ">";
+}
+
+// Returns true if type arguments closed by '>>' and '>>>' nest, both for
+// global and for local variables, and shifts are still shifts
+bool CheckNestedTypeArguments() {
+  const char *types[] = {
+    "A<B<C>>", "A<B<C<D>>>", "A<B<C>, D<E<F>>>", "A<B<C> >"
+  };
+  for (const char *type : types) {
+    std::string expected = type;
+    expected.erase(std::remove(expected.begin(), expected.end(), ' '),
+                   expected.end());
+    std::string source = std::string(type) + " x = null;\n"
+        "int f() { " + type + " y = null; x < y >> 1; }\n";
+    Zone zone;
+    SymbolTable symbols;
+    Parser parser(&zone, &symbols);
+    TranslationUnit *unit = parser.Parse(source.data(), source.size());
+    if (!unit) {
+      std::cout << source << parser.error_message() << " at "
+                << parser.error_position() << std::endl;
+      return false;
+    }
+    auto *global = static_cast<VariableDeclaration*>(
+        unit->declarations()[0]);
+    auto *f = static_cast<FunctionDeclaration*>(unit->declarations()[1]);
+    ZoneSpan<Statement*> statements = f->body()->statements();
+    if (statements.size() != 2 || !statements[0]->IsDeclarationStatement())
+      return false;
+    auto *local = static_cast<VariableDeclaration*>(
+        static_cast<DeclarationStatement*>(statements[0])->declaration());
+    // Looking for a declaration split the '>>', and rewinding undid it
+    auto *value =
+        static_cast<ExpressionStatement*>(statements[1])->expression();
+    if (PrintType(global->type_specifier()) != expected ||
+        PrintType(local->type_specifier()) != expected ||
+        Print(value) != "(< x (>> y 1))")
+      return false;
+  }
+  return true;
+}
+
+// Returns true if pre-parsed bodies record their names, and parse into
+// the same trees as eagerly parsed ones once they are needed
+bool CheckLazyFunctions() {
+  const char *source =
+      "int limit = 10;\n"
+      "class Counter {\n"
+      "  int next(int step) {\n"
+      "    int value = count + step;\n"
+      "    Callback f = (int x) => { return x < limit; };\n"
+      "    return this.count = value;\n"
+      "  }\n"
+      "}\n"
+      "void broken() { return 1 }\n";
+  Zone zone;
+  SymbolTable symbols;
+  Parser parser(&zone, &symbols);
+  parser.set_lazy(true);
+  TranslationUnit *unit = parser.Parse(source, std::strlen(source));
+  if (!unit) return false;
+  auto *counter = static_cast<ClassDeclaration*>(unit->declarations()[1]);
+  auto *next = static_cast<FunctionDeclaration*>(counter->members()[0]);
+  if (!next->is_lazy() || next->lazy_body()[0] != '{' ||
+      next->lazy_body()[next->lazy_body().size() - 1] != '}')
+    return false;
+  // The member after this and the parameter are left out
+  std::string names;
+  for (Symbol symbol : next->free_variables()) {
+    names += symbols.Name(symbol).ToString() + " ";
+  }
+  if (names != "limit value count Callback f x ") {
+    std::cout << names << std::endl;
+    return false;
+  }
+  Block *body = parser.ParseLazyFunction(next);
+  if (!body || next->body() != body || body->statements().size() != 3 ||
+      parser.ParseLazyFunction(next) != body)
+    return false;
+  // Syntax errors wait until the body is parsed, at their own positions
+  auto *broken = static_cast<FunctionDeclaration*>(unit->declarations()[2]);
+  if (parser.ParseLazyFunction(broken) || !broken->is_lazy() ||
+      parser.error_position() != std::strlen(source) - 2)
+    return false;
+  // Lexical errors are found by the pre-parser
+  const char *illegal = "int f() { return \"open; }";
+  return !parser.Parse(illegal, std::strlen(illegal)) &&
+      parser.error_message() == "unexpected EOF in string literal";
+}
+
+// Counts the variables and collects the names of the functions of a flat
+// tree
+class FunctionNames : public FlatAstVisitor<FunctionNames> {
+public:
+  explicit FunctionNames(const FlatAst *ast)
+      : FlatAstVisitor<FunctionNames>(ast), variables(0) { }
+
+  void VisitVariable(NodeIndex) { variables++; }
+  void VisitFunctionDeclaration(NodeIndex node) {
+    names.push_back(ast_->DeclarationName(node).ToString());
+  }
+
+  int variables;
+  std::vector<std::string> names;
+};
+
+// Returns true if the flat tree has a node for every node of the pointer
+// tree, each the child of one parent which comes after it, is smaller, and
+// a million operands in a chain flatten without running out of stack
+bool CheckFlatAst() {
+  const char *source =
+      "namespace n {\n"
+      "  class C < Base<int> {\n"
+      "    private static int f(int a, int b) {\n"
+      "      if (a < b) return a; else { a.x = [b, (a, b)]; }\n"
+      "      for (;;) break;\n"
+      "      return g(a) ? -b : b++;\n"
+      "    }\n"
+      "  }\n"
+      "}\n"
+      "int g(int x) { return x; }\n";
+  Zone zone;
+  SymbolTable symbols;
+  Parser parser(&zone, &symbols);
+  TranslationUnit *unit = parser.Parse(source, std::strlen(source));
+  if (!unit) return false;
+  FlatAst flat;
+  flora::flat::Flatten(unit, source, &flat);
+  if (flat.size() != parser.statistics().node_count ||
+      flat.ByteSize() >= parser.statistics().zone_bytes ||
+      flat.type(flat.root()) != NodeType::TranslationUnit)
+    return false;
+  std::vector<int> parents(flat.size(), 0);
+  bool ordered = true;
+  for (NodeIndex node = 0; node < flat.size(); node++) {
+    flat.ForEachChild(node, [&](NodeIndex child) {
+      parents[child]++;
+      ordered = ordered && child < node;
+    });
+  }
+  if (!ordered || parents[flat.root()] != 0 ||
+      std::count(parents.begin(), parents.end(), 1) !=
+          static_cast<std::ptrdiff_t>(flat.size() - 1))
+    return false;
+  FunctionNames visitor(&flat);
+  visitor.VisitAll();
+  if (visitor.variables != 12 || visitor.names.size() != 2 ||
+      visitor.names[0] != "f" || visitor.names[1] != "g")
+    return false;
+  // Children come in source order
+  NodeIndex f = flat.size();
+  for (NodeIndex node = 0; node < flat.size(); node++) {
+    if (flat.type(node) == NodeType::FunctionDeclaration) {
+      f = node;
+      break;
+    }
+  }
+  std::vector<NodeIndex> children;
+  flat.ForEachChild(f, [&](NodeIndex child) { children.push_back(child); });
+  if (flat.DeclarationFlags(f) !=
+          (static_cast<std::uint32_t>(MemberVisibility::Private) |
+           FlatAst::kStaticFlag) ||
+      children.size() != 4 || flat.DeclarationName(children[1]) != "b" ||
+      flat.type(children[2]) != NodeType::TypeSpecifier ||
+      flat.type(children[3]) != NodeType::Block)
+    return false;
+  // The chain leans to the left, one operation per operand after the first
+  const int kOperands = 1000000;
+  std::string chain = "int x = a";
+  for (int i = 1; i < kOperands; i++) chain += " + a";
+  chain += ";";
+  unit = parser.Parse(chain.data(), chain.size());
+  if (!unit) return false;
+  flora::flat::Flatten(unit, chain, &flat);
+  return flat.size() == 2 * kOperands + 2 &&
+      flat.type(flat.size() - 3) == NodeType::ArithmeticOperation &&
+      flat.type(flat.lhs(flat.size() - 3)) == NodeType::ArithmeticOperation;
+}
+
+// Returns true if the incremental tree of the source is the tree a full
+// parse makes, or both find a syntax error
+bool SameAsFullParse(TranslationUnit *unit, const std::string &source) {
+  Zone zone;
+  SymbolTable symbols;
+  Parser parser(&zone, &symbols);
+  TranslationUnit *expected = parser.Parse(source.data(), source.size());
+  if (!unit || !expected) return !unit && !expected;
+  return flora::flat::SameTree(unit, expected, source);
+}
+
+// Returns true if reparsing after edits gives the trees of full parses,
+// and an edit inside a function replaces only the function
+bool CheckIncrementalParser() {
+  const std::string program =
+      "import std.io;\n"
+      "const int limit = 10;\n"
+      "namespace shapes {\n"
+      "  class Square < Shape {\n"
+      "    public double side;\n"
+      "    public static double area(double side) { return side * side; }\n"
+      "    private int sides() {\n"
+      "      for (int i = 0; i < 4; i++) { if (i > limit) break; }\n"
+      "      return \"\\tfour\" == \"four\" ? 4 : [1, 2][0];\n"
+      "    }\n"
+      "  }\n"
+      "  int count = 1 + 2;\n"
+      "}\n"
+      "int main() { io.print(shapes.Square.area(2.0)); return 0; }\n";
+  SymbolTable symbols;
+  IncrementalParser incremental(&symbols);
+  TranslationUnit *unit =
+      incremental.Parse(program.data(), program.size());
+  auto *shapes = static_cast<NamespaceDeclaration*>(unit->declarations()[2]);
+  auto *square = static_cast<ClassDeclaration*>(shapes->declarations()[0]);
+  Declaration *side = square->members()[0];
+  Declaration *main = unit->declarations()[3];
+  // Change 4 into 40 in sides(), the source may move
+  std::string source = program;
+  std::size_t offset = source.find("< 4") + 2;
+  source.replace(offset, 1, "40");
+  if (!incremental.Reparse(source.data(), source.size(),
+                           TextEdit { offset, 1, 2 }))
+    return false;
+  unit = incremental.unit();
+  if (!SameAsFullParse(unit, source)) return false;
+  // Trees which differ only in a name are not the same
+  Zone zone;
+  Parser parser(&zone, &symbols);
+  TranslationUnit *renamed = parser.Parse(source.data(), source.size());
+  auto *renamed_shapes =
+      static_cast<NamespaceDeclaration*>(renamed->declarations()[2]);
+  static_cast<ClassDeclaration*>(renamed_shapes->declarations()[0])
+      ->members()[0]->set_name(
+          StringSpan(source.data() + source.find("area"), 4));
+  if (flora::flat::SameTree(unit, renamed, source)) return false;
+  Declaration *sides = square->members()[2];
+  if (incremental.reparsed() != sides || square->bases().size() != 1 ||
+      square->members()[0] != side ||
+      unit->declarations()[3] != main ||
+      square->scope()->LookupLocal(symbols.Lookup("sides")) != sides ||
+      sides->is_static() || sides->visibility() != MemberVisibility::Private)
+    return false;
+  // Random edits, each undone by the next. The tree is read after every
+  // third pair, so that the shifts of several edits are pending.
+  std::mt19937 random(20161018);
+  const char *insertions[] = {
+    "", "1", "x", " ", ";", "}", "{", "int y = 2;", "\n", "\"", "/*"
+  };
+  std::uniform_int_distribution<std::size_t> pick_insertion(
+      0, sizeof(insertions) / sizeof(const char*) - 1);
+  for (int i = 0; i < 2000; i++) {
+    std::uniform_int_distribution<std::size_t> pick_offset(0, source.size());
+    std::size_t offset = pick_offset(random);
+    std::uniform_int_distribution<std::size_t> pick_removed(
+        0, std::min<std::size_t>(3, source.size() - offset));
+    std::size_t removed = pick_removed(random);
+    std::string old_text = source.substr(offset, removed);
+    std::string inserted = insertions[pick_insertion(random)];
+    source.replace(offset, removed, inserted);
+    incremental.Reparse(source.data(), source.size(),
+                        TextEdit { offset, removed, inserted.size() });
+    if (i % 3 == 0 && !SameAsFullParse(incremental.unit(), source)) {
+      std::cout << source << std::endl;
+      return false;
+    }
+    source.replace(offset, inserted.size(), old_text);
+    incremental.Reparse(source.data(), source.size(),
+                        TextEdit { offset, inserted.size(), removed });
+    if (i % 3 == 2 && !SameAsFullParse(incremental.unit(), source)) {
+      std::cout << source << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if syntax errors are reported at the offending token
+bool CheckErrors() {
+  struct {
+    const char *source;
+    const char *message;
+    std::uint32_t position;
+  } cases[] = {
+    { "int x = (a + b;", "expected ')' instead of ';'", 14 },
+    { "int x = a +;", "expected an expression", 11 },
+    { "int x = a ? b;", "expected ':' instead of ';'", 13 },
+    { "int f() { return 1 }", "expected ';' instead of '}'", 19 },
+    { "int x = \"open", "unexpected EOF in string literal", 8 },
+  };
+  for (const auto &test : cases) {
+    Zone zone;
+    SymbolTable symbols;
+    Parser parser(&zone, &symbols);
+    if (parser.Parse(test.source, std::strlen(test.source)) ||
+        parser.error_message() != test.message ||
+        parser.error_position() != test.position) {
+      std::cout << test.source << ": " << parser.error_message() << " at "
+                << parser.error_position() << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char const *argv[]) {
+  int result = 0;
+  if (CheckExpressions()) {
+    std::cout << "Expressions match" << std::endl;
+  } else {
+    std::cout << "Expressions mismatch" << std::endl;
+    result = 1;
+  }
+  if (CheckNumberLiterals()) {
+    std::cout << "Number literals match" << std::endl;
+  } else {
+    std::cout << "Number literals mismatch" << std::endl;
+    result = 1;
+  }
+  if (CheckLongExpressions()) {
+    std::cout << "Long expressions match" << std::endl;
+  } else {
+    std::cout << "Long expressions mismatch" << std::endl;
+    result = 1;
+  }
+  if (CheckProgram()) {
+    std::cout << "Program matches" << std::endl;
+  } else {
+    std::cout << "Program mismatches" << std::endl;
+    result = 1;
+  }
+  if (CheckNestedTypeArguments()) {
+    std::cout << "Nested type arguments match" << std::endl;
+  } else {
+    std::cout << "Nested type arguments mismatch" << std::endl;
+    result = 1;
+  }
+  if (CheckLazyFunctions()) {
+    std::cout << "Lazy functions match" << std::endl;
+  } else {
+    std::cout << "Lazy functions mismatch" << std::endl;
+    result = 1;
+  }
+  if (CheckFlatAst()) {
+    std::cout << "Flat AST matches" << std::endl;
+  } else {
+    std::cout << "Flat AST mismatches" << std::endl;
+    result = 1;
+  }
+  if (CheckIncrementalParser()) {
+    std::cout << "Incremental parser matches" << std::endl;
+  } else {
+    std::cout << "Incremental parser mismatches" << std::endl;
+    result = 1;
+  }
+  if (CheckErrors()) {
+    std::cout << "Errors match" << std::endl;
+  } else {
+    std::cout << "Errors mismatch" << std::endl;
+    result = 1;
+  }
+  return result;
+}
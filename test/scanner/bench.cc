@@ -0,0 +1,405 @@
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include "../../src/character-search.h"
+#include "../../src/character-stream.h"
+#include "../../src/incremental-tokenizer.h"
+#include "../../src/line-table.h"
+#include "../../src/parallel-tokenizer.h"
+#include "../../src/scanner.h"
+#include "../../src/symbol-table.h"
+#include "../../src/token-buffer.h"
+#include "../../src/utf8.h"
+
+using flora::CharacterStream;
+using flora::FileCharacterStream;
+using flora::IncrementalTokenizer;
+using flora::LineTable;
+using flora::MappedFileCharacterStream;
+using flora::ParallelTokenizer;
+using flora::Scanner;
+using flora::SymbolTable;
+using flora::TextEdit;
+using flora::Token;
+using flora::TokenBuffer;
+
+namespace {
+
+const char *kGeneratedInput = "bench_input.tmp";
+const char *kSearchInput = "bench_search.tmp";
+const std::size_t kGeneratedSize = 32 * 1024 * 1024;
+
+// Replicates the all-tokens test case until it reaches kGeneratedSize bytes
+void GenerateInput(const char *filename) {
+  std::ifstream in("test_case_all_tokens.txt");
+  std::stringstream content;
+  content << in.rdbuf();
+  std::string chunk = content.str();
+  std::ofstream out(filename);
+  for (std::size_t size = 0; size < kGeneratedSize; size += chunk.size())
+    out << chunk;
+}
+
+// Writes sources dominated by license headers and doc comments
+void GenerateCommentHeavyInput(const char *filename) {
+  std::string chunk =
+      "/*\n"
+      " * Copyright (c) Flora contributors\n"
+      " *\n"
+      " * Permission is hereby granted, free of charge, to any person obtaining\n"
+      " * a copy of this software and associated documentation files, to deal\n"
+      " * in the Software without restriction, including without limitation\n"
+      " * the rights to use, copy, modify, merge, publish, distribute, and/or\n"
+      " * sell copies of the Software, subject to the following conditions.\n"
+      " */\n"
+      "\n"
+      "        // Returns the sum of the two operands. The operands are not\n"
+      "        // checked for overflow, callers must ensure they fit in int.\n"
+      "        int add(int a, int b) {\n"
+      "            /* nested /* doc */ comment */\n"
+      "            return a + b;\n"
+      "        }\n"
+      "\n";
+  std::ofstream out(filename);
+  for (std::size_t size = 0; size < kGeneratedSize; size += chunk.size())
+    out << chunk;
+}
+
+// Writes tables of string literals like those embedded in configurations
+void GenerateStringHeavyInput(const char *filename) {
+  std::string chunk =
+      "{ \"name\": \"flora-config\", \"description\": \"Settings for the "
+      "build of the standard library and its tests\",\n"
+      "  \"path\": \"/usr/local/share/flora/lib\", \"greeting\": "
+      "\"Hello, world! Welcome to the flora language.\",\n"
+      "  \"pattern\": \"[a-z]+\\\\.flora\", \"message\": \"line one\\nline "
+      "two\\t\\\"quoted\\\"\" }\n";
+  std::ofstream out(filename);
+  for (std::size_t size = 0; size < kGeneratedSize; size += chunk.size())
+    out << chunk;
+}
+
+// Writes identifier-heavy sources, either ASCII or with Unicode identifiers
+void GenerateIdentifierHeavyInput(const char *filename, bool unicode) {
+  std::string chunk = unicode ?
+      "变量 = größe_max + αβγ_δ * ñandú_count - 数组索引[i] + x\n"
+      "résumé_entry = Привет_мир + counter_значение / π2\n" :
+      "variable = maximum_size + alpha_beta_gamma * nandu_count - index[i]\n"
+      "resume_entry = hello_world + counter_value / pi2 + some_longer_name\n";
+  std::ofstream out(filename);
+  for (std::size_t size = 0; size < kGeneratedSize; size += chunk.size())
+    out << chunk;
+}
+
+// Writes a data file of integers and reals
+void GenerateNumberHeavyInput(const char *filename) {
+  std::string chunk =
+      "[3.14159, 2.71828, 1234567890123, 0.000125, 6.02214076e23, 42,\n"
+      " 0xDEADBEEF, 299792458, 1.602176634e-19, 65535, 0.5, 17]\n";
+  std::ofstream out(filename);
+  for (std::size_t size = 0; size < kGeneratedSize; size += chunk.size())
+    out << chunk;
+}
+
+// Writes expressions made mostly of operators and punctuation marks
+void GenerateOperatorHeavyInput(const char *filename) {
+  std::string chunk =
+      "a<<=b>>=c;d+=e++-f--*g/=h%i;j=k<=l>=m!=n==o&&p||!q;\n"
+      "r|=s^t&u&=v|w^=x<<y>>z;(...a)=>{b[c]?d:e.f;};g-=~h;\n";
+  std::ofstream out(filename);
+  for (std::size_t size = 0; size < kGeneratedSize; size += chunk.size())
+    out << chunk;
+}
+
+double Seconds(std::chrono::steady_clock::time_point start) {
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  return elapsed.count();
+}
+
+void Report(const char *name, std::size_t bytes, double seconds,
+            const char *counter, unsigned long count) {
+  std::printf("%-28s %10.1f MB/s  (%zu bytes, %s %lu)\n", name,
+              bytes / seconds / (1024 * 1024), bytes, counter, count);
+}
+
+// Reads every character through the virtual CharacterStream interface
+void BenchVirtualStream(const char *name, CharacterStream *stream) {
+  auto start = std::chrono::steady_clock::now();
+  std::size_t bytes = 0;
+  unsigned long checksum = 0;
+  for (char32_t ch; (ch = stream->Advance()) != flora::character::EOS; ) {
+    checksum += ch;
+    bytes++;
+  }
+  Report(name, bytes, Seconds(start), "checksum", checksum);
+}
+
+// Walks the mapped buffer with a pointer
+void BenchMappedBuffer(const char *filename) {
+  auto start = std::chrono::steady_clock::now();
+  MappedFileCharacterStream stream(filename);
+  unsigned long checksum = 0;
+  for (const char *p = stream.begin(); p != stream.end(); p++)
+    checksum += static_cast<unsigned char>(*p);
+  Report("mapped buffer (pointer)", stream.size(), Seconds(start),
+         "checksum", checksum);
+}
+
+// Scans all tokens, returns the number of tokens
+std::size_t ScanAll(Scanner *scanner) {
+  std::size_t tokens = 0;
+  while (true) {
+    Token tok = scanner->Advance();
+    if (tok == Token::EndOfSource || tok == Token::Illegal)
+      break;
+    tokens++;
+  }
+  return tokens;
+}
+
+// Scanner fed by the virtual CharacterStream interface
+void BenchScannerOverStream(const char *filename, std::size_t bytes) {
+  auto start = std::chrono::steady_clock::now();
+  FileCharacterStream stream(filename);
+  Scanner scanner;
+  scanner.Initialize(&stream);
+  std::size_t tokens = ScanAll(&scanner);
+  Report("scanner (virtual stream)", bytes, Seconds(start), "tokens", tokens);
+}
+
+// Scanner walking the mapped buffer directly
+void BenchScannerOverBuffer(const char *filename) {
+  auto start = std::chrono::steady_clock::now();
+  MappedFileCharacterStream stream(filename);
+  Scanner scanner;
+  scanner.Initialize(stream.begin(), stream.size());
+  std::size_t tokens = ScanAll(&scanner);
+  Report("scanner (mapped buffer)", stream.size(), Seconds(start),
+         "tokens", tokens);
+}
+
+// Batch tokenization into a TokenBuffer, then a second pass over the kinds
+void BenchTokenizeAll(const char *filename) {
+  auto start = std::chrono::steady_clock::now();
+  MappedFileCharacterStream stream(filename);
+  Scanner scanner;
+  scanner.Initialize(stream.begin(), stream.size());
+  TokenBuffer tokens;
+  scanner.TokenizeAll(&tokens);
+  Report("scanner (TokenizeAll)", stream.size(), Seconds(start),
+         "tokens", tokens.size());
+  start = std::chrono::steady_clock::now();
+  unsigned long identifiers = 0;
+  tokens.ForEachRun([&](const std::uint8_t *kinds, std::size_t count) {
+    for (std::size_t i = 0; i < count; i++)
+      identifiers += kinds[i] == static_cast<std::uint8_t>(Token::Identifier);
+  });
+  Report("token buffer (second pass)", stream.size(), Seconds(start),
+         "identifiers", identifiers);
+}
+
+// Builds the line index and locates every token
+void BenchLineTable(const char *filename) {
+  MappedFileCharacterStream stream(filename);
+  Scanner scanner;
+  scanner.Initialize(stream.begin(), stream.size());
+  TokenBuffer tokens;
+  scanner.TokenizeAll(&tokens);
+  auto start = std::chrono::steady_clock::now();
+  LineTable lines(scanner.GetSource());
+  std::size_t count = lines.LineCount();
+  Report("line table (build)", stream.size(), Seconds(start), "lines", count);
+  start = std::chrono::steady_clock::now();
+  unsigned long checksum = 0;
+  for (std::size_t i = 0; i < tokens.size(); i++)
+    checksum += lines.Locate(tokens.offset(i)).column;
+  Report("line table (locate all)", stream.size(), Seconds(start),
+         "checksum", checksum);
+}
+
+// Tokenizes the same input with 1, 2, 4 and 8 threads
+void BenchParallelTokenizer(const char *filename) {
+  MappedFileCharacterStream stream(filename);
+  for (unsigned threads = 1; threads <= 8; threads *= 2) {
+    auto start = std::chrono::steady_clock::now();
+    ParallelTokenizer tokenizer(threads);
+    TokenBuffer tokens;
+    tokenizer.Tokenize(stream.begin(), stream.size(), &tokens);
+    std::string title =
+        "tokenizer (" + std::to_string(threads) + " threads)";
+    Report(title.c_str(), stream.size(), Seconds(start),
+           "tokens", tokens.size());
+  }
+}
+
+// Relexes after one-character edits spread over prefixes of the input of
+// growing size. An edit should cost the same whatever the size.
+void BenchIncrementalTokenizer(const char *filename) {
+  MappedFileCharacterStream stream(filename);
+  for (std::size_t part = 64; part >= 1; part /= 8) {
+    // Cut at a line feed, so that the prefix ends between tokens
+    std::string source(stream.begin(), stream.size() / part);
+    source.resize(source.rfind('\n') + 1);
+    Scanner scanner;
+    scanner.Initialize(source.data(), source.size());
+    TokenBuffer tokens;
+    scanner.TokenizeAll(&tokens);
+    IncrementalTokenizer tokenizer;
+    const std::size_t kEdits = 100;
+    std::size_t relexed = 0;
+    // Only the relexing is timed, not the edits of the string
+    double seconds = 0;
+    auto relex = [&](const TextEdit &edit) {
+      auto start = std::chrono::steady_clock::now();
+      relexed += tokenizer.Relex(source.data(), source.size(), edit,
+                                 &tokens).inserted;
+      seconds += Seconds(start);
+    };
+    for (std::size_t i = 0; i < kEdits; i++) {
+      // Insert a space before some token, then remove it again
+      std::size_t offset = tokens.offset(tokens.size() * i / kEdits);
+      source.insert(offset, 1, ' ');
+      relex(TextEdit { offset, 0, 1 });
+      source.erase(offset, 1);
+      relex(TextEdit { offset, 1, 0 });
+    }
+    std::printf("incremental (%8zu tokens) %10.2f us/edit (%zu edits, "
+                "relexed tokens %zu)\n", tokens.size(),
+                seconds * 1e6 / (2 * kEdits), 2 * kEdits, relexed);
+  }
+}
+
+// Scans an input with each available search kernel
+void BenchSearchKernels(const char *filename, const char *kind) {
+  const char *names[] = { "scalar", "sse2", "avx2" };
+  MappedFileCharacterStream stream(filename);
+  for (const char *name : names) {
+    if (!flora::character::SelectSearchKernels(name)) continue;
+    auto start = std::chrono::steady_clock::now();
+    Scanner scanner;
+    scanner.Initialize(stream.begin(), stream.size());
+    std::size_t tokens = ScanAll(&scanner);
+    std::string title = std::string(kind) + " (" + name + ")";
+    Report(title.c_str(), stream.size(), Seconds(start), "tokens", tokens);
+  }
+}
+
+// Values converted while scanning, against converting the literals after
+void BenchNumbers() {
+  GenerateNumberHeavyInput(kGeneratedInput);
+  MappedFileCharacterStream stream(kGeneratedInput);
+  for (int pass = 0; pass < 2; pass++) {
+    auto start = std::chrono::steady_clock::now();
+    Scanner scanner;
+    scanner.Initialize(stream.begin(), stream.size());
+    double sum = 0;
+    std::size_t numbers = 0;
+    while (true) {
+      Token tok = scanner.Advance();
+      if (tok == Token::EndOfSource || tok == Token::Illegal)
+        break;
+      if (tok != Token::Integer && tok != Token::RealNumber)
+        continue;
+      numbers++;
+      if (pass == 0) {
+        flora::NumberLiteral number = scanner.GetTokenNumber();
+        sum += tok == Token::Integer ? number.integer : number.real;
+      } else {
+        // What consumers had to do before
+        std::string literal = scanner.GetTokenLiteral().ToString();
+        sum += tok == Token::Integer ? std::stoull(literal, nullptr, 0)
+                                     : std::stod(literal);
+      }
+    }
+    Report(pass == 0 ? "numbers (scanned values)" : "numbers (reparsed)",
+           stream.size(), Seconds(start), "numbers", numbers);
+    // Keep the sum alive
+    static volatile double sink;
+    sink = sum;
+  }
+  std::remove(kGeneratedInput);
+}
+
+// Scans operator-dense input
+void BenchOperators() {
+  GenerateOperatorHeavyInput(kGeneratedInput);
+  MappedFileCharacterStream stream(kGeneratedInput);
+  auto start = std::chrono::steady_clock::now();
+  Scanner scanner;
+  scanner.Initialize(stream.begin(), stream.size());
+  std::size_t tokens = ScanAll(&scanner);
+  Report("operators", stream.size(), Seconds(start), "tokens", tokens);
+  std::remove(kGeneratedInput);
+}
+
+// Scans ASCII and Unicode identifier-heavy inputs
+void BenchIdentifiers() {
+  const char *kinds[] = { "ascii", "unicode" };
+  for (int i = 0; i < 2; i++) {
+    GenerateIdentifierHeavyInput(kGeneratedInput, i == 1);
+    MappedFileCharacterStream stream(kGeneratedInput);
+    auto start = std::chrono::steady_clock::now();
+    Scanner scanner;
+    scanner.Initialize(stream.begin(), stream.size());
+    std::size_t tokens = ScanAll(&scanner);
+    std::string title = std::string("identifiers (") + kinds[i] + ")";
+    Report(title.c_str(), stream.size(), Seconds(start), "tokens", tokens);
+    start = std::chrono::steady_clock::now();
+    SymbolTable symbols;
+    scanner.set_symbol_table(&symbols);
+    scanner.Initialize(stream.begin(), stream.size());
+    ScanAll(&scanner);
+    title = std::string("interned (") + kinds[i] + ")";
+    Report(title.c_str(), stream.size(), Seconds(start),
+           "symbols", symbols.size());
+    start = std::chrono::steady_clock::now();
+    const char *valid = flora::utf8::Validate(stream.begin(), stream.end());
+    title = std::string("utf-8 validation (") + kinds[i] + ")";
+    Report(title.c_str(), stream.size(), Seconds(start),
+           "valid bytes", valid - stream.begin());
+  }
+  std::remove(kGeneratedInput);
+}
+
+}
+
+int main(int argc, char const *argv[]) {
+  const char *filename = argc > 1 ? argv[1] : kGeneratedInput;
+  if (argc <= 1) GenerateInput(kGeneratedInput);
+  {
+    FileCharacterStream stream(filename);
+    BenchVirtualStream("ifstream (virtual)", &stream);
+  }
+  std::size_t bytes;
+  {
+    MappedFileCharacterStream stream(filename);
+    if (!stream.IsOpen()) {
+      std::cerr << "cannot open " << filename << std::endl;
+      return 1;
+    }
+    bytes = stream.size();
+    BenchVirtualStream("mapped (virtual)", &stream);
+  }
+  BenchMappedBuffer(filename);
+  BenchScannerOverStream(filename, bytes);
+  BenchScannerOverBuffer(filename);
+  BenchTokenizeAll(filename);
+  BenchParallelTokenizer(filename);
+  BenchIncrementalTokenizer(filename);
+  BenchLineTable(filename);
+  if (argc <= 1) std::remove(kGeneratedInput);
+  GenerateCommentHeavyInput(kSearchInput);
+  BenchSearchKernels(kSearchInput, "comments");
+  GenerateStringHeavyInput(kSearchInput);
+  BenchSearchKernels(kSearchInput, "strings");
+  std::remove(kSearchInput);
+  BenchIdentifiers();
+  BenchNumbers();
+  BenchOperators();
+  return 0;
+}
@@ -0,0 +1,530 @@
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <sys/resource.h>
+
+#include "../../src/parser.h"
+#include "../../src/scanner.h"
+#include "../../src/symbol-table.h"
+#include "../../src/token-buffer.h"
+#include "../../src/zone.h"
+
+using flora::Parser;
+using flora::Scanner;
+using flora::SymbolTable;
+using flora::Token;
+using flora::TokenBuffer;
+using flora::Zone;
+
+// Every allocation of the process is counted, passes report the difference
+namespace {
+std::atomic<std::size_t> allocation_count(0);
+std::atomic<std::size_t> allocation_bytes(0);
+}
+
+void* operator new(std::size_t size) {
+  allocation_count.fetch_add(1, std::memory_order_relaxed);
+  allocation_bytes.fetch_add(size, std::memory_order_relaxed);
+  if (void *memory = std::malloc(size ? size : 1)) return memory;
+  throw std::bad_alloc();
+}
+
+void operator delete(void *memory) noexcept {
+  std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept {
+  std::free(memory);
+}
+
+namespace {
+
+// Corpora
+
+// Sources are generated from a fixed seed, so a corpus of a given kind and
+// size is the same on every run and every machine
+const unsigned kSeed = 20161018;
+
+const char *kWords[] = {
+  "value", "count", "index", "buffer", "node", "scope", "result", "left",
+  "right", "token", "offset", "length", "parent", "child", "limit", "size"
+};
+
+std::string RandomIdentifier(std::mt19937 *random) {
+  std::uniform_int_distribution<std::size_t> word(0, 15);
+  std::uniform_int_distribution<int> parts(1, 3);
+  std::string name = kWords[word(*random)];
+  for (int i = parts(*random); i > 1; i--) {
+    name += '_';
+    name += kWords[word(*random)];
+  }
+  return name;
+}
+
+void AppendIdentifierLine(std::mt19937 *random, std::string *out) {
+  *out += RandomIdentifier(random) + " = " + RandomIdentifier(random) +
+      " + " + RandomIdentifier(random) + "." + RandomIdentifier(random) +
+      "(" + RandomIdentifier(random) + ");\n";
+}
+
+void AppendNumberLine(std::mt19937 *random, std::string *out) {
+  std::uniform_int_distribution<std::uint64_t> integer(0, 1ull << 40);
+  std::uniform_real_distribution<double> real(-1e6, 1e6);
+  std::uniform_int_distribution<int> exponent(-30, 30);
+  char line[160];
+  std::snprintf(line, sizeof(line),
+                "[%llu, 0x%llX, %.6f, %.15ge%d, %llu, 0b1011, %d.5],\n",
+                static_cast<unsigned long long>(integer(*random)),
+                static_cast<unsigned long long>(integer(*random)),
+                std::abs(real(*random)), std::abs(real(*random)),
+                exponent(*random),
+                static_cast<unsigned long long>(integer(*random) % 1000),
+                exponent(*random) + 30);
+  *out += line;
+}
+
+void AppendStringLine(std::mt19937 *random, std::string *out) {
+  std::uniform_int_distribution<int> choice(0, 3);
+  *out += "{ \"" + RandomIdentifier(random) + "\": \"";
+  for (int i = choice(*random) + 3; i > 0; i--)
+    *out += RandomIdentifier(random) + " ";
+  switch (choice(*random)) {
+  case 0: *out += "\\n\\t\\\"escaped\\\""; break;
+  case 1: *out += "caf\xc3\xa9 na\xc3\xafve"; break;
+  default: *out += "/usr/local/share/flora"; break;
+  }
+  *out += "\", \"" + RandomIdentifier(random) + "\": \"" +
+      RandomIdentifier(random) + "\" },\n";
+}
+
+void AppendCommentLine(std::mt19937 *random, std::string *out) {
+  std::uniform_int_distribution<int> choice(0, 2);
+  switch (choice(*random)) {
+  case 0:
+    *out += "/*\n * Returns the " + RandomIdentifier(random) + " of the " +
+        RandomIdentifier(random) + ", or null if there is none.\n"
+        " * The caller owns the result.\n */\n";
+    break;
+  case 1:
+    *out += "// The " + RandomIdentifier(random) +
+        " must be set before the first call\n";
+    break;
+  default:
+    *out += "int " + RandomIdentifier(random) + "(); /* nested /* " +
+        RandomIdentifier(random) + " */ comment */\n";
+    break;
+  }
+}
+
+void AppendExpression(std::mt19937 *random, int depth, std::string *out) {
+  static const char *operators[] = {
+    " + ", " - ", " * ", " / ", " << ", " && ", " || ", " == "
+  };
+  std::uniform_int_distribution<int> choice(0, 7);
+  if (depth == 0) {
+    *out += choice(*random) < 4 ? RandomIdentifier(random) : "42";
+    return;
+  }
+  *out += '(';
+  AppendExpression(random, depth - 1, out);
+  *out += operators[choice(*random)];
+  // Right operands stay shallow, so that a line grows with its depth
+  // instead of doubling with each level
+  AppendExpression(random,
+                   choice(*random) < 6 ? 0 : std::min(depth - 1, 2), out);
+  *out += ')';
+}
+
+// A variable initialized by a deeply nested expression, named apart from
+// the others so that the corpus is a program
+void AppendNestedLine(std::mt19937 *random, std::string *out) {
+  std::uniform_int_distribution<int> depth(8, 48);
+  *out += "int " + RandomIdentifier(random) + "_" +
+      std::to_string(out->size()) + " = ";
+  AppendExpression(random, depth(*random), out);
+  *out += ";\n";
+}
+
+// A function of one line, with a statement of each of the other corpora,
+// so that a corpus cut at a line feed is still a program
+void AppendFunctionLine(std::mt19937 *random, std::string *out) {
+  std::uniform_int_distribution<int> depth(1, 6);
+  std::uniform_int_distribution<std::uint64_t> integer(0, 1ull << 40);
+  std::string name = RandomIdentifier(random);
+  *out += "int " + name + "_" + std::to_string(out->size()) + "(int " +
+      name + ") { ";
+  AppendIdentifierLine(random, out);
+  out->back() = ' ';
+  *out += "int " + RandomIdentifier(random) + " = ";
+  AppendExpression(random, depth(*random), out);
+  *out += "; String " + RandomIdentifier(random) + " = \"" +
+      RandomIdentifier(random) + "\\n\"; /* " + RandomIdentifier(random) +
+      " */ if (" + name + " < 0x" + std::to_string(integer(*random)) +
+      ") return " + name + "; return " + std::to_string(integer(*random)) +
+      "; }\n";
+}
+
+struct Corpus {
+  const char *name;
+  void (*append_line)(std::mt19937 *random, std::string *out);
+  // Whether the corpus is a program, which the parser pass runs on
+  bool program;
+};
+
+const Corpus kCorpora[] = {
+  { "identifiers", AppendIdentifierLine, false },
+  { "numbers", AppendNumberLine, false },
+  { "strings", AppendStringLine, false },
+  { "comments", AppendCommentLine, false },
+  { "nested", AppendNestedLine, true },
+  { "functions", AppendFunctionLine, true },
+};
+
+std::string GenerateCorpus(const Corpus &corpus, std::size_t size) {
+  std::mt19937 random(kSeed);
+  std::string source;
+  source.reserve(size + 256);
+  while (source.size() < size) corpus.append_line(&random, &source);
+  // Cut at the last line feed which keeps the size, so no token is split.
+  // A program keeps its first line even if it is longer.
+  std::size_t cut = source.rfind('\n', size - 1);
+  if (cut == std::string::npos && corpus.program) cut = source.find('\n');
+  source.resize(cut == std::string::npos ? size : cut + 1);
+  return source;
+}
+
+// Measurements
+
+struct Measurement {
+  double seconds;
+  std::size_t tokens;
+  std::size_t allocations;
+  std::size_t allocated_bytes;
+};
+
+// Scans the source token by token, interning identifiers if there is a
+// table, and returns the number of tokens
+std::size_t CountTokens(const std::string &source, SymbolTable *symbols) {
+  Scanner scanner;
+  scanner.set_symbol_table(symbols);
+  scanner.Initialize(source.data(), source.size());
+  std::size_t tokens = 0;
+  while (true) {
+    Token tok = scanner.Advance();
+    if (tok == Token::EndOfSource || tok == Token::Illegal)
+      break;
+    tokens++;
+  }
+  return tokens;
+}
+
+// The passes over a corpus, each returns the number of tokens
+std::size_t ScanPass(const std::string &source) {
+  return CountTokens(source, nullptr);
+}
+
+std::size_t TokenizePass(const std::string &source) {
+  Scanner scanner;
+  scanner.Initialize(source.data(), source.size());
+  TokenBuffer tokens;
+  scanner.TokenizeAll(&tokens);
+  return tokens.size() - 1;
+}
+
+std::size_t InternPass(const std::string &source) {
+  SymbolTable symbols;
+  return CountTokens(source, &symbols);
+}
+
+// Builds the tree of a program and returns its nodes, the tokens of the
+// corpus are counted by a scan instead
+std::size_t ParsePass(const std::string &source) {
+  Zone zone;
+  SymbolTable symbols;
+  Parser parser(&zone, &symbols);
+  if (!parser.Parse(source.data(), source.size())) {
+    std::fprintf(stderr, "parser pass: %s at %u\n",
+                 parser.error_message().c_str(), parser.error_position());
+    std::exit(2);
+  }
+  return parser.statistics().node_count;
+}
+
+struct Pass {
+  const char *name;
+  std::size_t (*run)(const std::string &source);
+  // Runs only on program corpora, and does not count tokens
+  bool needs_program;
+};
+
+const Pass kPasses[] = {
+  { "scanner", ScanPass, false },
+  { "tokenize", TokenizePass, false },
+  { "intern", InternPass, false },
+  { "parser", ParsePass, true },
+};
+
+// Runs the pass until enough time has passed to trust the clock, keeps
+// the fastest run. Small sources are scanned several times per run, so
+// that a run is long enough for the clock.
+Measurement Measure(const Pass &pass, const std::string &source) {
+  const std::size_t batch = std::max<std::size_t>(1, (1 << 20) / source.size());
+  Measurement best = { 0, 0, 0, 0 };
+  double total = 0;
+  for (int run = 0; run < 1000 && (run < 3 || total < 0.25); run++) {
+    std::size_t count = allocation_count.load();
+    std::size_t bytes = allocation_bytes.load();
+    auto start = std::chrono::steady_clock::now();
+    std::size_t tokens = 0;
+    for (std::size_t i = 0; i < batch; i++) tokens = pass.run(source);
+    std::chrono::duration<double> elapsed =
+        std::chrono::steady_clock::now() - start;
+    double seconds = elapsed.count() / batch;
+    total += elapsed.count();
+    if (run == 0 || seconds < best.seconds) {
+      best.seconds = seconds;
+      best.tokens = tokens;
+      best.allocations = (allocation_count.load() - count) / batch;
+      best.allocated_bytes = (allocation_bytes.load() - bytes) / batch;
+    }
+  }
+  return best;
+}
+
+// Resets the peak resident set size, where the kernel allows it
+void ResetPeakMemory() {
+  std::ofstream clear_refs("/proc/self/clear_refs");
+  if (clear_refs) clear_refs << "5";
+}
+
+// The peak resident set size in KB since the last reset, or since the
+// start of the process if it could not be reset
+std::size_t PeakMemory() {
+  std::ifstream status("/proc/self/status");
+  std::string line;
+  while (std::getline(status, line)) {
+    if (line.compare(0, 6, "VmHWM:") == 0)
+      return std::strtoull(line.c_str() + 6, nullptr, 10);
+  }
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  return usage.ru_maxrss;
+}
+
+struct Result {
+  std::string corpus;
+  std::size_t size;
+  std::string pass;
+  double megabytes_per_second;
+  double tokens_per_second;
+  std::size_t allocations;
+  std::size_t allocated_bytes;
+  std::size_t peak_kb;
+};
+
+std::string ResultKey(const std::string &corpus, std::size_t size,
+                      const std::string &pass) {
+  return corpus + "/" + std::to_string(size) + "/" + pass;
+}
+
+// JSON, one result per line so that the baseline is easy to diff and to
+// read back
+
+void WriteJson(std::ostream &out, const std::vector<Result> &results) {
+  out << "{\n  \"results\": [\n";
+  for (std::size_t i = 0; i < results.size(); i++) {
+    const Result &r = results[i];
+    char line[512];
+    std::snprintf(line, sizeof(line),
+                  "    {\"corpus\": \"%s\", \"size\": %zu, \"pass\": \"%s\", "
+                  "\"mb_per_s\": %.1f, \"tokens_per_s\": %.0f, "
+
+                  "\"allocations\": %zu, \"allocated_bytes\": %zu, "
+                  "\"peak_rss_kb\": %zu}%s\n",
+                  r.corpus.c_str(), r.size, r.pass.c_str(),
+                  r.megabytes_per_second, r.tokens_per_second,
+                  r.allocations, r.allocated_bytes, r.peak_kb,
+                  i + 1 < results.size() ? "," : "");
+    out << line;
+  }
+  out << "  ]\n}\n";
+}
+
+// Reads the value following "key": in a line written by WriteJson
+std::string JsonField(const std::string &line, const char *key) {
+  std::string quoted = std::string("\"") + key + "\": ";
+  std::size_t start = line.find(quoted);
+  if (start == std::string::npos) return std::string();
+  start += quoted.size();
+  if (line[start] == '"') {
+    std::size_t end = line.find('"', start + 1);
+    return line.substr(start + 1, end - start - 1);
+  }
+  std::size_t end = line.find_first_of(",}", start);
+  return line.substr(start, end - start);
+}
+
+bool ReadJson(const char *filename, std::vector<Result> *results) {
+  std::ifstream in(filename);
+  if (!in) return false;
+  std::string line;
+  while (std::getline(in, line)) {
+    if (line.find("\"corpus\"") == std::string::npos) continue;
+    Result r;
+    r.corpus = JsonField(line, "corpus");
+    r.size = std::strtoull(JsonField(line, "size").c_str(), nullptr, 10);
+    r.pass = JsonField(line, "pass");
+    r.megabytes_per_second = std::atof(JsonField(line, "mb_per_s").c_str());
+    r.tokens_per_second = std::atof(JsonField(line, "tokens_per_s").c_str());
+    r.allocations =
+        std::strtoull(JsonField(line, "allocations").c_str(), nullptr, 10);
+    r.allocated_bytes = std::strtoull(
+        JsonField(line, "allocated_bytes").c_str(), nullptr, 10);
+    r.peak_kb =
+        std::strtoull(JsonField(line, "peak_rss_kb").c_str(), nullptr, 10);
+    results->push_back(r);
+  }
+  return true;
+}
+
+// Throughput may drop by the tolerance before it counts as a regression.
+// It is only comparable with a baseline taken on the same machine.
+// Allocations are deterministic, but the standard library may grow its
+// containers differently, so they get a small margin too.
+int CompareWithBaseline(const std::vector<Result> &results,
+                        const std::vector<Result> &baseline,
+                        double tolerance) {
+  int regressions = 0;
+  for (const Result &r : results) {
+    std::string key = ResultKey(r.corpus, r.size, r.pass);
+    for (const Result &b : baseline) {
+      if (ResultKey(b.corpus, b.size, b.pass) != key) continue;
+      double ratio = r.megabytes_per_second / b.megabytes_per_second;
+      bool slower = ratio < 1 - tolerance;
+      bool allocates = r.allocations > b.allocations + b.allocations / 10 + 4;
+      if (slower || allocates) {
+        std::printf("REGRESSION %-32s %8.1f -> %8.1f MB/s, "
+                    "%zu -> %zu allocations\n",
+                    key.c_str(), b.megabytes_per_second,
+                    r.megabytes_per_second, b.allocations, r.allocations);
+        regressions++;
+      }
+    }
+  }
+  return regressions;
+}
+
+// Sizes like 64K, 16M or 1G
+std::size_t ParseSize(const char *text) {
+  char *suffix;
+  std::size_t size = std::strtoull(text, &suffix, 10);
+  switch (*suffix) {
+  case 'K': case 'k': return size << 10;
+  case 'M': case 'm': return size << 20;
+  case 'G': case 'g': return size << 30;
+  default: return size;
+  }
+}
+
+void Usage() {
+  std::cerr <<
+      "usage: suite.out [--size N[K|M|G]]... [--corpus NAME]...\n"
+      "                 [--json FILE] [--baseline FILE] [--tolerance T]\n"
+      "Sizes default to 1K, 64K, 1M and 16M, corpora to all of them.\n"
+      "The parser pass runs only on the nested and functions corpora.\n"
+      "With a baseline the exit status is 1 if a result regressed.\n";
+}
+
+}
+
+int main(int argc, char const *argv[]) {
+  std::vector<std::size_t> sizes;
+  std::vector<std::string> corpora;
+  const char *json = nullptr;
+  const char *baseline = nullptr;
+  double tolerance = 0.25;
+  for (int i = 1; i < argc; i++) {
+    std::string option = argv[i];
+    if (i + 1 == argc) {
+      Usage();
+      return 2;
+    }
+    const char *value = argv[++i];
+    if (option == "--size") {
+      sizes.push_back(ParseSize(value));
+    } else if (option == "--corpus") {
+      corpora.push_back(value);
+    } else if (option == "--json") {
+      json = value;
+    } else if (option == "--baseline") {
+      baseline = value;
+    } else if (option == "--tolerance") {
+      tolerance = std::atof(value);
+    } else {
+      Usage();
+      return 2;
+    }
+  }
+  if (sizes.empty()) sizes = { 1 << 10, 64 << 10, 1 << 20, 16 << 20 };
+
+  std::vector<Result> results;
+  for (const Corpus &corpus : kCorpora) {
+    if (!corpora.empty() &&
+        std::find(corpora.begin(), corpora.end(), corpus.name) ==
+            corpora.end())
+      continue;
+    for (std::size_t size : sizes) {
+      std::string source = GenerateCorpus(corpus, size);
+      std::size_t tokens = ScanPass(source);
+      for (const Pass &pass : kPasses) {
+        if (pass.needs_program && !corpus.program) continue;
+        ResetPeakMemory();
+        Measurement m = Measure(pass, source);
+        if (pass.needs_program) m.tokens = tokens;
+        Result r;
+        r.corpus = corpus.name;
+        r.size = size;
+        r.pass = pass.name;
+        r.megabytes_per_second = source.size() / m.seconds / (1024 * 1024);
+        r.tokens_per_second = m.tokens / m.seconds;
+        r.allocations = m.allocations;
+        r.allocated_bytes = m.allocated_bytes;
+        r.peak_kb = PeakMemory();
+        std::printf("%-12s %10zu %-9s %9.1f MB/s %12.0f tokens/s "
+                    "%8zu allocs %8zu KB peak\n",
+                    r.corpus.c_str(), r.size, r.pass.c_str(),
+                    r.megabytes_per_second, r.tokens_per_second,
+                    r.allocations, r.peak_kb);
+        results.push_back(r);
+      }
+    }
+  }
+
+  if (json) {
+    std::ofstream out(json);
+    WriteJson(out, results);
+  }
+  if (baseline) {
+    std::vector<Result> expected;
+    if (!ReadJson(baseline, &expected)) {
+      std::cerr << "cannot read baseline " << baseline << std::endl;
+      return 2;
+    }
+    int regressions = CompareWithBaseline(results, expected, tolerance);
+    std::printf("%d regressions against %s\n", regressions, baseline);
+    if (regressions) return 1;
+  }
+  return 0;
+}
@@ -1,14 +1,519 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
 #include <iostream>
+#include <map>
+#include <random>
+#include <string>
+#include <utility>
+#include <vector>
 
+#include "../../src/character-search.h"
 #include "../../src/character-stream.h"
+#include "../../src/incremental-tokenizer.h"
+#include "../../src/line-table.h"
+#include "../../src/parallel-tokenizer.h"
 #include "../../src/scanner.h"
+#include "../../src/symbol-table.h"
 #include "../../src/token.h"
+#include "../../src/token-buffer.h"
 
 using flora::FileCharacterStream;
+using flora::IncrementalTokenizer;
+using flora::LineTable;
+using flora::MappedFileCharacterStream;
+using flora::NumberLiteral;
+using flora::ParallelTokenizer;
 using flora::Scanner;
+using flora::SourceLocation;
+using flora::Symbol;
+using flora::SymbolTable;
+using flora::TextEdit;
 using flora::Token;
+using flora::TokenEdit;
+using flora::TokenBuffer;
 using flora::Tokens;
 
+struct ScannedToken {
+  Token token;
+  std::string literal;
+  std::size_t offset;
+  std::size_t length;
+};
+
+// Returns true if the value of a number token is what the C library makes
+// of its literal
+bool SameNumber(Token token, const NumberLiteral &number,
+                const std::string &literal) {
+  if (token == Token::RealNumber) {
+    double expected = std::strtod(literal.c_str(), nullptr);
+    return number.type == Token::Double &&
+        std::memcmp(&number.real, &expected, sizeof(double)) == 0;
+  }
+  int base = 10;
+  std::size_t prefix = 0;
+  if (literal.size() > 1 && literal[0] == '0' && !std::isdigit(literal[1])) {
+    base = literal[1] == 'x' ? 16 : literal[1] == 'o' ? 8 : 2;
+    prefix = 2;
+  }
+  unsigned long long expected =
+      std::strtoull(literal.c_str() + prefix, nullptr, base);
+  Token type = expected <= INT32_MAX ? Token::Int :
+      base != 10 && expected <= UINT32_MAX ? Token::Unsigned : Token::Long;
+  return number.integer == expected && number.type == type;
+}
+
+// Returns true if integer literals too large for long are errors, unless
+// they have a base prefix and fit in 64 bits
+bool CheckNumberLimits() {
+  struct {
+    const char *source;
+    Token token;
+    Token type;
+  } cases[] = {
+    { "2147483647", Token::Integer, Token::Int },
+    { "2147483648", Token::Integer, Token::Long },
+    { "0x80000000", Token::Integer, Token::Unsigned },
+    { "9223372036854775807", Token::Integer, Token::Long },
+    { "9223372036854775808", Token::Illegal, Token::Int },
+    { "0xFFFFFFFFFFFFFFFF", Token::Integer, Token::Long },
+    { "0x10000000000000000", Token::Illegal, Token::Int },
+    { "0o1777777777777777777777", Token::Integer, Token::Long },
+    { "0o2000000000000000000000", Token::Illegal, Token::Int },
+    { "1e308", Token::RealNumber, Token::Double },
+    { "1e309", Token::Illegal, Token::Int },
+  };
+  for (const auto &test : cases) {
+    Scanner scanner;
+    scanner.Initialize(test.source, std::strlen(test.source));
+    Token token = scanner.Advance();
+    if (token != test.token) return false;
+    if (token != Token::Illegal &&
+        (scanner.GetTokenNumber().type != test.type ||
+         !SameNumber(token, scanner.GetTokenNumber(), test.source)))
+      return false;
+  }
+  return true;
+}
+
+// Returns true if the token flags agree with the keyword lookup and the
+// precedences of the operators
+bool CheckTokenFlags() {
+  for (int i = 0; i < static_cast<int>(Token::TOKEN_COUNT); i++) {
+    Token token = static_cast<Token>(i);
+    const char *literal = Tokens::Literal(token);
+    bool keyword = literal && Tokens::LookupKeyword(literal) == token;
+    if (Tokens::IsKeyword(token) != keyword) return false;
+    if (Tokens::IsAssignment(token) != (Tokens::Precedence(token) == 2))
+      return false;
+    bool binary = Tokens::Precedence(token) > 0 && !Tokens::IsAssignment(token);
+    if (Tokens::IsBinaryOperator(token) != binary) return false;
+  }
+  return Tokens::IsType(Token::Int) && Tokens::IsType(Token::Unsigned) &&
+      !Tokens::IsType(Token::Null) && !Tokens::IsType(Token::Identifier);
+}
+
+// Returns true if every punctuation literal of TOKEN_LIST scans to its
+// token, and every pair of them to the longest matches, one after another.
+// A match is the longest text which starts some literal, and is an error
+// if it is not a literal itself, such as "..".
+bool CheckPunctuation() {
+  std::vector<std::pair<std::string, Token>> punctuation;
+#define K(name, literal, precedence, flags)
+#define T(name, literal, precedence, flags)\
+  if (literal && Token::name != Token::EndOfSource)\
+    punctuation.push_back(std::make_pair(std::string(literal), Token::name));
+  TOKEN_LIST(K, T)
+#undef T
+#undef K
+  Scanner scanner;
+  for (const auto &first : punctuation) {
+    scanner.Initialize(first.first.data(), first.first.size());
+    if (scanner.Advance() != first.second ||
+        scanner.GetTokenLength() != first.first.size())
+      return false;
+    for (const auto &second : punctuation) {
+      std::string source = first.first + second.first;
+      // Those open comments
+      if (source.find("//") != std::string::npos ||
+          source.find("/*") != std::string::npos)
+        continue;
+      scanner.Initialize(source.data(), source.size());
+      std::size_t offset = 0;
+      while (offset < source.size()) {
+        std::size_t length = 0;
+        for (const auto &candidate : punctuation) {
+          std::size_t common = 0;
+          while (common < candidate.first.size() &&
+                 offset + common < source.size() &&
+                 candidate.first[common] == source[offset + common])
+            common++;
+          length = std::max(length, common);
+        }
+        Token expected = Token::Illegal;
+        for (const auto &candidate : punctuation) {
+          if (source.compare(offset, length, candidate.first) == 0)
+            expected = candidate.second;
+        }
+        Token token = scanner.Advance();
+        if (token != expected || scanner.GetTokenOffset() != offset ||
+            (token != Token::Illegal && scanner.GetTokenLength() != length)) {
+          std::cout << source << ": " << offset << std::endl;
+          return false;
+        }
+        if (token == Token::Illegal) break;
+        offset += length;
+      }
+      if (offset == source.size() && scanner.Advance() != Token::EndOfSource)
+        return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if TokenizeAll produces the same tokens as Advance()
+bool CheckTokenizeAll(const char *filename,
+                      const std::vector<ScannedToken> &expected) {
+  MappedFileCharacterStream stream(filename);
+  Scanner scanner;
+  scanner.Initialize(stream.begin(), stream.size());
+  TokenBuffer tokens;
+  scanner.TokenizeAll(&tokens);
+  if (tokens.size() != expected.size()) return false;
+  for (std::size_t i = 0; i < tokens.size(); i++) {
+    if (tokens.kind(i) != expected[i].token ||
+        tokens.literal(i).ToString() != expected[i].literal ||
+        tokens.offset(i) != expected[i].offset ||
+        tokens.length(i) != expected[i].length)
+      return false;
+    if ((expected[i].token == Token::Integer ||
+         expected[i].token == Token::RealNumber) &&
+        !SameNumber(expected[i].token, tokens.number(i), expected[i].literal))
+      return false;
+  }
+  return true;
+}
+
+bool SameToken(const Scanner &scanner, const ScannedToken &expected) {
+  return scanner.GetTokenLiteral().ToString() == expected.literal &&
+      scanner.GetTokenOffset() == expected.offset &&
+      scanner.GetTokenLength() == expected.length;
+}
+
+// Returns true if the scanner gives each distinct identifier its own
+// symbol and no symbol to other tokens
+bool CheckSymbolTable(const char *source, std::size_t length) {
+  SymbolTable symbols;
+  Scanner plain, interning;
+  plain.Initialize(source, length);
+  interning.set_symbol_table(&symbols);
+  interning.Initialize(source, length);
+  std::map<std::string, Symbol> seen;
+  while (true) {
+    Token token = plain.Advance();
+    interning.Advance();
+    Symbol symbol = interning.GetTokenSymbol();
+    if (token == Token::Identifier) {
+      std::string literal = plain.GetTokenLiteral().ToString();
+      if (symbol == flora::kNoSymbol ||
+          symbols.Name(symbol).ToString() != literal ||
+          symbols.Lookup(literal) != symbol)
+        return false;
+      auto inserted = seen.insert(std::make_pair(literal, symbol));
+      if (inserted.first->second != symbol) return false;
+    } else if (symbol != flora::kNoSymbol) {
+      return false;
+    }
+    if (token == Token::EndOfSource || token == Token::Illegal) break;
+  }
+  return symbols.size() == seen.size();
+}
+
+// Returns true if Peek() sees the tokens Advance() returns later, and
+// rewinding to nested checkpoints, near ones in the ring and far ones that
+// must be scanned again, replays the same tokens
+bool CheckLookahead(const char *filename,
+                    const std::vector<ScannedToken> &expected) {
+  MappedFileCharacterStream stream(filename);
+  Scanner scanner;
+  scanner.Initialize(stream.begin(), stream.size());
+  const std::size_t count = expected.size();
+  const std::size_t distances[] = { 1, 3, 40 };
+  for (std::size_t i = 0; i < count; i++) {
+    for (std::size_t n = 1; n < Scanner::kLookaheadCapacity; n++) {
+      // Past the end the last token repeats
+      if (scanner.Peek(n) != expected[std::min(i + n - 1, count - 1)].token)
+        return false;
+    }
+    if (scanner.Advance() != expected[i].token ||
+        !SameToken(scanner, expected[i]))
+      return false;
+    Scanner::Checkpoint outer = scanner.SaveCheckpoint();
+    for (std::size_t distance : distances) {
+      for (std::size_t k = 0; k < distance; k++) scanner.Advance();
+      Scanner::Checkpoint inner = scanner.SaveCheckpoint();
+      scanner.Advance();
+      scanner.Rewind(inner);
+      std::size_t j = std::min(i + distance, count - 1);
+      if (!SameToken(scanner, expected[j])) return false;
+      if (scanner.Rewind(outer) != expected[i].token ||
+          !SameToken(scanner, expected[i]))
+        return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if the line table agrees with counting line feeds and
+// characters from the start for every token
+bool CheckLineTable(const MappedFileCharacterStream &stream,
+                    const std::vector<ScannedToken> &tokens) {
+  LineTable lines(flora::StringSpan(stream.begin(), stream.end()));
+  std::size_t line = 1, column = 1, position = 0;
+  for (const ScannedToken &token : tokens) {
+    for (; position < token.offset; position++) {
+      char ch = stream.begin()[position];
+      if (ch == '\n') {
+        line++;
+        column = 1;
+      } else if ((ch & 0xC0) != 0x80) {
+        column++;
+      }
+    }
+    SourceLocation location = lines.Locate(token.offset);
+    if (location.line != line || location.column != column) return false;
+  }
+  return lines.LineCount() == line;
+}
+
+bool SameTokens(const TokenBuffer &a, const TokenBuffer &b) {
+  if (a.size() != b.size()) return false;
+  for (std::size_t i = 0; i < a.size(); i++) {
+    if (a.kind(i) != b.kind(i) || a.offset(i) != b.offset(i) ||
+        a.length(i) != b.length(i) || a.literal(i) != b.literal(i))
+      return false;
+    if ((a.kind(i) == Token::Integer || a.kind(i) == Token::RealNumber) &&
+        a.number(i).integer != b.number(i).integer)
+      return false;
+  }
+  return true;
+}
+
+// Returns true if the parallel tokenizer agrees with TokenizeAll for every
+// chunk size, small chunks put boundaries inside most tokens and comments
+bool CheckParallelTokenizer(const char *source, std::size_t length) {
+  Scanner scanner;
+  scanner.Initialize(source, length);
+  TokenBuffer expected;
+  scanner.TokenizeAll(&expected);
+  ParallelTokenizer tokenizer(4);
+  for (std::size_t chunk_size = 1; chunk_size <= 64; chunk_size++) {
+    tokenizer.set_chunk_size(chunk_size);
+    TokenBuffer tokens;
+    tokenizer.Tokenize(source, length, &tokens);
+    if (!SameTokens(tokens, expected)) return false;
+  }
+  return true;
+}
+
+// Returns true if every search kernel gives the same tokens
+bool CheckSearchKernels(const char *source, std::size_t length) {
+  const char *kernels[] = { "scalar", "sse2", "avx2" };
+  TokenBuffer expected;
+  for (const char *kernel : kernels) {
+    if (!flora::character::SelectSearchKernels(kernel)) continue;
+    Scanner scanner;
+    scanner.Initialize(source, length);
+    TokenBuffer tokens;
+    scanner.TokenizeAll(&tokens);
+    if (expected.empty()) {
+      expected = std::move(tokens);
+    } else if (!SameTokens(tokens, expected)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Random sources built from fragments which are hard to split: strings
+// with escapes, nested comments and comment delimiters inside strings. The
+// last fragments are unbalanced and make most sources end in an error.
+std::string RandomSource(std::mt19937 *random, bool with_errors) {
+  static const char *fragments[] = {
+    "foo", "_bar9", "\xce\xbb", "42", "0x1F", "3.25", "+", "<<=", "->",
+    "(", "}", ";", " ", "\n", "\t", "\"a b\"", "\"x\\\"y\"",
+    "\"/* not a comment\"", "\"\\u955\"", "'c'", "'\\n'",
+    "/* one */", "/* a /* nested */ comment */", "// line comment\n",
+    "/*\n*/", "*/", "if", "while",
+    "\"a string long enough for a whole block of the vector search\"",
+    "\"na\xc3\xafve \\\"quoted\\\" text with an escape in the middle\"",
+    "/*", "\""
+  };
+  const std::size_t count =
+      sizeof(fragments) / sizeof(const char*) - (with_errors ? 0 : 2);
+  std::uniform_int_distribution<std::size_t> pick(0, count - 1);
+  std::string source;
+  for (int i = 0; i < 60; i++) source += fragments[pick(*random)];
+  return source;
+}
+
+// Returns true if random splices over many chunks, large and small, keep
+// the same tokens as a plain array with the same edits
+bool CheckTokenBufferSplice() {
+  struct Expected {
+    Token kind;
+    std::uint32_t offset;
+    std::uint32_t length;
+    std::uint64_t value;
+    std::string decoded;
+  };
+  std::mt19937 random(20161018);
+  std::vector<Expected> expected;
+  // Numbers and strings take their first offset as value and text
+  auto append = [&random](std::uint32_t offset, TokenBuffer *tokens,
+                          std::vector<Expected> *into) {
+    Expected token = { Token::Semicolon, offset, 1, offset, std::string() };
+    switch (random() % 3) {
+    case 0:
+      tokens->Append(token.kind, offset, 1);
+      break;
+    case 1: {
+      token.kind = Token::Integer;
+      NumberLiteral number;
+      number.type = Token::Int;
+      number.integer = offset;
+      tokens->Append(token.kind, offset, 1, number);
+      break;
+    }
+    default:
+      token.kind = Token::String;
+      token.decoded = std::to_string(offset);
+      tokens->Append(token.kind, offset, 1, token.decoded);
+      break;
+    }
+    into->push_back(token);
+  };
+  TokenBuffer tokens;
+  auto same = [&tokens, &expected]() {
+    if (tokens.size() != expected.size()) return false;
+    for (std::size_t i = 0; i < expected.size(); i++) {
+      const Expected &token = expected[i];
+      if (tokens.kind(i) != token.kind || tokens.offset(i) != token.offset ||
+          tokens.length(i) != token.length ||
+          (token.kind == Token::Integer ?
+           tokens.number(i).integer != token.value :
+           tokens.literal(i) != token.decoded))
+        return false;
+    }
+    return true;
+  };
+  for (std::uint32_t i = 0; i < 5 * TokenBuffer::kChunkSize + 17; i++)
+    append(i * 2, &tokens, &expected);
+  for (int edit = 0; edit < 300; edit++) {
+    // Mostly small edits, every tenth one spans several chunks
+    std::size_t span = edit % 10 == 0 ? 3 * TokenBuffer::kChunkSize : 8;
+    std::size_t begin = random() % (expected.size() + 1);
+    std::size_t removable = std::min(span, expected.size() - begin);
+    std::size_t end = begin + random() % (removable + 1);
+    std::vector<Expected> inserted;
+    TokenBuffer other;
+    std::size_t count = random() % (span + 1);
+    for (std::size_t i = 0; i < count; i++)
+      append(static_cast<std::uint32_t>(random()), &other, &inserted);
+    std::ptrdiff_t shift = static_cast<std::ptrdiff_t>(random() % 64) - 32;
+    tokens.Splice(begin, end, other, shift);
+    for (std::size_t i = end; i < expected.size(); i++)
+      expected[i].offset = static_cast<std::uint32_t>(expected[i].offset +
+                                                      shift);
+    expected.erase(expected.begin() + begin, expected.begin() + end);
+    expected.insert(expected.begin() + begin, inserted.begin(),
+                    inserted.end());
+    if (!same()) return false;
+  }
+  // Appending applies the pending move of the later chunks
+  append(7, &tokens, &expected);
+  if (!same()) return false;
+  // Appending a range reads across the uneven chunks
+  TokenBuffer copy;
+  copy.Append(tokens, 3, tokens.size() - 3);
+  for (std::size_t i = 3; i < tokens.size() - 3; i++) {
+    if (copy.kind(i - 3) != tokens.kind(i) ||
+        copy.offset(i - 3) != tokens.offset(i) ||
+        copy.length(i - 3) != tokens.length(i))
+      return false;
+  }
+  return copy.size() == tokens.size() - 6;
+}
+
+// Returns true if relexing after random edits gives the tokens of the
+// edited source, with edits that open and close comments and strings
+bool CheckIncrementalTokenizer(std::mt19937 *random, bool with_errors) {
+  static const char *insertions[] = {
+    "", "x", "1", ".", "=", " ", "\n", "/*", "*/", "//", "\"", "'", "\\",
+    "foo bar", "\xce\xbb"
+  };
+  std::uniform_int_distribution<std::size_t> pick_insertion(
+      0, sizeof(insertions) / sizeof(const char*) - 1);
+  std::string source = RandomSource(random, with_errors);
+  Scanner scanner;
+  scanner.Initialize(source.data(), source.size());
+  TokenBuffer tokens;
+  scanner.TokenizeAll(&tokens);
+  IncrementalTokenizer tokenizer;
+  for (int i = 0; i < 20; i++) {
+    std::uniform_int_distribution<std::size_t> pick_offset(0, source.size());
+    std::size_t offset = pick_offset(*random);
+    std::uniform_int_distribution<std::size_t> pick_removed(
+        0, std::min<std::size_t>(8, source.size() - offset));
+    std::string inserted = insertions[pick_insertion(*random)];
+    TextEdit edit = { offset, pick_removed(*random), inserted.size() };
+    source.replace(edit.offset, edit.removed, inserted);
+    tokenizer.Relex(source.data(), source.size(), edit, &tokens);
+    scanner.Initialize(source.data(), source.size());
+    TokenBuffer expected;
+    scanner.TokenizeAll(&expected);
+    if (!SameTokens(tokens, expected)) {
+      std::cout << source << std::endl;
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if an edit relexes only the tokens around it, and opening
+// or closing a comment relexes only up to its end
+bool CheckRelexLocality() {
+  std::string source;
+  for (int i = 0; i < 1000; i++)
+    source += i == 500 ? "foo = 1; */\n" : "foo = 1;\n";
+  Scanner scanner;
+  scanner.Initialize(source.data(), source.size());
+  TokenBuffer tokens;
+  scanner.TokenizeAll(&tokens);
+  IncrementalTokenizer tokenizer;
+  // foo = 1; becomes foo = 22;
+  std::size_t line = 9 * 500;
+  TextEdit digits = { line + 6, 1, 2 };
+  source.replace(digits.offset, digits.removed, "22");
+  TokenEdit changed = tokenizer.Relex(source.data(), source.size(), digits,
+                                      &tokens);
+  if (changed.removed > 4 || changed.inserted > 4) return false;
+  // Comment out the line up to its */
+  TextEdit open = { line, 0, 2 };
+  source.insert(line, "/*");
+  changed = tokenizer.Relex(source.data(), source.size(), open, &tokens);
+  if (changed.removed > 8 || changed.inserted > 2) return false;
+  TextEdit close = { line, 2, 0 };
+  source.erase(line, 2);
+  changed = tokenizer.Relex(source.data(), source.size(), close, &tokens);
+  if (changed.removed > 2 || changed.inserted > 8) return false;
+  scanner.Initialize(source.data(), source.size());
+  TokenBuffer expected;
+  scanner.TokenizeAll(&expected);
+  return SameTokens(tokens, expected) && tokens.size() == 4000 + 2 + 1 &&
+      tokens.offset(tokens.size() - 1) == source.size();
+}
+
 int main(int argc, char const *argv[]) {
   const char *test_cases[] = {
     "test_case_all_tokens.txt",
@@ -18,14 +523,20 @@ int main(int argc, char const *argv[]) {
     // "test_case_5.txt",
     // "test_case_6.txt"
   };
+  int result = 0;
   for (int i = 0; i < sizeof(test_cases) / sizeof(const char*); i++) {
     std::cout << "Now testing " << test_cases[i] << std::endl;
     FileCharacterStream *stream = new FileCharacterStream(test_cases[i]);
     Scanner *scanner = new Scanner();
     scanner->Initialize(stream);
     std::cout << "Start scanning..." << std::endl;
+    std::vector<ScannedToken> scanned;
     while (true) {
       Token tok = scanner->Advance();
+      ScannedToken record = { tok, scanner->GetTokenLiteral().ToString(),
+                              scanner->GetTokenOffset(),
+                              scanner->GetTokenLength() };
+      scanned.push_back(record);
       std::cout << Tokens::Name(tok) << " (\"";
       if (scanner->GetTokenLiteral().size() > 0) {
         std::cout << scanner->GetTokenLiteral();
@@ -38,6 +549,103 @@ int main(int argc, char const *argv[]) {
     }
     delete scanner;
     delete stream;
+    if (CheckTokenizeAll(test_cases[i], scanned)) {
+      std::cout << "TokenizeAll matches" << std::endl;
+    } else {
+      std::cout << "TokenizeAll mismatches" << std::endl;
+      result = 1;
+    }
+    if (CheckNumberLimits()) {
+      std::cout << "Number limits match" << std::endl;
+    } else {
+      std::cout << "Number limits mismatch" << std::endl;
+      result = 1;
+    }
+    if (CheckTokenFlags()) {
+      std::cout << "Token flags match" << std::endl;
+    } else {
+      std::cout << "Token flags mismatch" << std::endl;
+      result = 1;
+    }
+    if (CheckPunctuation()) {
+      std::cout << "Punctuation matches" << std::endl;
+    } else {
+      std::cout << "Punctuation mismatches" << std::endl;
+      result = 1;
+    }
+    if (CheckLookahead(test_cases[i], scanned)) {
+      std::cout << "Lookahead matches" << std::endl;
+    } else {
+      std::cout << "Lookahead mismatches" << std::endl;
+      result = 1;
+    }
+    // The line index is built by each search kernel in turn, the last one
+    // supported is also the default
+    const char *kernels[] = { "scalar", "sse2", "avx2" };
+    MappedFileCharacterStream mapped(test_cases[i]);
+    for (const char *kernel : kernels) {
+      if (!flora::character::SelectSearchKernels(kernel)) continue;
+      if (!CheckLineTable(mapped, scanned)) {
+        std::cout << "LineTable mismatches (" << kernel << ")" << std::endl;
+        result = 1;
+      }
+    }
+    if (result == 0) std::cout << "LineTable matches" << std::endl;
+  }
+  MappedFileCharacterStream stream(test_cases[0]);
+  if (CheckParallelTokenizer(stream.begin(), stream.size())) {
+    std::cout << "ParallelTokenizer matches" << std::endl;
+  } else {
+    std::cout << "ParallelTokenizer mismatches" << std::endl;
+    result = 1;
+  }
+  std::mt19937 random(20161018);
+  for (int i = 0; i < 200; i++) {
+    std::string source = RandomSource(&random, i % 2 == 1);
+    if (!CheckParallelTokenizer(source.data(), source.size())) {
+      std::cout << "ParallelTokenizer mismatches on random source:\n"
+                << source << std::endl;
+      result = 1;
+      break;
+    }
+  }
+  if (CheckTokenBufferSplice()) {
+    std::cout << "TokenBuffer splices match" << std::endl;
+  } else {
+    std::cout << "TokenBuffer splices mismatch" << std::endl;
+    result = 1;
+  }
+  bool relexing_matches = CheckRelexLocality();
+  for (int i = 0; i < 200 && relexing_matches; i++)
+    relexing_matches = CheckIncrementalTokenizer(&random, i % 2 == 1);
+  if (relexing_matches) {
+    std::cout << "IncrementalTokenizer matches" << std::endl;
+  } else {
+    std::cout << "IncrementalTokenizer mismatches" << std::endl;
+    result = 1;
+  }
+  bool kernels_match = true;
+  for (int i = 0; i < 200 && kernels_match; i++) {
+    std::string source = RandomSource(&random, i % 2 == 1);
+    kernels_match = CheckSearchKernels(source.data(), source.size());
+  }
+  if (kernels_match) {
+    std::cout << "Search kernels match" << std::endl;
+  } else {
+    std::cout << "Search kernels mismatch" << std::endl;
+    result = 1;
+  }
+  // Random sources glue fragments into many different identifiers
+  bool symbols_match = true;
+  for (int i = 0; i < 100 && symbols_match; i++) {
+    std::string source = RandomSource(&random, false);
+    symbols_match = CheckSymbolTable(source.data(), source.size());
+  }
+  if (symbols_match) {
+    std::cout << "SymbolTable matches" << std::endl;
+  } else {
+    std::cout << "SymbolTable mismatches" << std::endl;
+    result = 1;
   }
-  return 0;
+  return result;
 }
\ No newline at end of file
@@ -0,0 +1,110 @@
+#!/usr/bin/env python3
+# Generates src/character-tables.cc, the character classification tables
+# used by src/character-predicates.h.
+#
+# XID_Start and XID_Continue are taken from the Unicode database bundled
+# with Python, through str.isidentifier() which implements exactly these
+# properties (plus '_' as a start character).
+#
+# Usage: python3 tools/character-tables.py > src/character-tables.cc
+
+import sys
+import unicodedata
+
+# Must match the enum in character-predicates.h
+IDENTIFIER_START = 1 << 0
+IDENTIFIER_BODY = 1 << 1
+DECIMAL_DIGIT = 1 << 2
+HEX_DIGIT = 1 << 3
+OCTAL_DIGIT = 1 << 4
+BINARY_DIGIT = 1 << 5
+WHITESPACE = 1 << 6
+
+# Codepoints are split into a block number and 8 low bits
+BLOCK_SHIFT = 8
+BLOCK_SIZE = 1 << BLOCK_SHIFT
+WORDS_PER_BLOCK = BLOCK_SIZE // 32
+# No identifier character lies above U+E01EF
+LIMIT = 0xE0200
+
+
+def ascii_class(c):
+    ch = chr(c)
+    cls = 0
+    if ch.isascii() and (ch.isalpha() or ch == '_'):
+        cls |= IDENTIFIER_START | IDENTIFIER_BODY
+    if '0' <= ch <= '9':
+        cls |= IDENTIFIER_BODY | DECIMAL_DIGIT | HEX_DIGIT
+    if 'a' <= ch.lower() <= 'f' and ch.isascii():
+        cls |= HEX_DIGIT
+    if '0' <= ch <= '7':
+        cls |= OCTAL_DIGIT
+    if ch in '01':
+        cls |= BINARY_DIGIT
+    if ch in ' \t\n':
+        cls |= WHITESPACE
+    return cls
+
+
+def is_xid_start(c):
+    return c != ord('_') and chr(c).isidentifier()
+
+
+def is_xid_continue(c):
+    return ('a' + chr(c)).isidentifier()
+
+
+def words(predicate, block):
+    base = block * BLOCK_SIZE
+    result = []
+    for w in range(WORDS_PER_BLOCK):
+        bits = 0
+        for b in range(32):
+            if predicate(base + w * 32 + b):
+                bits |= 1 << b
+        result.append(bits)
+    return tuple(result)
+
+
+def main():
+    blocks = {}
+    index = []
+    for block in range(LIMIT // BLOCK_SIZE):
+        key = (words(is_xid_start, block), words(is_xid_continue, block))
+        if key not in blocks:
+            blocks[key] = len(blocks)
+        index.append(blocks[key])
+    assert len(blocks) <= 256
+
+    out = sys.stdout
+    out.write('// Generated by tools/character-tables.py from Unicode %s, '
+              'do not edit.\n\n' % unicodedata.unidata_version)
+    out.write('#include "character-predicates.h"\n\n')
+    out.write('namespace flora {\nnamespace character {\n\n')
+
+    out.write('const unsigned char kAsciiClassTable[256] = {\n')
+    for row in range(0, 256, 16):
+        out.write('  ' + ', '.join('%d' % ascii_class(c) if c < 128 else '0'
+                                   for c in range(row, row + 16)) + ',\n')
+    out.write('};\n\n')
+
+    out.write('const unsigned char kXIDBlockIndex[%d] = {\n' % len(index))
+    for row in range(0, len(index), 16):
+        out.write('  ' + ', '.join('%d' % i for i in index[row:row + 16]) +
+                  ',\n')
+    out.write('};\n\n')
+
+    ordered = sorted(blocks.items(), key=lambda item: item[1])
+    for name, part in (('kXIDStartBits', 0), ('kXIDContinueBits', 1)):
+        out.write('const std::uint32_t %s[%d] = {\n' %
+                  (name, len(blocks) * WORDS_PER_BLOCK))
+        for key, _ in ordered:
+            out.write('  ' + ', '.join('0x%08x' % w for w in key[part]) +
+                      ',\n')
+        out.write('};\n\n')
+
+    out.write('}\n}\n')
+
+
+if __name__ == '__main__':
+    main()